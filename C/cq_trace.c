@@ -0,0 +1,314 @@
+/** @file cq_trace.c
+ *
+ * @brief This file implements a tracing shim around the circular queue API.
+ *        Every call, its arguments and results are appended to a compact
+ *        binary trace, together with the controller's current test case.
+ *        Queue memory is compared with its image after the previous traced
+ *        call, so writes made by test code directly into a queue are
+ *        recorded as SYNC images and a replay reproduces them.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#define CQ_TRACE_IMPL
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "sut/circular_queue.h"
+#include "test_controller.h"
+#include "cq_trace.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define CQT_NO_ID		0xFFu 	/* queue not traced, id table full */
+#define CQT_MAX_RECORD	( 1u + sizeof(cq_t) ) 	/* largest record */
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+static uint8_t *p_trace;
+static uint32_t trace_size;
+static uint32_t trace_len;
+static uint32_t total_records;
+static uint32_t trace_flags;
+static bool recording;
+
+static cq_t *queues[CQT_MAX_QUEUES]; /* queue of each id */
+static cq_t images[CQT_MAX_QUEUES]; /* queue contents after last traced call */
+static uint32_t total_queues;
+static uint32_t last_case;
+static uint32_t call_mask; /* SUT functions called, recording or not */
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static uint8_t _begin ( cq_t *q, uint8_t op );
+static void _end ( cq_t *q, uint8_t id );
+static bool _reserve ( uint32_t len );
+static void _put ( const void *data, uint32_t len );
+static void _put_u32 ( uint8_t *p, uint32_t val );
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+/* This function starts a new recording
+*/
+void cq_trace_start ( uint8_t *buff, uint32_t size )
+{
+	p_trace = buff;
+	trace_size = size;
+	trace_len = CQT_HEADER_SIZE;
+	total_records = 0;
+	trace_flags = 0;
+	total_queues = 0;
+	last_case = 0xFFFFFFFFu;
+	recording = ( NULL != buff ) && ( size >= CQT_HEADER_SIZE );
+}
+
+/* This function stops recording and writes trace header
+*/
+uint32_t cq_trace_stop ( void )
+{
+	if ( ( NULL == p_trace ) || ( trace_size < CQT_HEADER_SIZE ) )
+	{
+		return 0;
+	}
+
+	recording = false;
+	memcpy ( p_trace, "CQT1", 4 );
+	p_trace[4] = (uint8_t)CQ_SIZE;
+	p_trace[5] = (uint8_t)sizeof(cq_t);
+	p_trace[6] = (uint8_t)sizeof(cq_val_t);
+	p_trace[7] = 0;
+	_put_u32 ( &p_trace[8], total_records );
+	_put_u32 ( &p_trace[12], trace_flags );
+
+	return trace_len;
+}
+
+/* This function stops recording and stores trace in a file
+*/
+bool cq_trace_save ( const char *path )
+{
+	bool stat = false;
+#if defined(__unix__) || defined(__APPLE__)
+	uint32_t len = cq_trace_stop ();
+	FILE *f;
+
+	if ( 0 == len )
+	{
+		return false;
+	}
+	f = fopen ( path, "wb" );
+	if ( NULL != f )
+	{
+		stat = ( len == fwrite ( p_trace, 1, len, f ) );
+		stat = ( 0 == fclose ( f ) ) && stat;
+	}
+#else
+	(void)path;
+#endif
+
+	return stat;
+}
+
+/* This function returns and clears mask of called SUT functions
+*/
+uint32_t cq_trace_calls ( void )
+{
+	uint32_t mask = call_mask;
+
+	call_mask = 0;
+
+	return mask;
+}
+
+/* This function traces cq_init()
+*/
+void cq_trace_init ( cq_t *q )
+{
+	uint8_t id = _begin ( q, CQT_OP_INIT );
+
+	cq_init ( q );
+	_end ( q, id );
+}
+
+/* This function traces cq_enqueue()
+*/
+cq_status_t cq_trace_enqueue ( cq_t *q, cq_val_t val )
+{
+	uint8_t id = _begin ( q, CQT_OP_ENQUEUE );
+	cq_status_t stat = cq_enqueue ( q, val );
+	uint8_t ret = (uint8_t)stat;
+
+	if ( CQT_NO_ID != id )
+	{
+		_put ( &val, sizeof(val) );
+		_put ( &ret, 1u );
+	}
+	_end ( q, id );
+
+	return stat;
+}
+
+/* This function traces cq_dequeue()
+*/
+cq_status_t cq_trace_dequeue ( cq_t *q, cq_val_t *val )
+{
+	uint8_t id = _begin ( q, CQT_OP_DEQUEUE );
+	cq_status_t stat = cq_dequeue ( q, val );
+	uint8_t ret = (uint8_t)stat;
+	cq_val_t out = ( CQ_OK == stat ) ? *val : (cq_val_t)0;
+
+	if ( CQT_NO_ID != id )
+	{
+		_put ( &ret, 1u );
+		_put ( &out, sizeof(out) );
+	}
+	_end ( q, id );
+
+	return stat;
+}
+
+/* This function traces cq_is_empty()
+*/
+bool cq_trace_is_empty ( cq_t *q )
+{
+	uint8_t id = _begin ( q, CQT_OP_IS_EMPTY );
+	bool stat = cq_is_empty ( q );
+	uint8_t ret = ( true == stat ) ? 1u : 0u;
+
+	if ( CQT_NO_ID != id )
+	{
+		_put ( &ret, 1u );
+	}
+	_end ( q, id );
+
+	return stat;
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function records case change, queue changes made outside the API and
+ * the op byte. Space for the whole record is reserved up front so a record
+ * is never cut in half. Returns queue id, CQT_NO_ID if call isn't traced.
+*/
+static uint8_t _begin ( cq_t *q, uint8_t op )
+{
+	uint8_t rec[1u + sizeof(uint32_t)];
+	uint32_t id;
+	bool seen = false;
+
+	call_mask |= 1u << op;
+	if ( false == recording )
+	{
+		return CQT_NO_ID;
+	}
+
+	for ( id = 0; id < total_queues; id++ )
+	{
+		if ( q == queues[id] )
+		{
+			seen = true;
+			break;
+		}
+	}
+	if ( false == seen )
+	{
+		if ( total_queues >= CQT_MAX_QUEUES )
+		{
+			/* calls on this queue are left out, the trace is incomplete */
+			trace_flags |= CQT_FLAG_TRUNCATED | CQT_FLAG_QUEUES;
+			return CQT_NO_ID;
+		}
+		queues[total_queues++] = q;
+	}
+
+	/* case marker, sync image and the call itself */
+	if ( false == _reserve ( 5u + CQT_MAX_RECORD + CQT_MAX_RECORD ) )
+	{
+		return CQT_NO_ID;
+	}
+
+	if ( tc_get_test_index () != last_case )
+	{
+		last_case = tc_get_test_index ();
+		rec[0] = CQT_OP_CASE;
+		_put_u32 ( &rec[1], last_case );
+		_put ( rec, sizeof(rec) );
+		total_records++;
+	}
+
+	if ( ( false == seen ) || ( 0 != memcmp ( q, &images[id], sizeof(cq_t) ) ) )
+	{
+		rec[0] = (uint8_t)( CQT_OP_SYNC | ( id << CQT_ID_SHIFT ) );
+		_put ( rec, 1u );
+		_put ( q, sizeof(cq_t) );
+		total_records++;
+	}
+
+	rec[0] = (uint8_t)( op | ( id << CQT_ID_SHIFT ) );
+	_put ( rec, 1u );
+	total_records++;
+
+	return (uint8_t)id;
+}
+
+/* This function keeps queue image after a traced call
+*/
+static void _end ( cq_t *q, uint8_t id )
+{
+	if ( CQT_NO_ID != id )
+	{
+		memcpy ( &images[id], q, sizeof(cq_t) );
+	}
+}
+
+/* This function checks trace space, recording stops when buffer is full
+*/
+static bool _reserve ( uint32_t len )
+{
+	if ( ( trace_size - trace_len ) < len )
+	{
+		recording = false;
+		trace_flags |= CQT_FLAG_TRUNCATED;
+		return false;
+	}
+
+	return true;
+}
+
+/* This function appends bytes to trace
+*/
+static void _put ( const void *data, uint32_t len )
+{
+	memcpy ( &p_trace[trace_len], data, len );
+	trace_len += len;
+}
+
+/* This function stores little endian u32
+*/
+static void _put_u32 ( uint8_t *p, uint32_t val )
+{
+	p[0] = (uint8_t)val;
+	p[1] = (uint8_t)( val >> 8 );
+	p[2] = (uint8_t)( val >> 16 );
+	p[3] = (uint8_t)( val >> 24 );
+}
+
+/*** end of file ***/
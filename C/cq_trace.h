@@ -0,0 +1,108 @@
+/** @file cq_trace.h
+ *
+ * @brief This file provides public interface functions and data structures for
+ *        cq_trace.c (record of circular queue API calls for replay)
+ *
+ *        Built with -DCQ_TRACE, test code including this header after
+ *        circular_queue.h calls the SUT through the tracing shim, all other
+ *        builds call the SUT directly.
+ *
+ * @par Trace format (little endian)
+ *        header   "CQT1", CQ_SIZE u8, sizeof(cq_t) u8, sizeof(cq_val_t) u8,
+ *                 reserved u8, records u32, flags u32 (bit0 truncated,
+ *                 bit1 calls on queues past CQT_MAX_QUEUES left out)
+ *        records  op u8 (bits 0..2 operation, bits 3..6 queue id), then
+ *                 INIT      -
+ *                 ENQUEUE   val, status
+ *                 DEQUEUE   status, val (0 unless status is CQ_OK)
+ *                 IS_EMPTY  result
+ *                 SYNC      queue image (sizeof(cq_t)), the queue was changed
+ *                           outside the API or is seen first time
+ *                 CASE      test case index u32, following calls belong to it
+ *        Values are sizeof(cq_val_t) bytes, statuses one byte.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd.  All rights reserved.
+ */
+
+#ifndef CQ_TRACE_H
+#define CQ_TRACE_H
+
+
+/* Defines trace layout
+*/
+#define CQT_HEADER_SIZE		16u
+#define CQT_MAX_QUEUES		16u 	/* queues told apart by a trace */
+#define CQT_OP_MASK			(uint8_t)0x07
+#define CQT_ID_SHIFT		3u
+#define CQT_FLAG_TRUNCATED	(uint32_t)0x01
+#define CQT_FLAG_QUEUES		(uint32_t)0x02 	/* set along with CQT_FLAG_TRUNCATED */
+
+/* Defines traced operations
+*/
+typedef enum CQT_OPS {
+
+	CQT_OP_INIT = 0,
+	CQT_OP_ENQUEUE = 1,
+	CQT_OP_DEQUEUE = 2,
+	CQT_OP_IS_EMPTY = 3,
+	CQT_OP_SYNC = 4,
+	CQT_OP_CASE = 5
+
+} cqt_op_t;
+
+/*!
+ * @brief Starts recording into a buffer, a previous recording is discarded.
+ *        Recording stops (trace marked truncated) when the buffer is full.
+ *
+ * @param[in] buff  trace buffer.
+ * @param[in] size  buffer size in bytes.
+ *
+ * @return None.
+ */
+void cq_trace_start ( uint8_t *buff, uint32_t size );
+
+/*!
+ * @brief Stops recording and completes trace header.
+ *
+ * @param[in] None.
+ *
+ * @return trace length in bytes.
+ */
+uint32_t cq_trace_stop ( void );
+
+/*!
+ * @brief Stops recording and writes the trace to a file (hosted builds only).
+ *
+ * @param[in] path  trace file path.
+ *
+ * @return true if trace is written.
+ */
+bool cq_trace_save ( const char *path );
+
+/*!
+ * @brief Provides SUT functions called through the shim since the previous
+ *        call, whether recording or not.
+ *
+ * @param[in] None.
+ *
+ * @return bit mask, bit n set if operation n (cqt_op_t) was called.
+ */
+uint32_t cq_trace_calls ( void );
+
+/* Tracing shim, same interface as SUT functions */
+void cq_trace_init ( cq_t *q );
+cq_status_t cq_trace_enqueue ( cq_t *q, cq_val_t val );
+cq_status_t cq_trace_dequeue ( cq_t *q, cq_val_t *val );
+bool cq_trace_is_empty ( cq_t *q );
+
+#if defined(CQ_TRACE) && !defined(CQ_TRACE_IMPL)
+#define cq_init 		cq_trace_init
+#define cq_enqueue 		cq_trace_enqueue
+#define cq_dequeue 		cq_trace_dequeue
+#define cq_is_empty 	cq_trace_is_empty
+#endif
+
+#endif /* CQ_TRACE_H */
+
+/*** end of file ***/
@@ -19,9 +19,11 @@ typedef uint8_t cq_val_t;
 */
 typedef uint8_t cq_size_t;
 
-/* Defines queue size (statically allocated)
+/* Defines queue size (statically allocated), can be overridden at build time
 */
+#ifndef CQ_SIZE
 #define CQ_SIZE	(cq_size_t)10
+#endif
 
 /* Defines queue parameters
 */
@@ -0,0 +1,329 @@
+/** @file tc_guard.c
+ *
+ * @brief This file implements fixture guard zones. Guard zones around
+ *        registered fixtures are filled with a canary value, and after every
+ *        test case the zones plus the whole fixture contents (outside the
+ *        running case's own object) are compared against their before image.
+ *        Compare kernels use AVX2, SSE2 or NEON when the compiler targets
+ *        them, with a word-wise scalar fallback.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "test_controller.h"
+#include "tc_guard.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define TG_MSG_SIZE		128u
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+static char msg_buff[TG_MSG_SIZE];
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static uint32_t _find_ne_scalar ( const uint8_t *p, uint32_t size, uint8_t val );
+static uint32_t _find_diff_scalar ( const uint8_t *a, const uint8_t *b, uint32_t size );
+static bool _check_range ( uint32_t fx, const uint8_t *obj, const uint8_t *shadow,
+						   uint32_t from, uint32_t to );
+static bool _check_zone ( uint32_t fx, uint8_t *zone, const char *side );
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+/* This function fills guard zones right before and after fixture objects
+*/
+void tc_guard_arm ( const tc_fixture_t *fixtures, uint32_t total )
+{
+	uint8_t *obj;
+
+	for ( uint32_t i = 0; i < total; i++ )
+	{
+		obj = (uint8_t *)fixtures[i].p_obj;
+		memset ( obj - TC_GUARD_SIZE, TC_GUARD_BYTE, TC_GUARD_SIZE );
+		memset ( obj + fixtures[i].size, TC_GUARD_BYTE, TC_GUARD_SIZE );
+	}
+}
+
+/* This function takes before image of all fixtures
+*/
+void tc_guard_snapshot ( const tc_fixture_t *fixtures, uint32_t total )
+{
+	for ( uint32_t i = 0; i < total; i++ )
+	{
+		memcpy ( fixtures[i].p_shadow, fixtures[i].p_obj, fixtures[i].size );
+	}
+}
+
+/* This function puts fixtures back to their before image and re-arms guard
+ * zones
+*/
+void tc_guard_restore ( const tc_fixture_t *fixtures, uint32_t total )
+{
+	for ( uint32_t i = 0; i < total; i++ )
+	{
+		memcpy ( fixtures[i].p_obj, fixtures[i].p_shadow, fixtures[i].size );
+	}
+	tc_guard_arm ( fixtures, total );
+}
+
+/* This function verifies guard zones and fixture contents. Owned memory is
+ * clipped to each fixture, if it's not inside a fixture that fixture must be
+ * unchanged entirely.
+*/
+bool tc_guard_verify ( const tc_fixture_t *fixtures, uint32_t total,
+					   const void *p_owned, uint32_t owned_size )
+{
+	const uint8_t *owned = (const uint8_t *)p_owned;
+	const uint8_t *obj;
+	const uint8_t *shadow;
+	uint32_t from;
+	uint32_t to;
+	bool intact = true;
+
+	for ( uint32_t i = 0; i < total; i++ )
+	{
+		obj = (const uint8_t *)fixtures[i].p_obj;
+		shadow = (const uint8_t *)fixtures[i].p_shadow;
+
+		intact = _check_zone ( i, (uint8_t *)obj - TC_GUARD_SIZE, "before" ) && intact;
+		intact = _check_zone ( i, (uint8_t *)obj + fixtures[i].size, "after" ) && intact;
+
+		/* owned range [from, to) relative to fixture start */
+		from = fixtures[i].size;
+		to = fixtures[i].size;
+		if ( ( NULL != owned ) && ( owned >= obj ) && ( owned < ( obj + fixtures[i].size ) ) )
+		{
+			from = (uint32_t)( owned - obj );
+			if ( 0 == owned_size )
+			{
+				from -= from % fixtures[i].elem_size;
+				to = from + fixtures[i].elem_size;
+			}
+			else
+			{
+				to = from + owned_size;
+			}
+			to = ( to < fixtures[i].size ) ? to : fixtures[i].size;
+		}
+
+		intact = _check_range ( i, obj, shadow, 0, from ) && intact;
+		intact = _check_range ( i, obj, shadow, to, fixtures[i].size ) && intact;
+	}
+
+	return intact;
+}
+
+/* This function finds first byte not equal to val
+*/
+uint32_t tc_mem_find_ne ( const void *p, uint32_t size, uint8_t val )
+{
+	const uint8_t *s = (const uint8_t *)p;
+	uint32_t i = 0;
+
+#if defined(__AVX2__)
+	const __m256i v = _mm256_set1_epi8 ( (char)val );
+	uint32_t mask;
+
+	for ( ; ( i + 32u ) <= size; i += 32u )
+	{
+		mask = (uint32_t)_mm256_movemask_epi8 ( _mm256_cmpeq_epi8 (
+							_mm256_loadu_si256 ( (const __m256i *)&s[i] ), v ) );
+		if ( 0xFFFFFFFFu != mask )
+		{
+			return i + (uint32_t)__builtin_ctz ( ~mask );
+		}
+	}
+#elif defined(__SSE2__)
+	const __m128i v = _mm_set1_epi8 ( (char)val );
+	uint32_t mask;
+
+	for ( ; ( i + 16u ) <= size; i += 16u )
+	{
+		mask = (uint32_t)_mm_movemask_epi8 ( _mm_cmpeq_epi8 (
+							_mm_loadu_si128 ( (const __m128i *)&s[i] ), v ) );
+		if ( 0xFFFFu != mask )
+		{
+			return i + (uint32_t)__builtin_ctz ( ~mask );
+		}
+	}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	const uint8x16_t v = vdupq_n_u8 ( val );
+
+	for ( ; ( i + 16u ) <= size; i += 16u )
+	{
+		if ( 0xFFu != vminvq_u8 ( vceqq_u8 ( vld1q_u8 ( &s[i] ), v ) ) )
+		{
+			break;
+		}
+	}
+#endif
+
+	return i + _find_ne_scalar ( &s[i], size - i, val );
+}
+
+/* This function finds first differing byte of two areas
+*/
+uint32_t tc_mem_find_diff ( const void *a, const void *b, uint32_t size )
+{
+	const uint8_t *x = (const uint8_t *)a;
+	const uint8_t *y = (const uint8_t *)b;
+	uint32_t i = 0;
+
+#if defined(__AVX2__)
+	uint32_t mask;
+
+	for ( ; ( i + 32u ) <= size; i += 32u )
+	{
+		mask = (uint32_t)_mm256_movemask_epi8 ( _mm256_cmpeq_epi8 (
+							_mm256_loadu_si256 ( (const __m256i *)&x[i] ),
+							_mm256_loadu_si256 ( (const __m256i *)&y[i] ) ) );
+		if ( 0xFFFFFFFFu != mask )
+		{
+			return i + (uint32_t)__builtin_ctz ( ~mask );
+		}
+	}
+#elif defined(__SSE2__)
+	uint32_t mask;
+
+	for ( ; ( i + 16u ) <= size; i += 16u )
+	{
+		mask = (uint32_t)_mm_movemask_epi8 ( _mm_cmpeq_epi8 (
+							_mm_loadu_si128 ( (const __m128i *)&x[i] ),
+							_mm_loadu_si128 ( (const __m128i *)&y[i] ) ) );
+		if ( 0xFFFFu != mask )
+		{
+			return i + (uint32_t)__builtin_ctz ( ~mask );
+		}
+	}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	for ( ; ( i + 16u ) <= size; i += 16u )
+	{
+		if ( 0xFFu != vminvq_u8 ( vceqq_u8 ( vld1q_u8 ( &x[i] ), vld1q_u8 ( &y[i] ) ) ) )
+		{
+			break;
+		}
+	}
+#endif
+
+	return i + _find_diff_scalar ( &x[i], &y[i], size - i );
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function scans 8 bytes per step, then locates the byte
+*/
+static uint32_t _find_ne_scalar ( const uint8_t *p, uint32_t size, uint8_t val )
+{
+	uint64_t pattern = 0x0101010101010101ull * val;
+	uint64_t w;
+	uint32_t i = 0;
+
+	for ( ; ( i + 8u ) <= size; i += 8u )
+	{
+		memcpy ( &w, &p[i], 8 );
+		if ( w != pattern )
+		{
+			break;
+		}
+	}
+	for ( ; ( i < size ) && ( p[i] == val ); i++ )
+	{
+	}
+
+	return i;
+}
+
+/* This function compares 8 bytes per step, then locates the byte
+*/
+static uint32_t _find_diff_scalar ( const uint8_t *a, const uint8_t *b, uint32_t size )
+{
+	uint64_t wa;
+	uint64_t wb;
+	uint32_t i = 0;
+
+	for ( ; ( i + 8u ) <= size; i += 8u )
+	{
+		memcpy ( &wa, &a[i], 8 );
+		memcpy ( &wb, &b[i], 8 );
+		if ( wa != wb )
+		{
+			break;
+		}
+	}
+	for ( ; ( i < size ) && ( a[i] == b[i] ); i++ )
+	{
+	}
+
+	return i;
+}
+
+/* This function compares fixture bytes [from, to) with before image
+*/
+static bool _check_range ( uint32_t fx, const uint8_t *obj, const uint8_t *shadow,
+						   uint32_t from, uint32_t to )
+{
+	uint32_t off;
+
+	if ( from >= to )
+	{
+		return true;
+	}
+
+	off = from + tc_mem_find_diff ( &obj[from], &shadow[from], to - from );
+	if ( off < to )
+	{
+		snprintf ( msg_buff, TG_MSG_SIZE, "fixture %u modified outside test case data at offset %u",
+				   (unsigned int)fx, (unsigned int)off );
+		tc_log_message ( "ERROR", msg_buff );
+		return false;
+	}
+
+	return true;
+}
+
+/* This function checks one guard zone and re-arms it when damaged
+*/
+static bool _check_zone ( uint32_t fx, uint8_t *zone, const char *side )
+{
+	uint32_t off = tc_mem_find_ne ( zone, TC_GUARD_SIZE, TC_GUARD_BYTE );
+
+	if ( off < TC_GUARD_SIZE )
+	{
+		snprintf ( msg_buff, TG_MSG_SIZE, "guard zone %s fixture %u overwritten at offset %u",
+				   side, (unsigned int)fx, (unsigned int)off );
+		tc_log_message ( "ERROR", msg_buff );
+		memset ( zone, TC_GUARD_BYTE, TC_GUARD_SIZE );
+		return false;
+	}
+
+	return true;
+}
+
+/*** end of file ***/
@@ -0,0 +1,84 @@
+/** @file tc_guard.h
+ *
+ * @brief This file provides public interface functions for tc_guard.c
+ *        (fixture guard zones and bulk memory verification)
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd.  All rights reserved.
+ */
+
+#ifndef TC_GUARD_H
+#define TC_GUARD_H
+
+
+/*!
+ * @brief Fills guard zones of fixtures with canary value.
+ *
+ * @param[in] fixtures  registered fixtures.
+ * @param[in] total  number of fixtures.
+ *
+ * @return None.
+ */
+void tc_guard_arm ( const tc_fixture_t *fixtures, uint32_t total );
+
+/*!
+ * @brief Takes before image of fixtures into their shadow copies.
+ *
+ * @param[in] fixtures  registered fixtures.
+ * @param[in] total  number of fixtures.
+ *
+ * @return None.
+ */
+void tc_guard_snapshot ( const tc_fixture_t *fixtures, uint32_t total );
+
+/*!
+ * @brief Restores fixtures from their before image and re-arms guard zones,
+ *        e.g. to rerun a case on fresh fixtures.
+ *
+ * @param[in] fixtures  registered fixtures.
+ * @param[in] total  number of fixtures.
+ *
+ * @return None.
+ */
+void tc_guard_restore ( const tc_fixture_t *fixtures, uint32_t total );
+
+/*!
+ * @brief Verifies guard zones and compares fixtures against their before
+ *        image, except bytes the running case may modify. Violations are
+ *        logged and damaged guard zones are re-armed.
+ *
+ * @param[in] fixtures  registered fixtures.
+ * @param[in] total  number of fixtures.
+ * @param[in] p_owned  memory the case may modify.
+ * @param[in] owned_size  size of owned memory, 0 = fixture object at p_owned.
+ *
+ * @return true if fixtures are intact.
+ */
+bool tc_guard_verify ( const tc_fixture_t *fixtures, uint32_t total,
+					   const void *p_owned, uint32_t owned_size );
+
+/*!
+ * @brief Finds first byte not equal to a value.
+ *
+ * @param[in] p  memory to scan.
+ * @param[in] size  size in bytes.
+ * @param[in] val  expected value.
+ *
+ * @return offset of first mismatch, size if all bytes match.
+ */
+uint32_t tc_mem_find_ne ( const void *p, uint32_t size, uint8_t val );
+
+/*!
+ * @brief Finds first differing byte of two memory areas.
+ *
+ * @param[in] a  first area.
+ * @param[in] b  second area.
+ * @param[in] size  size in bytes.
+ *
+ * @return offset of first difference, size if areas are equal.
+ */
+uint32_t tc_mem_find_diff ( const void *a, const void *b, uint32_t size );
+
+#endif /* TC_GUARD_H */
+
+/*** end of file ***/
@@ -0,0 +1,519 @@
+/** @file tc_history.c
+ *
+ * @brief This file implements per test case execution statistics which
+ *        persist across runs in a local file. Cases are keyed by name in an
+ *        open addressing hash table, so lookups stay cheap for large
+ *        generated test lists.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_controller.h"
+#include "tc_history.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define TH_LINE_SIZE	128u
+
+/* Defines sort key of a test case
+*/
+typedef struct TH_KEY {
+
+	double 		score; 	/* failure probability per microsecond */
+	uint32_t 	cost_us; 	/* estimated duration */
+	uint32_t 	funcs; 	/* SUT functions called */
+	uint32_t 	fn_id; 	/* run function */
+	bool 		selected;
+	uint32_t 	pos; 	/* position in given order */
+	uint32_t 	idx;
+
+} th_key_t;
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+static tc_history_t history[TC_HISTORY_MAX];
+static char key_buff[TC_HISTORY_NAME];
+static double suite_p0; /* failure rate of all executions */
+static double suite_us; /* mean duration of timed cases, 0 = not taken yet */
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static uint32_t _hash ( const char *name );
+static void _suite_stats ( void );
+static void _stats ( const tc_history_t *hist, double *p_fail, double *us );
+static th_key_t *_make_keys ( const tc_init_t *list, const uint32_t *order, uint32_t total );
+static int _compare ( const void *a, const void *b );
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+/* This function loads history file
+*/
+bool tc_history_load ( const char *path )
+{
+	bool stat = false;
+#if defined(__unix__) || defined(__APPLE__)
+	char line[TH_LINE_SIZE];
+	char name[TC_HISTORY_NAME];
+	unsigned int runs;
+	unsigned int fails;
+	unsigned int flaky;
+	unsigned int time_us;
+	unsigned int funcs;
+	tc_history_t *hist;
+	FILE *f;
+
+	memset ( history, 0, sizeof(history) );
+	suite_us = 0.0;
+	f = fopen ( path, "r" );
+	if ( NULL == f )
+	{
+		return false;
+	}
+	while ( NULL != fgets ( line, sizeof(line), f ) )
+	{
+		if ( ( '#' == line[0] ) ||
+			 ( 6 != sscanf ( line, "%u %u %u %u %x %63s", &runs, &fails, &flaky, &time_us, &funcs, name ) ) )
+		{
+			continue;
+		}
+		hist = tc_history_find ( name, true );
+		if ( NULL != hist )
+		{
+			hist->runs = runs;
+			hist->fails = fails;
+			hist->flaky = flaky;
+			hist->time_us = time_us;
+			hist->funcs = funcs;
+		}
+	}
+	fclose ( f );
+	stat = true;
+#else
+	(void)path;
+#endif
+
+	return stat;
+}
+
+/* This function writes history file
+*/
+bool tc_history_save ( const char *path )
+{
+	bool stat = false;
+#if defined(__unix__) || defined(__APPLE__)
+	FILE *f = fopen ( path, "w" );
+
+	if ( NULL == f )
+	{
+		return false;
+	}
+	fprintf ( f, "# runs fails flaky time_us funcs name\n" );
+	for ( uint32_t i = 0; i < TC_HISTORY_MAX; i++ )
+	{
+		if ( '\0' != history[i].name[0] )
+		{
+			fprintf ( f, "%u %u %u %u %x %s\n", (unsigned int)history[i].runs, (unsigned int)history[i].fails,
+					  (unsigned int)history[i].flaky, (unsigned int)history[i].time_us,
+					  (unsigned int)history[i].funcs, history[i].name );
+		}
+	}
+	stat = ( 0 == fclose ( f ) );
+#else
+	(void)path;
+#endif
+
+	return stat;
+}
+
+/* This function finds (or adds) a test case by name
+*/
+tc_history_t *tc_history_find ( const char *name, bool create )
+{
+	uint32_t slot = _hash ( name ) & ( TC_HISTORY_MAX - 1u );
+
+	if ( ( NULL == name ) || ( '\0' == name[0] ) )
+	{
+		return NULL;
+	}
+	for ( uint32_t probe = 0; probe < TC_HISTORY_MAX; probe++ )
+	{
+		if ( '\0' == history[slot].name[0] )
+		{
+			if ( false == create )
+			{
+				return NULL;
+			}
+			snprintf ( history[slot].name, TC_HISTORY_NAME, "%s", name );
+			return &history[slot];
+		}
+		if ( 0 == strncmp ( history[slot].name, name, TC_HISTORY_NAME - 1u ) )
+		{
+			return &history[slot];
+		}
+		slot = ( slot + 1u ) & ( TC_HISTORY_MAX - 1u );
+	}
+
+	return NULL;
+}
+
+/* This function adds executions to test case statistics
+*/
+void tc_history_update ( const char *name, uint32_t runs, uint32_t fails, bool flaky )
+{
+	tc_history_t *hist = tc_history_find ( name, true );
+
+	if ( NULL != hist )
+	{
+		hist->runs += runs;
+		hist->fails += fails;
+		hist->flaky += ( true == flaky ) ? 1u : 0u;
+	}
+}
+
+/* This function returns failure probability of a test case execution
+*/
+uint32_t tc_history_fail_pct ( const tc_history_t *hist )
+{
+	if ( ( NULL == hist ) || ( 0 == hist->runs ) )
+	{
+		return 0;
+	}
+
+	return (uint32_t)( ( (uint64_t)hist->fails * 100u + hist->runs / 2u ) / hist->runs );
+}
+
+/* This function adds a duration to moving mean of a test case
+*/
+void tc_history_time ( const char *name, uint32_t time_us )
+{
+	tc_history_t *hist = tc_history_find ( name, true );
+
+	if ( NULL == hist )
+	{
+		return;
+	}
+	time_us = ( 0 != time_us ) ? time_us : 1u;
+	if ( 0 == hist->time_us )
+	{
+		hist->time_us = time_us;
+	}
+	else
+	{
+		hist->time_us = (uint32_t)( ( 3ull * hist->time_us + time_us + 2u ) / 4u );
+	}
+}
+
+/* This function returns history key of a test case
+*/
+const char *tc_history_key ( uint32_t index, const char *name )
+{
+	if ( ( NULL != name ) && ( '\0' != name[0] ) )
+	{
+		return name;
+	}
+	snprintf ( key_buff, TC_HISTORY_NAME, "#%u", (unsigned int)index );
+
+	return key_buff;
+}
+
+/* This function sorts test cases by failure probability per unit of time
+*/
+bool tc_history_sort ( const tc_init_t *list, uint32_t *order, uint32_t total )
+{
+	th_key_t *keys;
+
+	if ( total < 2u )
+	{
+		return true;
+	}
+	keys = _make_keys ( list, order, total );
+	if ( NULL == keys )
+	{
+		return false;
+	}
+
+	qsort ( keys, total, sizeof(th_key_t), _compare );
+	for ( uint32_t i = 0; i < total; i++ )
+	{
+		order[i] = keys[i].idx;
+	}
+	free ( keys );
+
+	return true;
+}
+
+/* This function selects test cases fitting a time budget. Greedy weighted
+ * coverage: the case adding most new SUT / run functions per microsecond is
+ * taken until nothing new fits, then remaining budget is filled in fail-fast
+ * order. Selected cases are ordered fail-fast and moved to the front.
+*/
+uint32_t tc_history_budget ( const tc_init_t *list, uint32_t *order, uint32_t total,
+							 uint64_t budget_us )
+{
+	th_key_t *keys;
+	const void **run_fns; /* distinct run functions, index is fn_id */
+	uint8_t *fn_covered;
+	const void *fn;
+	uint32_t id;
+	uint32_t total_fns = 0;
+	uint32_t covered_mask = 0;
+	uint32_t selected = 0;
+	uint32_t best;
+	uint32_t gain;
+	uint32_t m;
+	double best_ratio;
+	double ratio;
+	test_case_t tc;
+
+	keys = _make_keys ( list, order, total );
+	run_fns = malloc ( ( total + 1u ) * sizeof(void *) );
+	fn_covered = calloc ( total + 1u, 1u );
+	if ( ( NULL == keys ) || ( NULL == run_fns ) || ( NULL == fn_covered ) )
+	{
+		free ( keys );
+		free ( run_fns );
+		free ( fn_covered );
+		return total;
+	}
+
+	for ( uint32_t i = 0; i < total; i++ )
+	{
+		fn = NULL;
+		if ( true == tc_get_test_case ( list, keys[i].idx, &tc ) )
+		{
+			fn = (const void *)tc.p_tc_run_fn;
+		}
+		for ( id = 0; ( id < total_fns ) && ( run_fns[id] != fn ); id++ )
+		{
+		}
+		if ( id == total_fns )
+		{
+			run_fns[total_fns++] = fn;
+		}
+		keys[i].fn_id = id;
+	}
+
+	/* coverage phase */
+	for ( ;; )
+	{
+		best = total;
+		best_ratio = 0.0;
+		for ( uint32_t i = 0; i < total; i++ )
+		{
+			if ( ( true == keys[i].selected ) || ( keys[i].cost_us > budget_us ) )
+			{
+				continue;
+			}
+			gain = ( 0u == fn_covered[keys[i].fn_id] ) ? 1u : 0u;
+			for ( m = keys[i].funcs & ~covered_mask; 0u != m; m &= m - 1u )
+			{
+				gain++;
+			}
+			ratio = (double)gain / (double)keys[i].cost_us;
+			if ( ( gain > 0 ) && ( ratio > best_ratio ) )
+			{
+				best = i;
+				best_ratio = ratio;
+			}
+		}
+		if ( best == total )
+		{
+			break;
+		}
+		keys[best].selected = true;
+		covered_mask |= keys[best].funcs;
+		fn_covered[keys[best].fn_id] = 1u;
+		budget_us -= keys[best].cost_us;
+		selected++;
+	}
+
+	/* fill phase, fail-fast order */
+	qsort ( keys, total, sizeof(th_key_t), _compare );
+	for ( uint32_t i = 0; i < total; i++ )
+	{
+		if ( ( false == keys[i].selected ) && ( keys[i].cost_us <= budget_us ) )
+		{
+			keys[i].selected = true;
+			budget_us -= keys[i].cost_us;
+			selected++;
+		}
+	}
+
+	/* selected ones first, both parts stay fail-fast ordered */
+	for ( uint32_t i = 0, k = 0; i < total; i++ )
+	{
+		if ( true == keys[i].selected )
+		{
+			order[k++] = keys[i].idx;
+		}
+	}
+	for ( uint32_t i = 0, k = selected; i < total; i++ )
+	{
+		if ( false == keys[i].selected )
+		{
+			order[k++] = keys[i].idx;
+		}
+	}
+	free ( keys );
+	free ( run_fns );
+	free ( fn_covered );
+
+	return selected;
+}
+
+/* This function records SUT functions called by a test case
+*/
+void tc_history_funcs ( const char *name, uint32_t funcs )
+{
+	tc_history_t *hist = tc_history_find ( name, true );
+
+	if ( NULL != hist )
+	{
+		hist->funcs |= funcs;
+	}
+}
+
+/* This function returns estimated duration of a test case, case switch cost
+ * included
+*/
+uint32_t tc_history_cost ( const tc_history_t *hist )
+{
+	double p_fail;
+	double us;
+
+	_stats ( hist, &p_fail, &us );
+
+	return (uint32_t)us;
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function returns FNV-1a hash of a name
+*/
+static uint32_t _hash ( const char *name )
+{
+	uint32_t h = 2166136261u;
+
+	while ( ( NULL != name ) && ( '\0' != *name ) )
+	{
+		h = ( h ^ (uint8_t)*name++ ) * 16777619u;
+	}
+
+	return h;
+}
+
+/* This function takes suite wide figures used for cases without history:
+ * failure rate (prior of every case) and mean duration
+*/
+static void _suite_stats ( void )
+{
+	uint64_t time_sum = 0;
+	uint64_t runs_sum = 0;
+	uint64_t fails_sum = 0;
+	uint32_t timed = 0;
+
+	for ( uint32_t i = 0; i < TC_HISTORY_MAX; i++ )
+	{
+		runs_sum += history[i].runs;
+		fails_sum += history[i].fails;
+		if ( ( '\0' != history[i].name[0] ) && ( 0 != history[i].time_us ) )
+		{
+			time_sum += history[i].time_us;
+			timed++;
+		}
+	}
+	suite_p0 = ( (double)fails_sum + 1.0 ) / ( (double)runs_sum + 2.0 );
+	suite_us = ( timed > 0 ) ? ( (double)time_sum / (double)timed ) : (double)TC_HISTORY_DEF_US;
+}
+
+/* This function estimates failure probability and duration (case switch
+ * cost included) of a test case, hist may be NULL for an unknown case
+*/
+static void _stats ( const tc_history_t *hist, double *p_fail, double *us )
+{
+	if ( suite_us <= 0.0 )
+	{
+		_suite_stats ();
+	}
+	*p_fail = 0.5;
+	*us = suite_us;
+	if ( NULL != hist )
+	{
+		*p_fail = ( (double)hist->fails + suite_p0 ) / ( (double)hist->runs + 1.0 );
+		*us = ( 0 != hist->time_us ) ? (double)hist->time_us : suite_us;
+	}
+	*us += TC_HISTORY_CASE_US;
+}
+
+/* This function builds sort keys of test cases, NULL if out of memory
+*/
+static th_key_t *_make_keys ( const tc_init_t *list, const uint32_t *order, uint32_t total )
+{
+	th_key_t *keys = malloc ( ( total + 1u ) * sizeof(th_key_t) );
+	const tc_history_t *hist;
+	test_case_t tc;
+	double p_fail;
+	double us;
+
+	if ( NULL == keys )
+	{
+		return NULL;
+	}
+	_suite_stats ();
+	for ( uint32_t i = 0; i < total; i++ )
+	{
+		hist = NULL;
+		if ( true == tc_get_test_case ( list, order[i], &tc ) )
+		{
+			hist = tc_history_find ( tc_history_key ( order[i], tc.name ), false );
+		}
+		_stats ( hist, &p_fail, &us );
+		keys[i].score = p_fail / us;
+		keys[i].cost_us = (uint32_t)us;
+		keys[i].funcs = ( NULL != hist ) ? hist->funcs : 0u;
+		keys[i].fn_id = 0;
+		keys[i].selected = false;
+		keys[i].pos = i;
+		keys[i].idx = order[i];
+	}
+
+	return keys;
+}
+
+/* This function compares sort keys, higher score first, then given order
+*/
+static int _compare ( const void *a, const void *b )
+{
+	const th_key_t *ka = (const th_key_t *)a;
+	const th_key_t *kb = (const th_key_t *)b;
+
+	if ( ka->score != kb->score )
+	{
+		return ( ka->score > kb->score ) ? -1 : 1;
+	}
+
+	return ( ka->pos < kb->pos ) ? -1 : ( ka->pos > kb->pos );
+}
+
+/*** end of file ***/
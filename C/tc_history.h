@@ -0,0 +1,177 @@
+/** @file tc_history.h
+ *
+ * @brief This file provides public interface functions and data structures for
+ *        tc_history.c (per test case execution statistics kept across runs)
+ *
+ * @par File format
+ *        Text, one test case per line: "runs fails flaky time_us funcs name",
+ *        where runs counts executions (reruns included), fails the failed
+ *        ones, flaky the runs the case was classified FLAKY, time_us is its
+ *        recent mean duration and funcs (hex) the mask of SUT functions it
+ *        called (bit = cqt_op_t, CQ_TRACE builds). Unnamed cases are kept
+ *        as "#<index>". Lines starting with '#' are comments.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd.  All rights reserved.
+ */
+
+#ifndef TC_HISTORY_H
+#define TC_HISTORY_H
+
+
+/* Defines history capacity (power of 2) and longest kept name
+*/
+#ifndef TC_HISTORY_MAX
+#define TC_HISTORY_MAX		4096u
+#endif
+#define TC_HISTORY_NAME		64u
+
+/* Defines duration assumed for cases never timed, if no case is timed,
+ * and fixed cost added to every case (console output, case switch)
+*/
+#define TC_HISTORY_DEF_US	1000u
+#ifndef TC_HISTORY_CASE_US
+#define TC_HISTORY_CASE_US	100u
+#endif
+
+/* Defines statistics of one test case
+*/
+typedef struct TC_HISTORY {
+
+	char 		name[TC_HISTORY_NAME]; /* empty if entry is free */
+	uint32_t 	runs;
+	uint32_t 	fails;
+	uint32_t 	flaky;
+	uint32_t 	time_us; 	/* moving mean duration, 0 if never timed */
+	uint32_t 	funcs; 		/* SUT functions called, bit mask */
+
+} tc_history_t;
+
+/*!
+ * @brief Loads history from a file, replacing the one in memory. A missing
+ *        file leaves history empty.
+ *
+ * @param[in] path  history file path.
+ *
+ * @return true if the file was read.
+ */
+bool tc_history_load ( const char *path );
+
+/*!
+ * @brief Writes history to a file (hosted builds only).
+ *
+ * @param[in] path  history file path.
+ *
+ * @return true if history is written.
+ */
+bool tc_history_save ( const char *path );
+
+/*!
+ * @brief Finds statistics of a test case.
+ *
+ * @param[in] name  test case name.
+ * @param[in] create  true to add the case if it isn't known yet.
+ *
+ * @return statistics, NULL if unknown (or history is full).
+ */
+tc_history_t *tc_history_find ( const char *name, bool create );
+
+/*!
+ * @brief Provides history key of a test case, its name or "#<index>".
+ *
+ * @param[in] index  test case index.
+ * @param[in] name  test case name, may be NULL.
+ *
+ * @return key, valid until the next call for an unnamed case.
+ */
+const char *tc_history_key ( uint32_t index, const char *name );
+
+/*!
+ * @brief Adds executions of a test case to its statistics.
+ *
+ * @param[in] name  test case name.
+ * @param[in] runs  executions.
+ * @param[in] fails  failed executions.
+ * @param[in] flaky  true if the case was classified FLAKY.
+ *
+ * @return None.
+ */
+void tc_history_update ( const char *name, uint32_t runs, uint32_t fails, bool flaky );
+
+/*!
+ * @brief Provides estimated probability that an execution of a test case
+ *        fails, from all its recorded executions.
+ *
+ * @param[in] hist  test case statistics.
+ *
+ * @return failure probability in percent, 0 if never executed.
+ */
+uint32_t tc_history_fail_pct ( const tc_history_t *hist );
+
+/*!
+ * @brief Adds a measured duration of a test case to its moving mean
+ *        (weight 1/4, so durations follow changes of the case).
+ *
+ * @param[in] name  test case name.
+ * @param[in] time_us  duration in microseconds.
+ *
+ * @return None.
+ */
+void tc_history_time ( const char *name, uint32_t time_us );
+
+/*!
+ * @brief Orders test cases to find failures early: by descending failure
+ *        probability per unit of time. P(fail) = (fails + p0) / (runs + 1),
+ *        p0 being the failure rate of all recorded executions, over the
+ *        case's mean duration plus TC_HISTORY_CASE_US. Unknown cases get
+ *        P(fail) = 1/2 and the mean duration of known ones. Ties keep their
+ *        given order.
+ *
+ * @param[in] list  test case list the indexes refer to.
+ * @param[in,out] order  test case indexes, sorted in place.
+ * @param[in] total  number of indexes.
+ *
+ * @return true if sorted (false if out of memory, order unchanged).
+ */
+bool tc_history_sort ( const tc_init_t *list, uint32_t *order, uint32_t total );
+
+/*!
+ * @brief Adds SUT functions called by a test case to its mask.
+ *
+ * @param[in] name  test case name.
+ * @param[in] funcs  bit mask of called SUT functions.
+ *
+ * @return None.
+ */
+void tc_history_funcs ( const char *name, uint32_t funcs );
+
+/*!
+ * @brief Provides estimated cost of a test case, as used for ordering and
+ *        budget selection (mean duration plus TC_HISTORY_CASE_US).
+ *
+ * @param[in] hist  test case statistics, NULL for an unknown case.
+ *
+ * @return estimated duration in microseconds.
+ */
+uint32_t tc_history_cost ( const tc_history_t *hist );
+
+/*!
+ * @brief Selects test cases for a time budget, maximizing distinct SUT
+ *        functions and run functions exercised: greedily takes the case
+ *        adding most uncovered functions per estimated microsecond, then
+ *        fills the remaining budget in fail-fast order. Selected cases are
+ *        moved to the front in fail-fast order, skipped ones follow.
+ *
+ * @param[in] list  test case list the indexes refer to.
+ * @param[in,out] order  test case indexes, reordered in place.
+ * @param[in] total  number of indexes.
+ * @param[in] budget_us  time budget in microseconds.
+ *
+ * @return number of selected test cases (total if out of memory).
+ */
+uint32_t tc_history_budget ( const tc_init_t *list, uint32_t *order, uint32_t total,
+							 uint64_t budget_us );
+
+#endif /* TC_HISTORY_H */
+
+/*** end of file ***/
@@ -0,0 +1,176 @@
+/** @file tc_metrics.c
+ *
+ * @brief This file implements the read side of the live metrics block and,
+ *        in hosted builds, its placement in POSIX shared memory. The write
+ *        side is in test_controller.c.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "test_controller.h"
+#include "tc_metrics.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define TM_NAME_SIZE	64u 	/* longest shared memory object name */
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+#if defined(__unix__) || defined(__APPLE__)
+static const char *_shm_name ( const char *name );
+#endif
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+#if defined(__unix__) || defined(__APPLE__)
+static char name_buff[TM_NAME_SIZE];
+#endif
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+/* This function copies metrics block between two equal even sequence reads
+*/
+bool tc_metrics_read ( const tc_metrics_t *block, tc_metrics_t *snap )
+{
+	uint32_t seq;
+
+	for ( uint32_t i = 0; i < TC_METRICS_RETRIES; i++ )
+	{
+		seq = __atomic_load_n ( &block->seq, __ATOMIC_ACQUIRE );
+		if ( 0 != ( seq & 1u ) )
+		{
+			continue;
+		}
+		memcpy ( snap, block, sizeof(*snap) );
+		__atomic_thread_fence ( __ATOMIC_ACQUIRE );
+		if ( __atomic_load_n ( &block->seq, __ATOMIC_RELAXED ) == seq )
+		{
+			return ( TC_METRICS_MAGIC == snap->magic ) && ( TC_METRICS_VERSION == snap->version ) &&
+				   ( sizeof(tc_metrics_t) == snap->size );
+		}
+	}
+
+	return false;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+/* This function creates metrics block in shared memory
+*/
+tc_metrics_t *tc_metrics_create ( const char *name )
+{
+	tc_metrics_t *block;
+	int fd;
+
+	fd = shm_open ( _shm_name ( name ), O_CREAT | O_RDWR, 0644 );
+	if ( fd < 0 )
+	{
+		return NULL;
+	}
+	if ( 0 != ftruncate ( fd, sizeof(tc_metrics_t) ) )
+	{
+		close ( fd );
+		return NULL;
+	}
+	block = mmap ( NULL, sizeof(tc_metrics_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	close ( fd );
+	if ( MAP_FAILED == block )
+	{
+		return NULL;
+	}
+
+	/* left over block of a previous run, readers see it invalid until
+	   the controller publishes */
+	__atomic_store_n ( &block->magic, 0u, __ATOMIC_RELAXED );
+	block->pid = (uint32_t)getpid ();
+
+	return block;
+}
+
+/* This function maps existing metrics block read-only
+*/
+const tc_metrics_t *tc_metrics_open ( const char *name )
+{
+	const tc_metrics_t *block;
+	struct stat st;
+	int fd;
+
+	fd = shm_open ( _shm_name ( name ), O_RDONLY, 0 );
+	if ( fd < 0 )
+	{
+		return NULL;
+	}
+	if ( ( 0 != fstat ( fd, &st ) ) || ( st.st_size < (off_t)sizeof(tc_metrics_t) ) )
+	{
+		close ( fd );
+		return NULL;
+	}
+	block = mmap ( NULL, sizeof(tc_metrics_t), PROT_READ, MAP_SHARED, fd, 0 );
+	close ( fd );
+
+	return ( MAP_FAILED == block ) ? NULL : block;
+}
+
+/* This function unmaps metrics block
+*/
+void tc_metrics_close ( const tc_metrics_t *block )
+{
+	if ( NULL != block )
+	{
+		munmap ( (void *)block, sizeof(tc_metrics_t) );
+	}
+}
+
+/* This function returns monotonic time in nanoseconds
+*/
+uint64_t tc_metrics_clock ( void )
+{
+	struct timespec ts;
+
+	clock_gettime ( CLOCK_MONOTONIC, &ts );
+
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+#if defined(__unix__) || defined(__APPLE__)
+/* This function returns shared memory object name with leading '/'
+*/
+static const char *_shm_name ( const char *name )
+{
+	snprintf ( name_buff, sizeof(name_buff), "/%s", ( '/' == name[0] ) ? &name[1] : name );
+
+	return name_buff;
+}
+#endif
+
+/*** end of file ***/
@@ -0,0 +1,77 @@
+/** @file tc_metrics.h
+ *
+ * @brief This file provides public interface functions for tc_metrics.c
+ *        (live metrics block of a test run in POSIX shared memory)
+ *
+ *        The runner creates the block and passes it to tc_set_metrics(),
+ *        monitors map it read-only and take consistent snapshots with
+ *        tc_metrics_read(), so sampling never blocks or slows the run.
+ *        Layout is tc_metrics_t (test_controller.h).
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd.  All rights reserved.
+ */
+
+#ifndef TC_METRICS_H
+#define TC_METRICS_H
+
+
+/* Defines attempts to get a consistent snapshot while the block is updated
+*/
+#define TC_METRICS_RETRIES	10000u
+
+/*!
+ * @brief Takes a consistent snapshot of a metrics block (seqlock read side).
+ *        The writer is never waited for, an update in progress just makes
+ *        the copy retry.
+ *
+ * @param[in] block  metrics block being published.
+ * @param[out] snap  snapshot.
+ *
+ * @return true if snapshot is consistent and the block valid.
+ */
+bool tc_metrics_read ( const tc_metrics_t *block, tc_metrics_t *snap );
+
+#if defined(__unix__) || defined(__APPLE__)
+/*!
+ * @brief Creates (or resets) a metrics block in POSIX shared memory, owned
+ *        by the calling process.
+ *
+ * @param[in] name  shared memory object name, e.g. "tc_metrics".
+ *
+ * @return block mapped read/write, NULL on error.
+ */
+tc_metrics_t *tc_metrics_create ( const char *name );
+
+/*!
+ * @brief Maps an existing metrics block read-only.
+ *
+ * @param[in] name  shared memory object name.
+ *
+ * @return block, NULL if it doesn't exist (yet).
+ */
+const tc_metrics_t *tc_metrics_open ( const char *name );
+
+/*!
+ * @brief Unmaps a metrics block, the shared memory object stays so the
+ *        final metrics of a run remain readable.
+ *
+ * @param[in] block  block from tc_metrics_create() or tc_metrics_open().
+ *
+ * @return None.
+ */
+void tc_metrics_close ( const tc_metrics_t *block );
+
+/*!
+ * @brief Provides monotonic system time, clock of published timings.
+ *
+ * @param[in] None.
+ *
+ * @return time in nanoseconds.
+ */
+uint64_t tc_metrics_clock ( void );
+#endif
+
+#endif /* TC_METRICS_H */
+
+/*** end of file ***/
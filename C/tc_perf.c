@@ -0,0 +1,393 @@
+/** @file tc_perf.c
+ *
+ * @brief This file implements performance test cases. Samples are taken one
+ *        per run function call, so the controller keeps serving its console
+ *        while a case measures. Statistics are robust to scheduling noise:
+ *        outliers are rejected with the median absolute deviation before
+ *        the mean and its confidence interval are taken.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <time.h>
+#endif
+
+#include "test_controller.h"
+#include "tc_perf.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define PF_MSG_SIZE		160u
+#define PF_MAX_BATCH	( 1u << 30 )
+
+/* Defines stored baseline of a key
+*/
+typedef struct PF_BASELINE {
+
+	char 		key[TC_PERF_KEY_SIZE]; 	/* empty if entry is free */
+	double 		base_ns; 	/* ns per operation, 0 if no baseline */
+	double 		last_ns; 	/* latest measurement, 0 if not measured */
+
+} pf_baseline_t;
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static bool _analyze ( double *mean, double *ci, uint32_t *outliers );
+static void _finish ( void );
+static pf_baseline_t *_find ( const char *key, bool create );
+static void _sort ( double *v, uint32_t n );
+static double _sqrt ( double x );
+#if defined(__unix__) || defined(__APPLE__)
+static uint64_t _clock_ns ( void );
+#endif
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+static tc_perf_t cfg; /* running case with defaults applied */
+static double samples[TC_PERF_MAX_SAMPLES]; /* ns per body call */
+static double sorted[TC_PERF_MAX_SAMPLES];
+static uint32_t total_samples;
+static uint32_t warm_samples;
+static uint32_t batch; /* body calls per sample */
+static char msg_buff[PF_MSG_SIZE];
+static pf_baseline_t baselines[TC_PERF_MAX_KEYS];
+
+#if defined(__unix__) || defined(__APPLE__)
+static tc_perf_clock_fn_t p_clock_fn = _clock_ns;
+#else
+static tc_perf_clock_fn_t p_clock_fn;
+#endif
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+/* This function initializes a performance test case and applies defaults
+*/
+bool tc_perf_init ( void *test_input_data )
+{
+	cfg = *(const tc_perf_t *)test_input_data;
+	cfg.ops = ( 0 != cfg.ops ) ? cfg.ops : 1u;
+	cfg.warmup = ( 0 != cfg.warmup ) ? cfg.warmup : TC_PERF_WARMUP;
+	cfg.min_samples = ( 0 != cfg.min_samples ) ? cfg.min_samples : TC_PERF_MIN_SAMPLES;
+	cfg.max_samples = ( ( 0 != cfg.max_samples ) && ( cfg.max_samples < TC_PERF_MAX_SAMPLES ) ) ?
+					  cfg.max_samples : TC_PERF_MAX_SAMPLES;
+	cfg.min_samples = ( cfg.min_samples < cfg.max_samples ) ? cfg.min_samples : cfg.max_samples;
+	cfg.ci_permille = ( 0 != cfg.ci_permille ) ? cfg.ci_permille : TC_PERF_CI_PERMILLE;
+	cfg.tolerance_pct = ( 0 != cfg.tolerance_pct ) ? cfg.tolerance_pct : TC_PERF_TOLERANCE_PCT;
+
+	total_samples = 0;
+	warm_samples = 0;
+	batch = 1;
+
+	return true;
+}
+
+/* This function takes one sample of a performance test case. Warmup samples
+ * also calibrate the batch size, measurement stops at the configured
+ * confidence or sample limit.
+*/
+void tc_perf_run ( void )
+{
+	double mean;
+	double ci;
+	uint32_t outliers;
+	uint64_t t0;
+	uint64_t t;
+
+	if ( ( NULL == p_clock_fn ) || ( NULL == cfg.p_body_fn ) )
+	{
+		tc_log_message ("ERROR", "performance test case without clock or body");
+		tc_log_result ( false );
+		return;
+	}
+
+	t0 = p_clock_fn ();
+	for ( uint32_t i = 0; i < batch; i++ )
+	{
+		cfg.p_body_fn ( cfg.p_ctx );
+	}
+	t = p_clock_fn () - t0;
+
+	if ( warm_samples < cfg.warmup )
+	{
+		if ( ( t < TC_PERF_SAMPLE_NS ) && ( batch < PF_MAX_BATCH ) )
+		{
+			batch *= 2u;
+		}
+		else
+		{
+			warm_samples++;
+		}
+		return;
+	}
+
+	samples[total_samples++] = (double)t / (double)batch;
+	if ( ( total_samples >= cfg.max_samples ) ||
+		 ( ( total_samples >= cfg.min_samples ) && ( true == _analyze ( &mean, &ci, &outliers ) ) ) )
+	{
+		_finish ();
+	}
+}
+
+/* This function sets measurement clock
+*/
+void tc_perf_set_clock ( tc_perf_clock_fn_t clock_fn )
+{
+	p_clock_fn = clock_fn;
+}
+
+/* This function loads baseline file
+*/
+bool tc_perf_load ( const char *path )
+{
+	bool stat = false;
+#if defined(__unix__) || defined(__APPLE__)
+	char line[PF_MSG_SIZE];
+	char key[TC_PERF_KEY_SIZE];
+	double ns;
+	pf_baseline_t *base;
+	FILE *f = fopen ( path, "r" );
+
+	if ( NULL == f )
+	{
+		return false;
+	}
+	while ( NULL != fgets ( line, sizeof(line), f ) )
+	{
+		if ( ( '#' != line[0] ) && ( 2 == sscanf ( line, "%lf %31s", &ns, key ) ) &&
+			 ( NULL != ( base = _find ( key, true ) ) ) )
+		{
+			base->base_ns = ns;
+		}
+	}
+	fclose ( f );
+	stat = true;
+#else
+	(void)path;
+#endif
+
+	return stat;
+}
+
+/* This function writes baseline file, latest measurements replace baselines
+*/
+bool tc_perf_save ( const char *path )
+{
+	bool stat = false;
+#if defined(__unix__) || defined(__APPLE__)
+	FILE *f = fopen ( path, "w" );
+	double ns;
+
+	if ( NULL == f )
+	{
+		return false;
+	}
+	fprintf ( f, "# ns_per_op key\n" );
+	for ( uint32_t i = 0; i < TC_PERF_MAX_KEYS; i++ )
+	{
+		ns = ( 0.0 != baselines[i].last_ns ) ? baselines[i].last_ns : baselines[i].base_ns;
+		if ( ( '\0' != baselines[i].key[0] ) && ( 0.0 != ns ) )
+		{
+			fprintf ( f, "%.3f %s\n", ns, baselines[i].key );
+		}
+	}
+	stat = ( 0 == fclose ( f ) );
+#else
+	(void)path;
+#endif
+
+	return stat;
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function rejects outliers and takes mean and 95% confidence interval
+ * half width of the rest, returns true if the interval is narrow enough
+*/
+static bool _analyze ( double *mean, double *ci, uint32_t *outliers )
+{
+	double median;
+	double mad;
+	double limit;
+	double sum = 0.0;
+	double var = 0.0;
+	double d;
+	uint32_t n = 0;
+
+	memcpy ( sorted, samples, total_samples * sizeof(double) );
+	_sort ( sorted, total_samples );
+	median = sorted[total_samples / 2u];
+	for ( uint32_t i = 0; i < total_samples; i++ )
+	{
+		sorted[i] = ( samples[i] > median ) ? ( samples[i] - median ) : ( median - samples[i] );
+	}
+	_sort ( sorted, total_samples );
+	mad = sorted[total_samples / 2u];
+	/* 3 standard deviations, MAD scaled for normal data */
+	limit = 3.0 * 1.4826 * mad;
+
+	for ( uint32_t i = 0; i < total_samples; i++ )
+	{
+		d = ( samples[i] > median ) ? ( samples[i] - median ) : ( median - samples[i] );
+		if ( d <= limit )
+		{
+			sum += samples[i];
+			n++;
+		}
+	}
+	*mean = sum / (double)n;
+	for ( uint32_t i = 0; i < total_samples; i++ )
+	{
+		d = ( samples[i] > median ) ? ( samples[i] - median ) : ( median - samples[i] );
+		if ( d <= limit )
+		{
+			var += ( samples[i] - *mean ) * ( samples[i] - *mean );
+		}
+	}
+	var = ( n > 1u ) ? ( var / (double)( n - 1u ) ) : 0.0;
+	*ci = 1.96 * _sqrt ( var / (double)n );
+	*outliers = total_samples - n;
+
+	return ( *ci * 1000.0 ) <= ( *mean * (double)cfg.ci_permille );
+}
+
+/* This function logs metrics, compares them against the baseline and logs
+ * the result
+*/
+static void _finish ( void )
+{
+	pf_baseline_t *base = _find ( cfg.key, true );
+	double mean;
+	double ci;
+	double ns_op;
+	uint32_t outliers;
+	bool pass = true;
+
+	_analyze ( &mean, &ci, &outliers );
+	ns_op = mean / (double)cfg.ops;
+	snprintf ( msg_buff, PF_MSG_SIZE, "%s: %.2f ns/op, %.0f ops/s, 95%% CI +-%.1f%%, %u samples x %u, %u outliers",
+			   ( NULL != cfg.key ) ? cfg.key : "-", ns_op, 1e9 / ns_op, ( 100.0 * ci ) / mean,
+			   (unsigned int)total_samples, (unsigned int)batch, (unsigned int)outliers );
+	tc_log_message ("PERF", msg_buff);
+
+	if ( NULL != base )
+	{
+		if ( base->base_ns > 0.0 )
+		{
+			pass = ( ns_op * 100.0 ) <= ( base->base_ns * ( 100.0 + (double)cfg.tolerance_pct ) );
+			snprintf ( msg_buff, PF_MSG_SIZE, "baseline %.2f ns/op, %+.1f%% (tolerance %u%%)",
+					   base->base_ns, ( ( ns_op - base->base_ns ) * 100.0 ) / base->base_ns,
+					   (unsigned int)cfg.tolerance_pct );
+		}
+		else
+		{
+			snprintf ( msg_buff, PF_MSG_SIZE, "no baseline" );
+		}
+		tc_log_message ("PERF", msg_buff);
+		base->last_ns = ns_op;
+	}
+
+	tc_log_result ( pass );
+}
+
+/* This function finds (or adds) baseline of a key
+*/
+static pf_baseline_t *_find ( const char *key, bool create )
+{
+	pf_baseline_t *free_entry = NULL;
+
+	if ( ( NULL == key ) || ( '\0' == key[0] ) )
+	{
+		return NULL;
+	}
+	for ( uint32_t i = 0; i < TC_PERF_MAX_KEYS; i++ )
+	{
+		if ( '\0' == baselines[i].key[0] )
+		{
+			free_entry = ( NULL == free_entry ) ? &baselines[i] : free_entry;
+		}
+		else if ( 0 == strncmp ( baselines[i].key, key, TC_PERF_KEY_SIZE - 1u ) )
+		{
+			return &baselines[i];
+		}
+	}
+	if ( ( true == create ) && ( NULL != free_entry ) )
+	{
+		snprintf ( free_entry->key, TC_PERF_KEY_SIZE, "%s", key );
+		return free_entry;
+	}
+
+	return NULL;
+}
+
+/* This function sorts values in ascending order, insertion sort as sample
+ * counts are small
+*/
+static void _sort ( double *v, uint32_t n )
+{
+	double x;
+	uint32_t k;
+
+	for ( uint32_t i = 1; i < n; i++ )
+	{
+		x = v[i];
+		for ( k = i; ( k > 0 ) && ( v[k - 1u] > x ); k-- )
+		{
+			v[k] = v[k - 1u];
+		}
+		v[k] = x;
+	}
+}
+
+/* This function returns square root, Newton iteration so no libm is needed
+*/
+static double _sqrt ( double x )
+{
+	double r = ( x > 1.0 ) ? x : 1.0;
+
+	if ( x <= 0.0 )
+	{
+		return 0.0;
+	}
+	for ( uint32_t i = 0; i < 64u; i++ )
+	{
+		r = 0.5 * ( r + x / r );
+	}
+
+	return r;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+/* This function returns monotonic system time
+*/
+static uint64_t _clock_ns ( void )
+{
+	struct timespec ts;
+
+	clock_gettime ( CLOCK_MONOTONIC, &ts );
+
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+/*** end of file ***/
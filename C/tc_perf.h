@@ -0,0 +1,109 @@
+/** @file tc_perf.h
+ *
+ * @brief This file provides public interface functions and data structures for
+ *        tc_perf.c (performance test cases with baseline comparison)
+ *
+ *        A performance test case uses tc_perf_init / tc_perf_run with a
+ *        tc_perf_t as input data. The measured body is warmed up, batched so
+ *        one sample lasts TC_PERF_SAMPLE_NS, and sampled until the 95%
+ *        confidence interval of the mean is narrow enough. Outliers (beyond
+ *        3 scaled MADs of the median) are rejected. The case passes unless
+ *        it is slower than its baseline by more than the tolerance.
+ *
+ * @par Baseline file
+ *        Text, one measurement per line: "ns_per_op key". Lines starting
+ *        with '#' are comments.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd.  All rights reserved.
+ */
+
+#ifndef TC_PERF_H
+#define TC_PERF_H
+
+
+/* Defines measurement defaults and limits
+*/
+#define TC_PERF_WARMUP			5u 		/* warmup samples */
+#define TC_PERF_MIN_SAMPLES		10u
+#define TC_PERF_MAX_SAMPLES		200u
+#define TC_PERF_CI_PERMILLE		20u 	/* 95% CI half width, share of mean */
+#define TC_PERF_TOLERANCE_PCT	10u 	/* allowed slowdown against baseline */
+#define TC_PERF_SAMPLE_NS		200000u /* minimum duration of one sample */
+#define TC_PERF_MAX_KEYS		64u 	/* baselines kept */
+#define TC_PERF_KEY_SIZE		32u
+
+/* measured code function pointer */
+typedef void (*tc_perf_fn_t) ( void *ctx );
+
+/* clock function pointer, returns monotonic time in nanoseconds */
+typedef uint64_t (*tc_perf_clock_fn_t) ( void );
+
+/* Defines performance test case, passed as test case input data. Zero
+ * fields take the defaults above.
+*/
+typedef struct TC_PERF {
+
+	tc_perf_fn_t 	p_body_fn; 		/* measured code */
+	void 			*p_ctx; 		/* passed to p_body_fn */
+	const char 		*key; 			/* baseline key */
+	uint32_t 		ops; 			/* operations per body call, metrics are per operation */
+	uint32_t 		warmup; 		/* warmup samples */
+	uint32_t 		min_samples;
+	uint32_t 		max_samples; 	/* up to TC_PERF_MAX_SAMPLES */
+	uint32_t 		ci_permille; 	/* stop once 95% CI half width is below this share of mean */
+	uint32_t 		tolerance_pct; 	/* allowed slowdown against baseline */
+
+} tc_perf_t;
+
+/*!
+ * @brief Initializes a performance test case, tc_init_fn_t of the case.
+ *
+ * @param[in] test_input_data  tc_perf_t of the case.
+ *
+ * @return true.
+ */
+bool tc_perf_init ( void *test_input_data );
+
+/*!
+ * @brief Runs a performance test case, tc_run_fn_t of the case. Takes one
+ *        sample per call, logs metrics and result once done.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ */
+void tc_perf_run ( void );
+
+/*!
+ * @brief Sets clock used for measurements, hosted builds default to the
+ *        monotonic system clock.
+ *
+ * @param[in] clock_fn  clock function.
+ *
+ * @return None.
+ */
+void tc_perf_set_clock ( tc_perf_clock_fn_t clock_fn );
+
+/*!
+ * @brief Loads baselines from a file (hosted builds only).
+ *
+ * @param[in] path  baseline file path.
+ *
+ * @return true if the file was read.
+ */
+bool tc_perf_load ( const char *path );
+
+/*!
+ * @brief Writes baselines to a file, measured keys with their latest result
+ *        (hosted builds only).
+ *
+ * @param[in] path  baseline file path.
+ *
+ * @return true if baselines are written.
+ */
+bool tc_perf_save ( const char *path );
+
+#endif /* TC_PERF_H */
+
+/*** end of file ***/
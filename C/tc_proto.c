@@ -0,0 +1,557 @@
+/** @file tc_proto.c
+ *
+ * @brief This file implements the framed binary test control protocol. The
+ *        frame codec is shared by target and host tools; the target side
+ *        executes SELECT / RUN / ABORT / QUERY / CASE commands from the host
+ *        and streams test case results back while the run is in progress.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "test_controller.h"
+#include "tc_proto.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define PR_CRC_INIT		(uint16_t)0xFFFF
+#define PR_CRC_POLY		(uint16_t)0x1021
+#define PR_RX_CHUNK		64u 	/* bytes read from link per call */
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+static const tc_transport_t *p_link;
+static tc_proto_rx_t link_rx;
+static uint32_t crc_errors_seen;
+static uint32_t len_errors_seen;
+static uint8_t expected_seq; /* seq of last valid command + 1, used in NAKs */
+static uint8_t tx_buff[TC_PROTO_MAX_FRAME];
+static uint8_t tx_payload[TC_PROTO_MAX_PAYLOAD];
+
+static tc_init_t *p_base_list; /* list cases are selected from */
+static tc_init_t run_list; /* base list restricted to selection */
+static uint32_t select_buff[TC_PROTO_MAX_SELECT];
+static uint32_t total_selected;
+
+static bool run_active;
+static bool run_aborted;
+static uint8_t run_seq; /* seq of RUN, used for run events */
+static uint8_t run_flags;
+static uint32_t run_done; /* cases with result */
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static bool _rx_step ( tc_proto_rx_t *rx, uint8_t byte );
+static void _rx_drop ( tc_proto_rx_t *rx );
+static void _nak_errors ( void );
+static uint16_t _crc_update ( uint16_t crc, uint8_t byte );
+static void _put_u32 ( uint8_t *p, uint32_t val );
+static uint32_t _get_u32 ( const uint8_t *p );
+static void _send ( uint8_t type, uint8_t seq, const void *payload, uint32_t len );
+static void _ack ( uint8_t seq, tc_proto_status_t status );
+static void _execute ( const tc_proto_frame_t *frame );
+static tc_proto_status_t _select ( const tc_proto_frame_t *frame );
+static tc_proto_status_t _run ( const tc_proto_frame_t *frame );
+static tc_proto_status_t _case_info ( const tc_proto_frame_t *frame );
+static void _status ( uint8_t seq );
+static void _on_result ( uint32_t index, const char *name, bool pass );
+static void _log_write ( const uint8_t *data, uint32_t len );
+
+static const tc_transport_t log_transport = { .p_write_fn = _log_write };
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+/* This function feeds one byte to the frame decoder, behind bytes still
+ * held back for rescanning
+*/
+bool tc_proto_rx_byte ( tc_proto_rx_t *rx, uint8_t byte )
+{
+	if ( ( rx->rescan_pos < rx->rescan_len ) && ( rx->rescan_len < TC_PROTO_MAX_FRAME ) )
+	{
+		/* caller didn't collect all frames with tc_proto_rx_more() */
+		rx->rescan[rx->rescan_len++] = byte;
+		return tc_proto_rx_more ( rx );
+	}
+	if ( true == _rx_step ( rx, byte ) )
+	{
+		return true;
+	}
+
+	return tc_proto_rx_more ( rx );
+}
+
+/* This function decodes bytes held back for rescanning up to the next frame
+*/
+bool tc_proto_rx_more ( tc_proto_rx_t *rx )
+{
+	while ( rx->rescan_pos < rx->rescan_len )
+	{
+		if ( true == _rx_step ( rx, rx->rescan[rx->rescan_pos++] ) )
+		{
+			return true;
+		}
+	}
+	rx->rescan_pos = 0;
+	rx->rescan_len = 0;
+
+	return false;
+}
+
+/* This function builds a frame in buff
+*/
+uint32_t tc_proto_encode ( uint8_t *buff, uint8_t type, uint8_t seq,
+						   const void *payload, uint32_t len )
+{
+	uint16_t crc = PR_CRC_INIT;
+	uint32_t total;
+
+	if ( len > TC_PROTO_MAX_PAYLOAD )
+	{
+		len = TC_PROTO_MAX_PAYLOAD;
+	}
+
+	buff[0] = TC_PROTO_SYNC;
+	buff[1] = type;
+	buff[2] = seq;
+	buff[3] = (uint8_t)len;
+	buff[4] = (uint8_t)( len >> 8 );
+	if ( len > 0 )
+	{
+		memcpy ( &buff[TC_PROTO_HEADER_SIZE], payload, len );
+	}
+
+	total = TC_PROTO_HEADER_SIZE + len;
+	for ( uint32_t i = 1; i < total; i++ )
+	{
+		crc = _crc_update ( crc, buff[i] );
+	}
+	buff[total++] = (uint8_t)crc;
+	buff[total++] = (uint8_t)( crc >> 8 );
+
+	return total;
+}
+
+/* This function routes controller output and results to the protocol
+*/
+void tc_proto_init ( tc_init_t *tc_init, const tc_transport_t *link )
+{
+	p_link = link;
+	p_base_list = tc_init;
+	memset ( &link_rx, 0, sizeof(link_rx) );
+	crc_errors_seen = 0;
+	len_errors_seen = 0;
+	expected_seq = 0;
+	total_selected = 0;
+	run_active = false;
+
+	tc_set_transport ( &log_transport );
+	tc_set_result_listener ( _on_result );
+}
+
+/* This function handles received commands and reports run completion
+*/
+void tc_proto_tasks ( void )
+{
+	uint8_t rx[PR_RX_CHUNK];
+	uint32_t len;
+	bool got;
+
+	/* Execute every complete command received so far */
+	while ( ( len = p_link->p_read_fn ( rx, sizeof(rx) ) ) > 0 )
+	{
+		for ( uint32_t i = 0; i < len; i++ )
+		{
+			got = tc_proto_rx_byte ( &link_rx, rx[i] );
+			while ( true == got )
+			{
+				_nak_errors ();
+				_execute ( &link_rx.frame );
+				got = tc_proto_rx_more ( &link_rx );
+			}
+			_nak_errors ();
+		}
+	}
+
+	if ( ( true == run_active ) && ( true == tc_is_idle () ) )
+	{
+		run_active = false;
+		_put_u32 ( &tx_payload[0], run_done );
+		_put_u32 ( &tx_payload[4], tc_get_fail_count () );
+		tx_payload[8] = ( true == run_aborted ) ? 1u : 0u;
+		_send ( TC_PROTO_DONE, run_seq, tx_payload, 9u );
+	}
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function runs frame decoder state machine for one byte
+*/
+static bool _rx_step ( tc_proto_rx_t *rx, uint8_t byte )
+{
+	tc_proto_frame_t *f = &rx->frame;
+	uint32_t hdr_len = TC_PROTO_HEADER_SIZE - 1u;
+
+	if ( false == rx->in_frame )
+	{
+		if ( TC_PROTO_SYNC == byte )
+		{
+			rx->in_frame = true;
+			rx->pos = 0;
+			rx->crc = PR_CRC_INIT;
+		}
+		return false;
+	}
+
+	rx->raw[rx->pos] = byte;
+	if ( rx->pos < hdr_len )
+	{
+		/* type, seq, len */
+		rx->hdr[rx->pos++] = byte;
+		rx->crc = _crc_update ( rx->crc, byte );
+		if ( rx->pos == hdr_len )
+		{
+			f->type = rx->hdr[0];
+			f->seq = rx->hdr[1];
+			f->len = (uint16_t)( rx->hdr[2] | ( rx->hdr[3] << 8 ) );
+			if ( f->len > TC_PROTO_MAX_PAYLOAD )
+			{
+				rx->len_errors++;
+				_rx_drop ( rx );
+			}
+		}
+	}
+	else if ( rx->pos < ( hdr_len + f->len ) )
+	{
+		f->payload[rx->pos - hdr_len] = byte;
+		rx->crc = _crc_update ( rx->crc, byte );
+		rx->pos++;
+	}
+	else if ( rx->pos == ( hdr_len + f->len ) )
+	{
+		rx->crc_lo = byte;
+		rx->pos++;
+	}
+	else
+	{
+		rx->in_frame = false;
+		if ( rx->crc == (uint16_t)( rx->crc_lo | ( byte << 8 ) ) )
+		{
+			return true;
+		}
+		rx->crc_errors++;
+		rx->pos++;
+		_rx_drop ( rx );
+	}
+
+	return false;
+}
+
+/* This function drops the current frame and queues the bytes after its sync
+ * byte in front of those still to rescan. They all belong to the dropped
+ * frame, so the queue never exceeds one frame.
+*/
+static void _rx_drop ( tc_proto_rx_t *rx )
+{
+	uint32_t rest = rx->rescan_len - rx->rescan_pos;
+
+	if ( rest > ( TC_PROTO_MAX_FRAME - rx->pos ) )
+	{
+		/* only if bytes were fed without collecting frames first */
+		rest = TC_PROTO_MAX_FRAME - rx->pos;
+	}
+	rx->in_frame = false;
+	memmove ( &rx->rescan[rx->pos], &rx->rescan[rx->rescan_pos], rest );
+	memcpy ( rx->rescan, rx->raw, rx->pos );
+	rx->rescan_pos = 0;
+	rx->rescan_len = rx->pos + rest;
+}
+
+/* This function answers every frame dropped since the last call with a NAK,
+ * seq is the one expected next as the dropped frame's seq can't be trusted
+*/
+static void _nak_errors ( void )
+{
+	for ( ; crc_errors_seen != link_rx.crc_errors; crc_errors_seen++ )
+	{
+		_ack ( expected_seq, TC_PROTO_ERR_CRC );
+	}
+	for ( ; len_errors_seen != link_rx.len_errors; len_errors_seen++ )
+	{
+		_ack ( expected_seq, TC_PROTO_ERR_LEN );
+	}
+}
+
+/* This function updates CRC-16/CCITT-FALSE with one byte
+*/
+static uint16_t _crc_update ( uint16_t crc, uint8_t byte )
+{
+	crc ^= (uint16_t)( byte << 8 );
+	for ( uint32_t i = 0; i < 8u; i++ )
+	{
+		crc = ( crc & 0x8000u ) ? (uint16_t)( ( crc << 1 ) ^ PR_CRC_POLY ) : (uint16_t)( crc << 1 );
+	}
+
+	return crc;
+}
+
+/* This function stores little endian u32
+*/
+static void _put_u32 ( uint8_t *p, uint32_t val )
+{
+	p[0] = (uint8_t)val;
+	p[1] = (uint8_t)( val >> 8 );
+	p[2] = (uint8_t)( val >> 16 );
+	p[3] = (uint8_t)( val >> 24 );
+}
+
+/* This function loads little endian u32
+*/
+static uint32_t _get_u32 ( const uint8_t *p )
+{
+	return (uint32_t)p[0] | ( (uint32_t)p[1] << 8 ) |
+		   ( (uint32_t)p[2] << 16 ) | ( (uint32_t)p[3] << 24 );
+}
+
+/* This function encodes and sends one frame
+*/
+static void _send ( uint8_t type, uint8_t seq, const void *payload, uint32_t len )
+{
+	p_link->p_write_fn ( tx_buff, tc_proto_encode ( tx_buff, type, seq, payload, len ) );
+}
+
+/* This function acknowledges a command
+*/
+static void _ack ( uint8_t seq, tc_proto_status_t status )
+{
+	uint8_t stat = (uint8_t)status;
+
+	_send ( TC_PROTO_ACK, seq, &stat, 1u );
+}
+
+/* This function executes one command, replies carry its seq
+*/
+static void _execute ( const tc_proto_frame_t *frame )
+{
+	tc_proto_status_t stat = TC_PROTO_OK;
+
+	expected_seq = (uint8_t)( frame->seq + 1u );
+
+	switch ( frame->type )
+	{
+		case TC_PROTO_SELECT:
+			stat = _select ( frame );
+			break;
+
+		case TC_PROTO_RUN:
+			stat = _run ( frame );
+			break;
+
+		case TC_PROTO_ABORT:
+			if ( true == run_active )
+			{
+				run_aborted = true;
+				tc_abort ();
+			}
+			break;
+
+		case TC_PROTO_QUERY:
+			_status ( frame->seq );
+			return;
+
+		case TC_PROTO_CASE:
+			stat = _case_info ( frame );
+			if ( TC_PROTO_OK == stat )
+			{
+				return;
+			}
+			break;
+
+		default:
+			stat = TC_PROTO_ERR_CMD;
+			break;
+	}
+
+	_ack ( frame->seq, stat );
+}
+
+/* This function sets or extends the case selection, whole frame is rejected
+ * if any index is invalid
+*/
+static tc_proto_status_t _select ( const tc_proto_frame_t *frame )
+{
+	uint32_t total = tc_get_total ( p_base_list );
+	uint32_t count;
+	uint32_t idx;
+
+	if ( ( frame->len < 1u ) || ( 0 != ( ( frame->len - 1u ) % 4u ) ) )
+	{
+		return TC_PROTO_ERR_CMD;
+	}
+	if ( true == run_active )
+	{
+		return TC_PROTO_ERR_BUSY;
+	}
+
+	count = ( frame->len - 1u ) / 4u;
+	if ( 0 == ( frame->payload[0] & TC_PROTO_SELECT_APPEND ) )
+	{
+		total_selected = 0;
+	}
+	if ( ( total_selected + count ) > TC_PROTO_MAX_SELECT )
+	{
+		return TC_PROTO_ERR_RANGE;
+	}
+	for ( uint32_t i = 0; i < count; i++ )
+	{
+		if ( _get_u32 ( &frame->payload[1u + 4u * i] ) >= total )
+		{
+			return TC_PROTO_ERR_RANGE;
+		}
+	}
+
+	for ( uint32_t i = 0; i < count; i++ )
+	{
+		idx = _get_u32 ( &frame->payload[1u + 4u * i] );
+		select_buff[total_selected++] = idx;
+	}
+
+	return TC_PROTO_OK;
+}
+
+/* This function starts a run of the selected cases, selection is consumed
+*/
+static tc_proto_status_t _run ( const tc_proto_frame_t *frame )
+{
+	if ( frame->len > 1u )
+	{
+		return TC_PROTO_ERR_CMD;
+	}
+	if ( true == run_active )
+	{
+		return TC_PROTO_ERR_BUSY;
+	}
+
+	run_list = *p_base_list;
+	if ( total_selected > 0 )
+	{
+		run_list.p_order = select_buff;
+		run_list.total_order = total_selected;
+	}
+	total_selected = 0;
+
+	run_flags = ( frame->len > 0 ) ? frame->payload[0] : 0u;
+	run_seq = frame->seq;
+	run_done = 0;
+	run_aborted = false;
+	run_active = true;
+	tc_init ( &run_list );
+
+	return TC_PROTO_OK;
+}
+
+/* This function replies test case name, only error status is acknowledged
+*/
+static tc_proto_status_t _case_info ( const tc_proto_frame_t *frame )
+{
+	test_case_t tc;
+	uint32_t idx;
+	uint32_t len = 0;
+
+	if ( 4u != frame->len )
+	{
+		return TC_PROTO_ERR_CMD;
+	}
+	idx = _get_u32 ( frame->payload );
+	if ( ( true == run_active ) && ( NULL != p_base_list->p_gen ) )
+	{
+		/* generated case shares scratch storage with the running one */
+		return TC_PROTO_ERR_BUSY;
+	}
+	if ( ( idx >= tc_get_total ( p_base_list ) ) ||
+		 ( false == tc_get_test_case ( p_base_list, idx, &tc ) ) )
+	{
+		return TC_PROTO_ERR_RANGE;
+	}
+
+	_put_u32 ( tx_payload, idx );
+	if ( NULL != tc.name )
+	{
+		len = (uint32_t)strnlen ( tc.name, TC_PROTO_MAX_PAYLOAD - 4u );
+		memcpy ( &tx_payload[4], tc.name, len );
+	}
+	_send ( TC_PROTO_CASE_INFO, frame->seq, tx_payload, 4u + len );
+
+	return TC_PROTO_OK;
+}
+
+/* This function replies run progress
+*/
+static void _status ( uint8_t seq )
+{
+	tx_payload[0] = ( true == run_active ) ? 1u : 0u;
+	_put_u32 ( &tx_payload[1], run_done );
+	_put_u32 ( &tx_payload[5], ( run_list.p_order != NULL ) ? run_list.total_order :
+													tc_get_total ( &run_list ) );
+	_put_u32 ( &tx_payload[9], tc_get_fail_count () );
+	_put_u32 ( &tx_payload[13], tc_get_total ( p_base_list ) );
+	_send ( TC_PROTO_STATUS, seq, tx_payload, 17u );
+}
+
+/* This function streams a test case result, controller result listener
+*/
+static void _on_result ( uint32_t index, const char *name, bool pass )
+{
+	uint32_t len = 0;
+
+	run_done++;
+	_put_u32 ( tx_payload, index );
+	tx_payload[4] = ( true == pass ) ? 1u : 0u;
+	if ( NULL != name )
+	{
+		len = (uint32_t)strnlen ( name, TC_PROTO_MAX_PAYLOAD - 5u );
+		memcpy ( &tx_payload[5], name, len );
+	}
+	_send ( TC_PROTO_RESULT, run_seq, tx_payload, 5u + len );
+}
+
+/* This function carries controller console output in LOG frames, dropped
+ * unless the run asked for it
+*/
+static void _log_write ( const uint8_t *data, uint32_t len )
+{
+	uint32_t chunk;
+
+	if ( ( false == run_active ) || ( 0 == ( run_flags & TC_PROTO_RUN_LOG ) ) )
+	{
+		return;
+	}
+
+	while ( len > 0 )
+	{
+		chunk = ( len < TC_PROTO_MAX_PAYLOAD ) ? len : TC_PROTO_MAX_PAYLOAD;
+		_send ( TC_PROTO_LOG, run_seq, data, chunk );
+		data += chunk;
+		len -= chunk;
+	}
+}
+
+/*** end of file ***/
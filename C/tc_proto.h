@@ -0,0 +1,184 @@
+/** @file tc_proto.h
+ *
+ * @brief This file provides public interface functions and data structures for
+ *        tc_proto.c (framed binary host <-> target test control protocol)
+ *
+ * @par Frame format (little endian)
+ *        0xA5 | type u8 | seq u8 | len u16 | payload[len] | crc16 u16
+ *        crc16 is CRC-16/CCITT-FALSE over type, seq, len and payload.
+ *
+ * @par Commands (host -> target), executed in the order received. Every
+ *        command is answered by exactly one frame carrying its seq: ACK, or
+ *        STATUS / CASE_INFO on success of QUERY / CASE. So the host may keep
+ *        any number of commands in flight and match replies by seq.
+ *        SELECT   flags u8 (bit0 append), case indexes u32[]
+ *        RUN      flags u8 (bit0 stream console log), runs selection or,
+ *                 if none is selected, the whole list
+ *        ABORT    -
+ *        QUERY    -
+ *        CASE     case index u32
+ *
+ * @par Events (target -> host)
+ *        ACK        status u8, see tc_proto_status_t
+ *        STATUS     running u8, done u32, total u32, failed u32, cases u32
+ *        CASE_INFO  case index u32, name
+ *        RESULT     case index u32, pass u8, name (seq of RUN)
+ *        DONE       done u32, failed u32, aborted u8 (seq of RUN)
+ *        LOG        console text (seq of RUN)
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd.  All rights reserved.
+ */
+
+#ifndef TC_PROTO_H
+#define TC_PROTO_H
+
+
+/* Defines frame layout
+*/
+#define TC_PROTO_SYNC			(uint8_t)0xA5
+#define TC_PROTO_HEADER_SIZE	5u 		/* sync, type, seq, len */
+#define TC_PROTO_CRC_SIZE		2u
+#define TC_PROTO_MAX_PAYLOAD	256u
+#define TC_PROTO_MAX_FRAME		( TC_PROTO_HEADER_SIZE + TC_PROTO_MAX_PAYLOAD + TC_PROTO_CRC_SIZE )
+
+/* Defines maximum number of selected test cases
+*/
+#ifndef TC_PROTO_MAX_SELECT
+#define TC_PROTO_MAX_SELECT		1024u
+#endif
+
+/* SELECT / RUN flags */
+#define TC_PROTO_SELECT_APPEND	(uint8_t)0x01
+#define TC_PROTO_RUN_LOG		(uint8_t)0x01
+
+/* Defines frame types
+*/
+typedef enum TC_PROTO_TYPES {
+
+	TC_PROTO_SELECT = 0x01,
+	TC_PROTO_RUN = 0x02,
+	TC_PROTO_ABORT = 0x03,
+	TC_PROTO_QUERY = 0x04,
+	TC_PROTO_CASE = 0x05,
+
+	TC_PROTO_ACK = 0x80,
+	TC_PROTO_STATUS = 0x81,
+	TC_PROTO_CASE_INFO = 0x82,
+	TC_PROTO_RESULT = 0x83,
+	TC_PROTO_DONE = 0x84,
+	TC_PROTO_LOG = 0x85
+
+} tc_proto_type_t;
+
+/* Defines ACK status
+*/
+typedef enum TC_PROTO_STATUS {
+
+	TC_PROTO_OK = 0,
+	TC_PROTO_ERR_CRC = 1, 		/* frame dropped on CRC mismatch, see below */
+	TC_PROTO_ERR_CMD = 2, 		/* unknown command or bad payload */
+	TC_PROTO_ERR_BUSY = 3, 		/* not allowed while a run is active */
+	TC_PROTO_ERR_RANGE = 4, 	/* case index out of range or selection full */
+	TC_PROTO_ERR_LEN = 5 		/* frame dropped, length over TC_PROTO_MAX_PAYLOAD */
+
+} tc_proto_status_t;
+
+/* A dropped frame (TC_PROTO_ERR_CRC / TC_PROTO_ERR_LEN) is answered with a
+ * NAK whose seq is the one expected next (seq of the last valid command + 1),
+ * the damaged frame's own seq isn't trusted. The host treats a NAK as loss
+ * of any command in flight.
+*/
+
+/* Defines received frame
+*/
+typedef struct TC_PROTO_FRAME {
+
+	uint8_t 	type;
+	uint8_t 	seq;
+	uint16_t 	len;
+	uint8_t 	payload[TC_PROTO_MAX_PAYLOAD];
+
+} tc_proto_frame_t;
+
+/* Defines frame decoder, one per receive direction
+*/
+typedef struct TC_PROTO_RX {
+
+	tc_proto_frame_t 	frame; 		/* frame being received / last complete frame */
+	uint8_t 			hdr[TC_PROTO_HEADER_SIZE - 1u];
+	uint32_t 			pos; 		/* bytes of current frame after sync */
+	uint16_t 			crc; 		/* running CRC */
+	uint8_t 			crc_lo; 	/* received CRC low byte */
+	bool 				in_frame;
+	uint32_t 			crc_errors; /* frames dropped on CRC mismatch */
+	uint32_t 			len_errors; /* frames dropped on length over maximum */
+	uint8_t 			raw[TC_PROTO_MAX_FRAME]; /* bytes after sync of current frame */
+	uint8_t 			rescan[TC_PROTO_MAX_FRAME]; /* bytes after a dropped frame's sync */
+	uint32_t 			rescan_pos;
+	uint32_t 			rescan_len;
+
+} tc_proto_rx_t;
+
+/*!
+ * @brief Feeds one received byte into a frame decoder. Frames with bad length
+ *        or CRC are dropped and the bytes after their sync byte are scanned
+ *        again, so a corrupted length doesn't swallow the frames behind it.
+ *        After a true return call tc_proto_rx_more() until it returns false
+ *        for frames found in such rescanned bytes.
+ *
+ * @param[in,out] rx  decoder.
+ * @param[in] byte  received byte.
+ *
+ * @return true if rx->frame holds a complete, valid frame.
+ */
+bool tc_proto_rx_byte ( tc_proto_rx_t *rx, uint8_t byte );
+
+/*!
+ * @brief Continues decoding bytes held back for rescanning.
+ *
+ * @param[in,out] rx  decoder.
+ *
+ * @return true if rx->frame holds a further complete, valid frame.
+ */
+bool tc_proto_rx_more ( tc_proto_rx_t *rx );
+
+/*!
+ * @brief Encodes a frame.
+ *
+ * @param[out] buff  frame buffer, at least TC_PROTO_MAX_FRAME bytes.
+ * @param[in] type  frame type.
+ * @param[in] seq  sequence number.
+ * @param[in] payload  payload, may be NULL if len is 0.
+ * @param[in] len  payload length (<= TC_PROTO_MAX_PAYLOAD).
+ *
+ * @return frame length.
+ */
+uint32_t tc_proto_encode ( uint8_t *buff, uint8_t type, uint8_t seq,
+						   const void *payload, uint32_t len );
+
+/*!
+ * @brief Starts target side protocol handling. Controller output is carried
+ *        in LOG frames (if requested by RUN) and results are streamed as
+ *        RESULT frames.
+ *
+ * @param[in] tc_init  test case list cases are selected from, referenced.
+ * @param[in] link  transport to the host.
+ *
+ * @return None.
+ */
+void tc_proto_init ( tc_init_t *tc_init, const tc_transport_t *link );
+
+/*!
+ * @brief Executes protocol tasks: decodes and executes received commands and
+ *        reports run completion. Call along with tc_tasks().
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ */
+void tc_proto_tasks ( void );
+
+#endif /* TC_PROTO_H */
+
+/*** end of file ***/
@@ -0,0 +1,223 @@
+/** @file tc_timeline.c
+ *
+ * @brief This file implements the hosted side of the controller timeline:
+ *        a ring shared with forked workers and its export as Chrome trace
+ *        event JSON. Events are recorded by test_controller.c.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+#include "test_controller.h"
+#include "tc_timeline.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define TL_MAX_LANES	( TC_TL_LANE_JOB + 32u )
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static void _put_str ( FILE *f, const char *str );
+static void _put_lane ( FILE *f, uint32_t lane );
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+/* This function allocates timeline header and ring in one shared mapping
+*/
+tc_timeline_t *tc_timeline_create ( uint32_t events )
+{
+	size_t size = sizeof(tc_timeline_t) + (size_t)events * sizeof(tc_tl_event_t);
+	tc_timeline_t *timeline;
+
+	if ( 0 == events )
+	{
+		return NULL;
+	}
+	timeline = mmap ( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+	if ( MAP_FAILED == timeline )
+	{
+		return NULL;
+	}
+	timeline->p_events = (tc_tl_event_t *)( timeline + 1 );
+	timeline->size = events;
+	timeline->head = 0;
+
+	return timeline;
+}
+
+/* This function releases shared timeline
+*/
+void tc_timeline_free ( tc_timeline_t *timeline )
+{
+	if ( NULL != timeline )
+	{
+		munmap ( timeline, sizeof(tc_timeline_t) + (size_t)timeline->size * sizeof(tc_tl_event_t) );
+	}
+}
+
+/* This function writes kept events oldest first, timestamps in microseconds
+ * since the oldest one
+*/
+bool tc_timeline_save ( const tc_timeline_t *timeline, const tc_init_t *tc_init, const char *path )
+{
+	const tc_tl_event_t *ev;
+	test_case_t tc;
+	uint64_t t0 = UINT64_MAX;
+	uint32_t head = __atomic_load_n ( &timeline->head, __ATOMIC_ACQUIRE );
+	uint32_t first = ( head > timeline->size ) ? ( head - timeline->size ) : 0u;
+	bool lanes[TL_MAX_LANES] = { false };
+	bool ok;
+	FILE *f;
+
+	f = fopen ( path, "w" );
+	if ( NULL == f )
+	{
+		return false;
+	}
+
+	for ( uint32_t i = first; i < head; i++ )
+	{
+		ev = &timeline->p_events[i % timeline->size];
+		if ( ev->ts_ns < t0 )
+		{
+			t0 = ev->ts_ns;
+		}
+	}
+
+	fprintf ( f, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"events\":%u,\"lost\":%u},\"traceEvents\":[\n",
+			  (unsigned int)head, (unsigned int)first );
+	fprintf ( f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"test controller\"}}" );
+
+	for ( uint32_t i = first; i < head; i++ )
+	{
+		ev = &timeline->p_events[i % timeline->size];
+		if ( ( ev->lane < TL_MAX_LANES ) && ( false == lanes[ev->lane] ) )
+		{
+			lanes[ev->lane] = true;
+			_put_lane ( f, ev->lane );
+		}
+
+		fprintf ( f, ",\n{\"name\":" );
+		if ( '\0' != ev->name[0] )
+		{
+			_put_str ( f, ev->name );
+			fprintf ( f, ",\"cat\":\"%s\"", ( 0 == strncmp ( ev->name, "TC_", 3 ) ) ? "state" :
+											( 'i' == ev->phase ) ? "log" : "phase" );
+		}
+		else
+		{
+			/* test case span, named after the case */
+			_put_str ( f, ( ( true == tc_get_test_case ( tc_init, ev->index, &tc ) ) && ( NULL != tc.name ) ) ?
+						  tc.name : "-" );
+			fprintf ( f, ",\"cat\":\"case\"" );
+		}
+		fprintf ( f, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u", ev->phase,
+				  (double)( ev->ts_ns - t0 ) / 1e3, (unsigned int)ev->lane );
+		if ( 'i' == ev->phase )
+		{
+			fprintf ( f, ",\"s\":\"t\"" );
+		}
+		if ( ( TC_TL_NO_CASE != ev->index ) || ( '\0' != ev->text[0] ) )
+		{
+			fprintf ( f, ",\"args\":{" );
+			if ( TC_TL_NO_CASE != ev->index )
+			{
+				fprintf ( f, "\"index\":%u%s", (unsigned int)ev->index, ( '\0' != ev->text[0] ) ? "," : "" );
+			}
+			if ( '\0' != ev->text[0] )
+			{
+				fprintf ( f, "\"msg\":" );
+				_put_str ( f, ev->text );
+			}
+			fprintf ( f, "}" );
+		}
+		fprintf ( f, "}" );
+	}
+	fprintf ( f, "\n]}\n" );
+
+	ok = ( 0 == ferror ( f ) );
+	if ( 0 != fclose ( f ) )
+	{
+		ok = false;
+	}
+
+	return ok;
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function writes a JSON string literal
+*/
+static void _put_str ( FILE *f, const char *str )
+{
+	fputc ( '"', f );
+	for ( ; '\0' != *str; str++ )
+	{
+		if ( ( '"' == *str ) || ( '\\' == *str ) )
+		{
+			fputc ( '\\', f );
+			fputc ( *str, f );
+		}
+		else if ( (unsigned char)*str < 0x20u )
+		{
+			fprintf ( f, "\\u%04x", (unsigned int)(unsigned char)*str );
+		}
+		else
+		{
+			fputc ( *str, f );
+		}
+	}
+	fputc ( '"', f );
+}
+
+/* This function writes lane (thread) name metadata
+*/
+static void _put_lane ( FILE *f, uint32_t lane )
+{
+	fprintf ( f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+			  (unsigned int)lane );
+	if ( TC_TL_LANE_MAIN == lane )
+	{
+		fprintf ( f, "controller" );
+	}
+	else if ( TC_TL_LANE_FORK == lane )
+	{
+		fprintf ( f, "fork-server case" );
+	}
+	else if ( lane < TC_TL_LANE_JOB )
+	{
+		fprintf ( f, "rerun worker %u", (unsigned int)( lane - TC_TL_LANE_RERUN ) );
+	}
+	else
+	{
+		fprintf ( f, "concurrent case slot %u", (unsigned int)( lane - TC_TL_LANE_JOB ) );
+	}
+	fprintf ( f, "\"}}" );
+}
+
+#endif
+
+/*** end of file ***/
@@ -0,0 +1,56 @@
+/** @file tc_timeline.h
+ *
+ * @brief This file provides public interface functions for tc_timeline.c
+ *        (Chrome trace event export of the controller timeline)
+ *
+ *        The exported JSON file opens in chrome://tracing and in the
+ *        Perfetto UI. Every lane (controller, fork-server child, rerun
+ *        workers) is a thread of one process, test case spans are named
+ *        after the case and nest the controller states and the case's
+ *        init / run / verify phases.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd.  All rights reserved.
+ */
+
+#ifndef TC_TIMELINE_H
+#define TC_TIMELINE_H
+
+
+#if defined(__unix__) || defined(__APPLE__)
+/*!
+ * @brief Allocates a timeline ring in memory shared with forked children,
+ *        so that fork-server cases and rerun workers record into it too.
+ *
+ * @param[in] events  ring size in events.
+ *
+ * @return timeline, NULL on error.
+ */
+tc_timeline_t *tc_timeline_create ( uint32_t events );
+
+/*!
+ * @brief Releases a timeline from tc_timeline_create().
+ *
+ * @param[in] timeline  timeline.
+ *
+ * @return None.
+ */
+void tc_timeline_free ( tc_timeline_t *timeline );
+
+/*!
+ * @brief Writes recorded events as Chrome trace event JSON. Events older
+ *        than the ring size are lost, spans they began or ended are left
+ *        open / unmatched.
+ *
+ * @param[in] timeline  recorded timeline.
+ * @param[in] tc_init  test case list the events refer to, for case names.
+ * @param[in] path  output file path.
+ *
+ * @return true if the file was written.
+ */
+bool tc_timeline_save ( const tc_timeline_t *timeline, const tc_init_t *tc_init, const char *path );
+#endif
+
+#endif /* TC_TIMELINE_H */
+
+/*** end of file ***/
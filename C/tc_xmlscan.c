@@ -0,0 +1,827 @@
+/** @file tc_xmlscan.c
+ *
+ * @brief This file implements the memory-mapped tc_result log scanner. One
+ *        pass over the mapping tokenizes markup and text, keeps a stack of
+ *        open element names for well-formedness and records offsets of the
+ *        fields the reporter uses. Used from Python through ctypes
+ *        (Python/xml_scan.py).
+ *
+ * @par Build
+ *        gcc -O2 -shared -fPIC -I. tc_xmlscan.c -o libtc_xmlscan.so
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "tc_xmlscan.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define XS_MAX_ATTRS	16u 	/* attributes per element checked for duplicates */
+#define XS_SLOTS		( TC_XS_STRINGS * 2u ) 	/* string hash table size, power of 2 */
+#define XS_COMMENT_STRINGS	( TC_XS_STRINGS / 2u ) 	/* unique comments leave room for ids */
+#define XS_TIME_DIGITS	15u 	/* significant digits of a time converted exactly */
+
+/* Defines characters allowed in element and attribute names (ASCII only)
+*/
+#define XS_NAME_START(c)	( ( ( (c) | 0x20u ) >= 'a' && ( (c) | 0x20u ) <= 'z' ) || \
+							  ( '_' == (c) ) || ( ':' == (c) ) )
+#define XS_NAME_CHAR(c)		( XS_NAME_START(c) || ( (c) >= '0' && (c) <= '9' ) || \
+							  ( '-' == (c) ) || ( '.' == (c) ) )
+#define XS_SPACE(c)			( ( ' ' == (c) ) || ( '\n' == (c) ) || ( '\r' == (c) ) || ( '\t' == (c) ) )
+#define XS_DIGIT(c)			( ( (c) >= '0' ) && ( (c) <= '9' ) )
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+/* Powers of ten a double holds exactly
+*/
+static const double exact_pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+									  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static int _prolog ( tc_xs_file_t *f );
+static int _start_tag ( tc_xs_file_t *f, uint64_t *records, uint32_t *n );
+static int _end_tag ( tc_xs_file_t *f, uint64_t *records, uint32_t *n );
+static int _text ( tc_xs_file_t *f );
+static int _name ( const tc_xs_file_t *f, uint64_t *i );
+static bool _equals ( const tc_xs_file_t *f, uint64_t off, uint64_t len, const char *str );
+static uint32_t _utf8 ( const tc_xs_file_t *f, uint64_t i );
+static const uint8_t *_find ( const uint8_t *p, const uint8_t *end, const char *str );
+static void _emit ( tc_xs_file_t *f, uint64_t *records, uint32_t *n );
+static uint64_t _intern ( tc_xs_file_t *f, uint32_t field, uint32_t limit );
+static uint64_t _time_value ( const tc_xs_file_t *f );
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+/* This function maps log file read-only
+*/
+int tc_xs_open ( tc_xs_file_t *file, const char *path )
+{
+	struct stat st;
+	void *p;
+	int fd;
+
+	memset ( file, 0, sizeof(*file) );
+	file->suite[0] = TC_XS_NONE;
+
+	fd = open ( path, O_RDONLY );
+	if ( fd < 0 )
+	{
+		return TC_XS_IO;
+	}
+	if ( 0 != fstat ( fd, &st ) )
+	{
+		close ( fd );
+		return TC_XS_IO;
+	}
+	file->size = (uint64_t)st.st_size;
+	if ( file->size > 0 )
+	{
+		p = mmap ( NULL, (size_t)file->size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if ( MAP_FAILED == p )
+		{
+			close ( fd );
+			return TC_XS_IO;
+		}
+		madvise ( p, (size_t)file->size, MADV_SEQUENTIAL );
+		file->p_map = p;
+	}
+	close ( fd );
+
+	return 0;
+}
+
+/* This function scans tokens until enough records are found
+*/
+int tc_xs_scan ( tc_xs_file_t *file, uint64_t *records, uint32_t max )
+{
+	uint32_t n = 0;
+	int stat = 0;
+
+	if ( ( 0 == file->pos ) && ( ( stat = _prolog ( file ) ) < 0 ) )
+	{
+		return stat;
+	}
+
+	while ( ( n < max ) && ( file->pos < file->size ) )
+	{
+		if ( '<' != file->p_map[file->pos] )
+		{
+			stat = _text ( file );
+		}
+		else if ( ( file->pos + 1u ) >= file->size )
+		{
+			stat = TC_XS_ERROR;
+		}
+		else if ( '/' == file->p_map[file->pos + 1u] )
+		{
+			stat = _end_tag ( file, records, &n );
+		}
+		else
+		{
+			stat = _start_tag ( file, records, &n );
+		}
+		if ( stat < 0 )
+		{
+			return stat;
+		}
+	}
+
+	if ( ( file->pos >= file->size ) && ( ( false == file->root_done ) || ( 0 != file->depth ) ) )
+	{
+		/* no root, or root not closed */
+		return TC_XS_ERROR;
+	}
+
+	return (int)n;
+}
+
+/* This function returns interned strings from 'first' on
+*/
+uint32_t tc_xs_strings ( const tc_xs_file_t *file, uint64_t *strings, uint32_t first, uint32_t max )
+{
+	uint32_t n = 0;
+
+	for ( ; ( n < max ) && ( ( first + n ) < file->strings ); n++ )
+	{
+		strings[n * 2u] = file->string[first + n][0];
+		strings[n * 2u + 1u] = file->string[first + n][1];
+	}
+
+	return n;
+}
+
+/* This function returns scan results
+*/
+void tc_xs_summary ( const tc_xs_file_t *file, uint64_t summary[6] )
+{
+	summary[0] = file->suite[0];
+	summary[1] = file->suite[1];
+	summary[2] = file->passed;
+	summary[3] = file->failed;
+	summary[4] = file->skipped;
+	summary[5] = file->records;
+}
+
+/* This function returns scanner state size
+*/
+uint32_t tc_xs_state_size ( void )
+{
+	return sizeof(tc_xs_file_t);
+}
+
+/* This function unmaps log file
+*/
+void tc_xs_close ( tc_xs_file_t *file )
+{
+	if ( NULL != file->p_map )
+	{
+		munmap ( (void *)file->p_map, (size_t)file->size );
+		file->p_map = NULL;
+	}
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function skips byte order mark and XML declaration, an encoding
+ * other than UTF-8 isn't decoded here
+*/
+static int _prolog ( tc_xs_file_t *f )
+{
+	const uint8_t *p = f->p_map;
+	const uint8_t *decl_end;
+	const uint8_t *enc;
+
+	if ( ( f->size >= 3u ) && ( 0xEFu == p[0] ) && ( 0xBBu == p[1] ) && ( 0xBFu == p[2] ) )
+	{
+		f->pos = 3u;
+	}
+	if ( ( ( f->size - f->pos ) < 6u ) || ( 0 != memcmp ( &p[f->pos], "<?xml", 5 ) ) ||
+		 ( false == XS_SPACE ( p[f->pos + 5u] ) ) )
+	{
+		return 0;
+	}
+
+	decl_end = _find ( &p[f->pos], &p[f->size], "?>" );
+	if ( NULL == decl_end )
+	{
+		return TC_XS_ERROR;
+	}
+	enc = _find ( &p[f->pos], decl_end, "encoding" );
+	if ( NULL != enc )
+	{
+		for ( enc += 8; ( enc < decl_end ) && ( ( '=' == *enc ) || XS_SPACE ( *enc ) ); enc++ )
+		{
+		}
+		if ( ( ( decl_end - enc ) < 7 ) || ( 0 != strncasecmp ( (const char *)enc + 1, "utf-8", 5 ) ) ||
+			 ( enc[0] != enc[6] ) )
+		{
+			return TC_XS_UNSUPPORTED;
+		}
+	}
+	f->pos = (uint64_t)( decl_end - p ) + 2u;
+
+	return 0;
+}
+
+/* This function scans character data up to next markup
+*/
+static int _text ( tc_xs_file_t *f )
+{
+	const uint8_t *p = f->p_map;
+	uint64_t start = f->pos;
+	uint64_t i;
+	uint32_t seq;
+	uint8_t c;
+
+	for ( i = start; ( i < f->size ) && ( '<' != p[i] ); i++ )
+	{
+		c = p[i];
+		if ( c < 0x20u )
+		{
+			if ( false == XS_SPACE ( c ) )
+			{
+				return TC_XS_ERROR;
+			}
+		}
+		else if ( '&' == c )
+		{
+			return TC_XS_UNSUPPORTED;
+		}
+		else if ( ( '>' == c ) && ( i >= ( start + 2u ) ) && ( ']' == p[i - 1u] ) && ( ']' == p[i - 2u] ) )
+		{
+			/* "]]>" isn't allowed in character data */
+			return TC_XS_ERROR;
+		}
+		else if ( c >= 0x80u )
+		{
+			if ( 0u == ( seq = _utf8 ( f, i ) ) )
+			{
+				return TC_XS_ERROR;
+			}
+			i += seq - 1u;
+		}
+		if ( ( 0u == f->depth ) && ( false == XS_SPACE ( c ) ) )
+		{
+			/* only whitespace outside the root */
+			return TC_XS_ERROR;
+		}
+	}
+	if ( true == f->want_text )
+	{
+		f->rec[TC_XS_COMMENT + 1u] = i - start;
+		f->want_text = false;
+	}
+	f->pos = i;
+
+	return 0;
+}
+
+/* This function scans start (or empty element) tag with its attributes
+*/
+static int _start_tag ( tc_xs_file_t *f, uint64_t *records, uint32_t *n )
+{
+	const uint8_t *p = f->p_map;
+	uint64_t attrs[XS_MAX_ATTRS][2];
+	uint64_t name;
+	uint64_t name_len;
+	uint64_t i = f->pos + 1u;
+	uint64_t a_name;
+	uint64_t a_len;
+	uint64_t v;
+	uint32_t total_attrs = 0;
+	uint32_t seq;
+	uint8_t quote;
+	bool empty = false;
+	bool tc;
+	bool comment;
+	int stat;
+
+	f->want_text = false;
+	if ( i >= f->size )
+	{
+		return TC_XS_ERROR;
+	}
+	if ( ( '!' == p[i] ) || ( '?' == p[i] ) )
+	{
+		/* comments, CDATA, DOCTYPE and processing instructions */
+		return TC_XS_UNSUPPORTED;
+	}
+	name = i;
+	if ( ( stat = _name ( f, &i ) ) < 0 )
+	{
+		return stat;
+	}
+	name_len = i - name;
+
+	if ( ( true == f->root_done ) || ( f->depth >= TC_XS_DEPTH ) )
+	{
+		return ( true == f->root_done ) ? TC_XS_ERROR : TC_XS_UNSUPPORTED;
+	}
+	tc = ( 1u == f->depth ) && _equals ( f, name, name_len, "tc_result" );
+	comment = ( 2u == f->depth ) && ( true == f->in_tc ) && ( TC_XS_NONE == f->rec[TC_XS_COMMENT] ) &&
+			  _equals ( f, name, name_len, ( true == f->skip_result ) ? "reason" : "debug" );
+	if ( true == tc )
+	{
+		for ( uint32_t k = 0; k < TC_XS_ID_STR; k += 2u )
+		{
+			f->rec[k] = TC_XS_NONE;
+			f->rec[k + 1u] = 0;
+		}
+	}
+
+	for ( ;; )
+	{
+		if ( i >= f->size )
+		{
+			return TC_XS_ERROR;
+		}
+		if ( false == XS_SPACE ( p[i] ) )
+		{
+			if ( '>' == p[i] )
+			{
+				i++;
+				break;
+			}
+			if ( ( '/' == p[i] ) && ( ( i + 1u ) < f->size ) && ( '>' == p[i + 1u] ) )
+			{
+				empty = true;
+				i += 2u;
+				break;
+			}
+			/* attributes are separated by whitespace */
+			return TC_XS_ERROR;
+		}
+		while ( ( i < f->size ) && XS_SPACE ( p[i] ) )
+		{
+			i++;
+		}
+		if ( ( i < f->size ) && ( ( '>' == p[i] ) || ( '/' == p[i] ) ) )
+		{
+			continue;
+		}
+
+		/* name = "value" */
+		a_name = i;
+		if ( ( stat = _name ( f, &i ) ) < 0 )
+		{
+			return stat;
+		}
+		a_len = i - a_name;
+		while ( ( i < f->size ) && XS_SPACE ( p[i] ) )
+		{
+			i++;
+		}
+		if ( ( i >= f->size ) || ( '=' != p[i] ) )
+		{
+			return TC_XS_ERROR;
+		}
+		for ( i++; ( i < f->size ) && XS_SPACE ( p[i] ); i++ )
+		{
+		}
+		if ( ( i >= f->size ) || ( ( '"' != p[i] ) && ( '\'' != p[i] ) ) )
+		{
+			return TC_XS_ERROR;
+		}
+		quote = p[i++];
+		for ( v = i; ( i < f->size ) && ( quote != p[i] ); i++ )
+		{
+			if ( ( '<' == p[i] ) || ( ( p[i] < 0x20u ) && ( false == XS_SPACE ( p[i] ) ) ) )
+			{
+				return TC_XS_ERROR;
+			}
+			if ( ( '&' == p[i] ) || ( p[i] < 0x20u ) )
+			{
+				/* entities and whitespace normalization */
+				return TC_XS_UNSUPPORTED;
+			}
+			if ( p[i] >= 0x80u )
+			{
+				if ( 0u == ( seq = _utf8 ( f, i ) ) )
+				{
+					return TC_XS_ERROR;
+				}
+				i += seq - 1u;
+			}
+		}
+		if ( i >= f->size )
+		{
+			return TC_XS_ERROR;
+		}
+		i++;
+
+		/* duplicate attributes make the element invalid */
+		if ( total_attrs >= XS_MAX_ATTRS )
+		{
+			return TC_XS_UNSUPPORTED;
+		}
+		for ( uint32_t k = 0; k < total_attrs; k++ )
+		{
+			if ( ( attrs[k][1] == a_len ) && ( 0 == memcmp ( &p[attrs[k][0]], &p[a_name], (size_t)a_len ) ) )
+			{
+				return TC_XS_ERROR;
+			}
+		}
+		attrs[total_attrs][0] = a_name;
+		attrs[total_attrs][1] = a_len;
+		total_attrs++;
+
+		if ( 0u == f->depth )
+		{
+			if ( _equals ( f, a_name, a_len, "test_suite" ) )
+			{
+				f->suite[0] = v;
+				f->suite[1] = i - 1u - v;
+			}
+		}
+		else if ( true == tc )
+		{
+			uint32_t field = _equals ( f, a_name, a_len, "id" ) ? TC_XS_ID :
+							 _equals ( f, a_name, a_len, "result" ) ? TC_XS_RESULT :
+							 _equals ( f, a_name, a_len, "time" ) ? TC_XS_TIME : TC_XS_ID_STR;
+			if ( field < TC_XS_ID_STR )
+			{
+				f->rec[field] = v;
+				f->rec[field + 1u] = i - 1u - v;
+			}
+		}
+	}
+	f->pos = i;
+
+	if ( true == tc )
+	{
+		f->skip_result = ( TC_XS_NONE != f->rec[TC_XS_RESULT] ) &&
+						 _equals ( f, f->rec[TC_XS_RESULT], f->rec[TC_XS_RESULT + 1u], "SKIP" );
+		if ( true == empty )
+		{
+			_emit ( f, records, n );
+		}
+		else
+		{
+			f->in_tc = true;
+		}
+	}
+	if ( true == comment )
+	{
+		/* present, text follows unless empty */
+		f->rec[TC_XS_COMMENT] = i;
+		f->rec[TC_XS_COMMENT + 1u] = 0;
+		f->want_text = ( false == empty );
+	}
+
+	if ( false == empty )
+	{
+		f->stack[f->depth][0] = name;
+		f->stack[f->depth][1] = name_len;
+		f->depth++;
+	}
+	else if ( 0u == f->depth )
+	{
+		f->root_done = true;
+	}
+
+	return 0;
+}
+
+/* This function scans end tag, it must close the innermost open element
+*/
+static int _end_tag ( tc_xs_file_t *f, uint64_t *records, uint32_t *n )
+{
+	const uint8_t *p = f->p_map;
+	uint64_t i = f->pos + 2u;
+	uint64_t name = i;
+	uint64_t len;
+	int stat;
+
+	f->want_text = false;
+	if ( ( stat = _name ( f, &i ) ) < 0 )
+	{
+		return stat;
+	}
+	len = i - name;
+	while ( ( i < f->size ) && XS_SPACE ( p[i] ) )
+	{
+		i++;
+	}
+	if ( ( i >= f->size ) || ( '>' != p[i] ) || ( 0u == f->depth ) ||
+		 ( f->stack[f->depth - 1u][1] != len ) ||
+		 ( 0 != memcmp ( &p[f->stack[f->depth - 1u][0]], &p[name], (size_t)len ) ) )
+	{
+		return TC_XS_ERROR;
+	}
+	f->pos = i + 1u;
+	f->depth--;
+
+	if ( ( 1u == f->depth ) && ( true == f->in_tc ) )
+	{
+		f->in_tc = false;
+		_emit ( f, records, n );
+	}
+	else if ( 0u == f->depth )
+	{
+		f->root_done = true;
+	}
+
+	return 0;
+}
+
+/* This function scans a name at *i
+*/
+static int _name ( const tc_xs_file_t *f, uint64_t *i )
+{
+	const uint8_t *p = f->p_map;
+	uint64_t k = *i;
+
+	if ( ( k >= f->size ) || ( false == XS_NAME_START ( p[k] ) ) )
+	{
+		return ( ( k < f->size ) && ( p[k] >= 0x80u ) ) ? TC_XS_UNSUPPORTED : TC_XS_ERROR;
+	}
+	for ( k++; ( k < f->size ) && XS_NAME_CHAR ( p[k] ); k++ )
+	{
+	}
+	if ( ( k < f->size ) && ( p[k] >= 0x80u ) )
+	{
+		return TC_XS_UNSUPPORTED;
+	}
+	*i = k;
+
+	return 0;
+}
+
+/* This function compares bytes of the file with a string
+*/
+static bool _equals ( const tc_xs_file_t *f, uint64_t off, uint64_t len, const char *str )
+{
+	return ( strlen ( str ) == len ) && ( 0 == memcmp ( &f->p_map[off], str, (size_t)len ) );
+}
+
+/* This function validates UTF-8 sequence at i, returns its length or 0
+*/
+static uint32_t _utf8 ( const tc_xs_file_t *f, uint64_t i )
+{
+	const uint8_t *p = &f->p_map[i];
+	uint64_t left = f->size - i;
+	uint32_t len;
+	uint32_t k;
+
+	if ( ( p[0] >= 0xC2u ) && ( p[0] <= 0xDFu ) )
+	{
+		len = 2u;
+	}
+	else if ( ( p[0] & 0xF0u ) == 0xE0u )
+	{
+		len = 3u;
+	}
+	else if ( ( p[0] >= 0xF0u ) && ( p[0] <= 0xF4u ) )
+	{
+		len = 4u;
+	}
+	else
+	{
+		return 0;
+	}
+	if ( left < len )
+	{
+		return 0;
+	}
+	for ( k = 1u; k < len; k++ )
+	{
+		if ( ( p[k] & 0xC0u ) != 0x80u )
+		{
+			return 0;
+		}
+	}
+	/* overlong forms, surrogates and code points above U+10FFFF */
+	if ( ( ( 0xE0u == p[0] ) && ( p[1] < 0xA0u ) ) || ( ( 0xEDu == p[0] ) && ( p[1] >= 0xA0u ) ) ||
+		 ( ( 0xF0u == p[0] ) && ( p[1] < 0x90u ) ) || ( ( 0xF4u == p[0] ) && ( p[1] >= 0x90u ) ) )
+	{
+		return 0;
+	}
+
+	return len;
+}
+
+/* This function finds a string in [p, end), the prolog is short
+*/
+static const uint8_t *_find ( const uint8_t *p, const uint8_t *end, const char *str )
+{
+	size_t len = strlen ( str );
+
+	for ( ; ( (size_t)( end - p ) >= len ); p++ )
+	{
+		if ( 0 == memcmp ( p, str, len ) )
+		{
+			return p;
+		}
+	}
+
+	return NULL;
+}
+
+/* This function stores completed tc_result record with its decoded fields
+ * and counts its result
+*/
+static void _emit ( tc_xs_file_t *f, uint64_t *records, uint32_t *n )
+{
+	uint64_t off = f->rec[TC_XS_RESULT];
+	uint64_t len = f->rec[TC_XS_RESULT + 1u];
+
+	f->rec[TC_XS_ID_STR] = _intern ( f, TC_XS_ID, TC_XS_STRINGS );
+	f->rec[TC_XS_RESULT_STR] = _intern ( f, TC_XS_RESULT, TC_XS_STRINGS );
+	f->rec[TC_XS_COMMENT_STR] = ( ( TC_XS_NONE != f->rec[TC_XS_COMMENT] ) && ( 0u == f->rec[TC_XS_COMMENT + 1u] ) ) ?
+								TC_XS_EMPTY : _intern ( f, TC_XS_COMMENT, XS_COMMENT_STRINGS );
+	f->rec[TC_XS_TIME_VALUE] = _time_value ( f );
+
+	memcpy ( &records[(uint64_t)*n * TC_XS_FIELDS], f->rec, sizeof(f->rec) );
+	(*n)++;
+	f->records++;
+	if ( TC_XS_NONE != off )
+	{
+		if ( _equals ( f, off, len, "PASS" ) )
+		{
+			f->passed++;
+		}
+		else if ( _equals ( f, off, len, "FAIL" ) )
+		{
+			f->failed++;
+		}
+		else if ( _equals ( f, off, len, "SKIP" ) )
+		{
+			f->skipped++;
+		}
+	}
+}
+
+/* This function returns number of the string at a record field, interning
+ * it when seen first while fewer than 'limit' strings are interned (FNV-1a
+ * hash, linear probing)
+*/
+static uint64_t _intern ( tc_xs_file_t *f, uint32_t field, uint32_t limit )
+{
+	uint64_t off = f->rec[field];
+	uint64_t len = f->rec[field + 1u];
+	uint32_t hash = 2166136261u;
+	uint32_t k;
+
+	if ( TC_XS_NONE == off )
+	{
+		return TC_XS_NONE;
+	}
+	for ( uint64_t i = 0; i < len; i++ )
+	{
+		hash = ( hash ^ f->p_map[off + i] ) * 16777619u;
+	}
+	for ( k = hash & ( XS_SLOTS - 1u ); 0u != f->slot[k]; k = ( k + 1u ) & ( XS_SLOTS - 1u ) )
+	{
+		const uint64_t *str = f->string[f->slot[k] - 1u];
+
+		if ( ( str[1] == len ) && ( 0 == memcmp ( &f->p_map[str[0]], &f->p_map[off], (size_t)len ) ) )
+		{
+			return f->slot[k] - 1u;
+		}
+	}
+	if ( f->strings >= limit )
+	{
+		return TC_XS_RAW;
+	}
+	f->string[f->strings][0] = off;
+	f->string[f->strings][1] = len;
+	f->strings++;
+	f->slot[k] = f->strings;
+
+	return f->strings - 1u;
+}
+
+/* This function converts time attribute of plain decimal form with up to
+ * XS_TIME_DIGITS significant digits, integer and power of ten are exact so
+ * one multiplication or division rounds like a full conversion. Other forms
+ * are left to the binding.
+*/
+static uint64_t _time_value ( const tc_xs_file_t *f )
+{
+	const uint8_t *p = &f->p_map[f->rec[TC_XS_TIME]];
+	const uint8_t *end = p + f->rec[TC_XS_TIME + 1u];
+	uint64_t mant = 0;
+	uint32_t sig = 0;
+	int32_t exp = 0;
+	int32_t e10 = 0;
+	bool neg = false;
+	bool exp_neg = false;
+	bool digits = false;
+	bool frac = false;
+	double value;
+	uint64_t bits;
+
+	if ( TC_XS_NONE == f->rec[TC_XS_TIME] )
+	{
+		return TC_XS_NONE;
+	}
+	if ( ( p < end ) && ( ( '-' == *p ) || ( '+' == *p ) ) )
+	{
+		neg = ( '-' == *p );
+		p++;
+	}
+	for ( ; p < end; p++ )
+	{
+		if ( ( '.' == *p ) && ( false == frac ) )
+		{
+			frac = true;
+			continue;
+		}
+		if ( false == XS_DIGIT ( *p ) )
+		{
+			break;
+		}
+		digits = true;
+		if ( ( 0u != mant ) || ( '0' != *p ) )
+		{
+			if ( sig >= XS_TIME_DIGITS )
+			{
+				return TC_XS_RAW;
+			}
+			mant = mant * 10u + (uint64_t)( *p - '0' );
+			sig++;
+		}
+		if ( true == frac )
+		{
+			exp--;
+		}
+	}
+	if ( false == digits )
+	{
+		return TC_XS_RAW;
+	}
+	if ( ( p < end ) && ( ( 'e' == *p ) || ( 'E' == *p ) ) )
+	{
+		p++;
+		if ( ( p < end ) && ( ( '-' == *p ) || ( '+' == *p ) ) )
+		{
+			exp_neg = ( '-' == *p );
+			p++;
+		}
+		if ( ( p >= end ) || ( false == XS_DIGIT ( *p ) ) )
+		{
+			return TC_XS_RAW;
+		}
+		for ( ; ( p < end ) && XS_DIGIT ( *p ); p++ )
+		{
+			if ( e10 > 1000 )
+			{
+				return TC_XS_RAW;
+			}
+			e10 = e10 * 10 + ( *p - '0' );
+		}
+		exp += ( true == exp_neg ) ? -e10 : e10;
+	}
+	if ( p != end )
+	{
+		return TC_XS_RAW;
+	}
+
+	if ( 0u == mant )
+	{
+		value = 0.0;
+	}
+	else if ( ( exp >= 0 ) && ( exp <= 22 ) )
+	{
+		value = (double)mant * exact_pow10[exp];
+	}
+	else if ( ( exp < 0 ) && ( exp >= -22 ) )
+	{
+		value = (double)mant / exact_pow10[-exp];
+	}
+	else
+	{
+		return TC_XS_RAW;
+	}
+	value = ( true == neg ) ? -value : value;
+	memcpy ( &bits, &value, sizeof(bits) );
+
+	return bits;
+}
+
+/*** end of file ***/
@@ -0,0 +1,157 @@
+/** @file tc_xmlscan.h
+ *
+ * @brief This file provides public interface functions and data structures for
+ *        tc_xmlscan.c (memory-mapped scanner for tc_result XML logs)
+ *
+ *        A log is mapped and scanned in place, nothing is copied or
+ *        allocated: every record reports its fields as byte offsets into
+ *        the file. The scanner checks the structure ET would reject
+ *        (unbalanced or crossed tags, junk outside the root) and declines
+ *        constructs it doesn't decode (entities, comments, CDATA, DOCTYPE,
+ *        non UTF-8 encodings), so callers fall back to a full XML parser.
+ *
+ * @par Record layout
+ *        TC_XS_FIELDS uint64_t per record, offset/length pairs of tc_result
+ *        attributes id, result, time and of the comment: text of the first
+ *        <reason> child for SKIP results, of the first <debug> child for
+ *        others. A missing attribute or child has offset TC_XS_NONE, a child
+ *        without text has length 0.
+ *        Decoded fields follow, so bindings convert a batch of records
+ *        without looking at each one: id, result and comment text as number
+ *        of an interned string (tc_xs_strings), and time as IEEE 754 double.
+ *        A missing field is TC_XS_NONE, a comment without text TC_XS_EMPTY,
+ *        a value not interned (string table full, comments only take half
+ *        of it) or a time which isn't a plain decimal number TC_XS_RAW, to
+ *        be read from its offset/length.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd.  All rights reserved.
+ */
+
+#ifndef TC_XMLSCAN_H
+#define TC_XMLSCAN_H
+
+
+/* Defines scanner limits and record layout
+*/
+#define TC_XS_DEPTH		64u 	/* deepest element nesting */
+#define TC_XS_FIELDS	12u 	/* uint64_t per record */
+#define TC_XS_STRINGS	4096u 	/* distinct values interned per file */
+#define TC_XS_NONE		0xFFFFFFFFFFFFFFFFull
+#define TC_XS_EMPTY		0xFFFFFFFFFFFFFFFEull
+#define TC_XS_RAW		0xFFFFFFFFFFFFFFFDull
+
+/* Defines record field indexes, offset at even, length at odd index
+*/
+#define TC_XS_ID		0u
+#define TC_XS_RESULT	2u
+#define TC_XS_TIME		4u
+#define TC_XS_COMMENT	6u
+
+/* Defines decoded record field indexes
+*/
+#define TC_XS_ID_STR		8u
+#define TC_XS_RESULT_STR	9u
+#define TC_XS_COMMENT_STR	10u
+#define TC_XS_TIME_VALUE	11u
+
+/* Defines scan status, negative values end the scan
+*/
+#define TC_XS_ERROR			-1 	/* not well formed */
+#define TC_XS_UNSUPPORTED	-2 	/* well formed maybe, but not decoded here */
+#define TC_XS_IO			-3 	/* file can't be mapped */
+
+/* Defines scanned log file, fields are private except the results
+*/
+typedef struct TC_XS_FILE {
+	
+	const uint8_t 	*p_map;
+	uint64_t 		size;
+	uint64_t 		pos; 		/* next byte to scan */
+	uint32_t 		depth;
+	uint64_t 		stack[TC_XS_DEPTH][2]; /* open element names, offset/length */
+	bool 			root_done;
+	bool 			in_tc; 		/* inside tc_result child of root */
+	bool 			want_text; 	/* comment element just opened */
+	bool 			skip_result;
+	uint64_t 		rec[TC_XS_FIELDS]; /* tc_result being scanned */
+	
+	uint32_t 		strings; 	/* interned strings */
+	uint64_t 		string[TC_XS_STRINGS][2]; /* offset/length, in first seen order */
+	uint32_t 		slot[TC_XS_STRINGS * 2u]; /* hash table, string number + 1, 0 = free */
+	
+	uint64_t 		suite[2]; 	/* root test_suite attribute, offset/length */
+	uint32_t 		passed;
+	uint32_t 		failed;
+	uint32_t 		skipped;
+	uint32_t 		records;
+	
+} tc_xs_file_t;
+
+/*!
+ * @brief Maps a log file for scanning.
+ *
+ * @param[out] file  scanner state.
+ * @param[in] path  log file path.
+ *
+ * @return 0, or TC_XS_IO.
+ */
+int tc_xs_open ( tc_xs_file_t *file, const char *path );
+
+/*!
+ * @brief Scans on until 'max' records are found or the file ends. Counts
+ *        and the suite attribute are valid once the file ended.
+ *
+ * @param[in] file  scanner state.
+ * @param[out] records  max * TC_XS_FIELDS offsets/lengths.
+ * @param[in] max  records to return at most.
+ *
+ * @return records returned (0 = file ended, scan complete), or a negative
+ *         TC_XS_ status.
+ */
+int tc_xs_scan ( tc_xs_file_t *file, uint64_t *records, uint32_t max );
+
+/*!
+ * @brief Provides interned strings, numbers are valid for the whole scan.
+ *
+ * @param[in] file  scanner state.
+ * @param[out] strings  max * 2 offsets/lengths.
+ * @param[in] first  first string number to return.
+ * @param[in] max  strings to return at most.
+ *
+ * @return strings returned.
+ */
+uint32_t tc_xs_strings ( const tc_xs_file_t *file, uint64_t *strings, uint32_t first, uint32_t max );
+
+/*!
+ * @brief Provides scan results, for bindings which don't mirror tc_xs_file_t.
+ *
+ * @param[in] file  scanner state, scan complete.
+ * @param[out] summary  suite attribute offset and length, passed, failed,
+ *                      skipped and record count.
+ *
+ * @return None.
+ */
+void tc_xs_summary ( const tc_xs_file_t *file, uint64_t summary[6] );
+
+/*!
+ * @brief Provides size of scanner state, for bindings allocating it.
+ *
+ * @param[in] None.
+ *
+ * @return sizeof(tc_xs_file_t).
+ */
+uint32_t tc_xs_state_size ( void );
+
+/*!
+ * @brief Unmaps a log file.
+ *
+ * @param[in] file  scanner state.
+ *
+ * @return None.
+ */
+void tc_xs_close ( tc_xs_file_t *file );
+
+#endif /* TC_XMLSCAN_H */
+
+/*** end of file ***/
@@ -15,7 +15,11 @@
 #include <stdint.h>
 
 #include "sut/circular_queue.h"
+#include "cq_trace.h"
 #include "test_controller.h"
+#include "test_random.h"
+#include "test_param.h"
+#include "tc_perf.h"
 
 /******************************************************************************
  * 					Common typedef / macro definitions
@@ -25,6 +29,11 @@
 
 #define Q_SIZE CQ_SIZE
 
+/* Vector file of parametrized test cases, relative to working directory */
+#ifndef CQ_VECTORS_FILE
+#define CQ_VECTORS_FILE "data/cq_vectors.bin"
+#endif
+
 /* Defines test case run states
 */
 typedef enum TEST_CASE_STATES {
@@ -41,16 +50,22 @@ typedef enum TEST_CASE_STATES {
  * 						Private variable declarations
 ******************************************************************************/
 
-static cq_t q[2]; /* Create 2 circular queues */
+static TC_FIXTURE_DECLARE(cq_t, 2) q_zone; /* Create 2 circular queues in guarded storage */
 static cq_t *tc_data; /* pointer to data for test cases */
 static test_case_states_t test_case_state; /* test case run states */
 static bool test_result; /* stores test result */
 
+static const tp_param_t *tc_param; /* parameters of parametrized test cases */
+
+/* randomized differential test: 10000 sequences of 64 operations */
+static const tr_config_t tr_config = { .seed = 1, .iterations = 10000, .ops_per_seq = 64 };
+
 /******************************************************************************
  * 						Private function declarations
 ******************************************************************************/
 
 static bool test_case_init ( void *test_input_data );
+static bool test_case_param_init ( void *test_input_data );
 static void test_case_1_run ( void );
 static void test_case_2_run ( void );
 static void test_case_3_run ( void );
@@ -60,6 +75,8 @@ static void test_case_6_run ( void );
 static void test_case_7_run ( void );
 static void test_case_8_run ( void );
 static void test_case_9_run ( void );
+static void test_case_10_run ( void );
+static void perf_fill_drain ( void *ctx );
 
 
 
@@ -67,6 +84,15 @@ static void test_case_9_run ( void );
  * 							Test case List
 ******************************************************************************/
 
+/* Queue operation cases only run once cq_init passed on their queue */
+static const uint32_t q1_deps[] = { 0 }; 		/* q1_init */
+static const uint32_t q2_deps[] = { 8 }; 		/* q2_init */
+static const uint32_t q1_q2_deps[] = { 0, 8 };
+
+/* enqueue/dequeue throughput: fill and drain Q1, defaults for the rest */
+static const tc_perf_t perf_config = { .p_body_fn = perf_fill_drain, .p_ctx = (void *)&q_zone.obj[0],
+									   .key = "cq_fill_drain", .ops = 2u * ( Q_SIZE - 1u ) };
+
 test_case_t test_case_list_1 [] = {
 	
 	/* Q1 *******************************************/
@@ -74,56 +100,71 @@ test_case_t test_case_list_1 [] = {
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_1_run,
-		.p_input_data = (void *)&q[0]
+		.p_input_data = (void *)&q_zone.obj[0],
+		.name = "q1_init"
 	},
 	
 	/* Test case to test cq_enqueue functionality */
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_2_run,
-		.p_input_data = (void *)&q[0]
+		.p_input_data = (void *)&q_zone.obj[0],
+		.name = "q1_enqueue",
+		TC_DEPENDS_ON(q1_deps)
 	},
 	
 	/* Test case to test cq_dequeue functionality */
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_3_run,
-		.p_input_data = (void *)&q[0]
+		.p_input_data = (void *)&q_zone.obj[0],
+		.name = "q1_dequeue",
+		TC_DEPENDS_ON(q1_deps)
 	},
 	
 	/* Test case to test cq_is_empty functionality */
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_4_run,
-		.p_input_data = (void *)&q[0]
+		.p_input_data = (void *)&q_zone.obj[0],
+		.name = "q1_is_empty",
+		TC_DEPENDS_ON(q1_deps)
 	},
 	
 	/* Test case to test return value of cq_enqueue as CQ_OK */
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_5_run,
-		.p_input_data = (void *)&q[0]
+		.p_input_data = (void *)&q_zone.obj[0],
+		.name = "q1_enqueue_ok",
+		TC_DEPENDS_ON(q1_deps)
 	},
 	
 	/* Test case to test return value of cq_enqueue as CQ_IS_FULL */
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_6_run,
-		.p_input_data = (void *)&q[0]
+		.p_input_data = (void *)&q_zone.obj[0],
+		.name = "q1_enqueue_full",
+		TC_DEPENDS_ON(q1_deps)
 	},
 	
 	/* Test case to test return value of cq_dequeue as CQ_OK */
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_7_run,
-		.p_input_data = (void *)&q[0]
+		.p_input_data = (void *)&q_zone.obj[0],
+		.name = "q1_dequeue_ok",
+		TC_DEPENDS_ON(q1_deps)
 	},
 	
 	/* Test case to test return value of cq_dequeue as CQ_IS_EMPTY */
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_8_run,
-		.p_input_data = (void *)&q[0]
+		.p_input_data = (void *)&q_zone.obj[0],
+		.name = "q1_dequeue_empty",
+		TC_DEPENDS_ON(q1_deps)
 	},
 	
 	
@@ -132,56 +173,71 @@ test_case_t test_case_list_1 [] = {
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_1_run,
-		.p_input_data = (void *)&q[1]
+		.p_input_data = (void *)&q_zone.obj[1],
+		.name = "q2_init"
 	},
 	
 	/* Test case to test cq_enqueue functionality */
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_2_run,
-		.p_input_data = (void *)&q[1]
+		.p_input_data = (void *)&q_zone.obj[1],
+		.name = "q2_enqueue",
+		TC_DEPENDS_ON(q2_deps)
 	},
 	
 	/* Test case to test cq_dequeue functionality */
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_3_run,
-		.p_input_data = (void *)&q[1]
+		.p_input_data = (void *)&q_zone.obj[1],
+		.name = "q2_dequeue",
+		TC_DEPENDS_ON(q2_deps)
 	},
 	
 	/* Test case to test cq_is_empty functionality */
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_4_run,
-		.p_input_data = (void *)&q[1]
+		.p_input_data = (void *)&q_zone.obj[1],
+		.name = "q2_is_empty",
+		TC_DEPENDS_ON(q2_deps)
 	},
 	
 	/* Test case to test return value of cq_enqueue as CQ_OK */
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_5_run,
-		.p_input_data = (void *)&q[1]
+		.p_input_data = (void *)&q_zone.obj[1],
+		.name = "q2_enqueue_ok",
+		TC_DEPENDS_ON(q2_deps)
 	},
 	
 	/* Test case to test return value of cq_enqueue as CQ_IS_FULL */
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_6_run,
-		.p_input_data = (void *)&q[1]
+		.p_input_data = (void *)&q_zone.obj[1],
+		.name = "q2_enqueue_full",
+		TC_DEPENDS_ON(q2_deps)
 	},
 	
 	/* Test case to test return value of cq_dequeue as CQ_OK */
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_7_run,
-		.p_input_data = (void *)&q[1]
+		.p_input_data = (void *)&q_zone.obj[1],
+		.name = "q2_dequeue_ok",
+		TC_DEPENDS_ON(q2_deps)
 	},
 	
 	/* Test case to test return value of cq_dequeue as CQ_IS_EMPTY */
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_8_run,
-		.p_input_data = (void *)&q[1]
+		.p_input_data = (void *)&q_zone.obj[1],
+		.name = "q2_dequeue_empty",
+		TC_DEPENDS_ON(q2_deps)
 	},
 	
 	/*******************************************************/
@@ -189,15 +245,71 @@ test_case_t test_case_list_1 [] = {
 	{
 		.p_tc_init_fn = test_case_init,
 		.p_tc_run_fn = test_case_9_run,
-		.p_input_data = (void *)q
+		.p_input_data = (void *)q_zone.obj,
+		.name = "q1_q2_isolation",
+		.fixture_size = sizeof(q_zone.obj),
+		TC_DEPENDS_ON(q1_q2_deps)
+	},
+	
+	/*******************************************************/
+	/* Randomized differential test against reference queue model */
+	{
+		.p_tc_init_fn = tr_tc_init,
+		.p_tc_run_fn = tr_tc_run,
+		.p_input_data = (void *)&tr_config,
+		.name = "cq_random"
+	},
+	
+	/*******************************************************/
+	/* Enqueue/dequeue throughput, gated against its stored baseline */
+	{
+		.p_tc_init_fn = tc_perf_init,
+		.p_tc_run_fn = tc_perf_run,
+		.p_input_data = (void *)&perf_config,
+		.name = "cq_perf_fill_drain",
+		.p_fixture = (void *)&q_zone.obj[0]
 	},
 	
 	
 };
 
+/******************************************************************************
+ * 						Parametrized test case suite
+******************************************************************************/
+
+static void *param_fixtures[] = { (void *)&q_zone.obj[0], (void *)&q_zone.obj[1] };
+static const uint32_t param_capacities[] = { 1, Q_SIZE / 2, Q_SIZE };
+
+/* Test case to test FIFO order over every queue x fill level x input vector */
+static tp_suite_t param_suite = {
+	.name = "cq_fifo",
+	.p_tc_init_fn = test_case_param_init,
+	.p_tc_run_fn = test_case_10_run,
+	.p_fixtures = param_fixtures,
+	.total_fixtures = sizeof(param_fixtures)/sizeof(param_fixtures[0]),
+	.p_capacities = param_capacities,
+	.total_capacities = sizeof(param_capacities)/sizeof(param_capacities[0]),
+	.vectors_file = CQ_VECTORS_FILE
+};
+
+static tc_fixture_t fixtures[] = { TC_FIXTURE_INIT(q_zone) };
+
+/* Per case allocations (tc_alloc), reset after every case */
+static uint8_t arena_mem[4096];
+static tc_arena_t arena = TC_ARENA_INIT(arena_mem);
+
+static tc_gen_t param_gen = { .p_count_fn = tp_count, 
+							  .p_gen_fn = tp_generate, 
+							  .p_gen_data = (void *)&param_suite 
+							};
+
 // test case init data
 tc_init_t tc_init_data = { .tc = test_case_list_1, 
-							.total_test_cases = sizeof(test_case_list_1)/sizeof(test_case_list_1[0]) 
+							.total_test_cases = sizeof(test_case_list_1)/sizeof(test_case_list_1[0]),
+							.p_gen = &param_gen,
+							.p_fixtures = fixtures,
+							.total_fixtures = sizeof(fixtures)/sizeof(fixtures[0]),
+							.p_arena = &arena
 						};
 
 /******************************************************************************
@@ -223,6 +335,20 @@ static bool test_case_init ( void *test_input_data )
 	return true;
 }
 
+/*!
+ * @brief this function initializes parametrized test case.
+ *	Input data holds fixture, capacity and input vector of the case.
+ * @param[in] test_input_data  pointer to tp_param_t.
+ *
+ * @return initilaization status. true or false.
+ */
+static bool test_case_param_init ( void *test_input_data )
+{
+	tc_param = (const tp_param_t *) test_input_data;
+	
+	return test_case_init ( tc_param->p_fixture );
+}
+
 
 /******************************************************************************
  * 								Test case Run
@@ -810,6 +936,109 @@ static void test_case_9_run ( void )
 	
 }
 
+/*! UNIT TESTING (parametrized)
+ * @brief this function tests FIFO order of cq_enqueue()/cq_dequeue().
+ *	Pre-condition: queue is initialized
+ *  Description: enqueue 'capacity' values from input vector (repeated if 
+ *				 vector is shorter), then dequeue them all and one more
+ *  Expected Output: every enqueue returns CQ_OK, values are dequeued in 
+ *					enqueue order, last dequeue returns CQ_IS_EMPTY
+ * @param[in] None.
+ *
+ * @return None.
+ */
+static void test_case_10_run ( void )
+{
+	static cq_status_t stat;
+	cq_val_t val;
+	
+	switch ( test_case_state )
+	{
+		case TEST_CASE_INIT:
+			/* Initialize test case */
+			cq_init ( tc_data );
+			stat = CQ_OK;
+			test_result = true;
+			
+			test_case_state = TEST_CASE_RUN;
+			break;
+		
+		case TEST_CASE_RUN:
+			/* fill queue up to capacity parameter */
+			for ( uint32_t v=0; ( v < tc_param->capacity ) && ( CQ_OK == stat ); v++ )
+			{
+				stat = cq_enqueue( tc_data, tc_param->p_vector[v % tc_param->vec_len] );
+			}
+			test_case_state = TEST_CASE_VERIFY;
+			break;
+		
+		case TEST_CASE_VERIFY:
+			if ( CQ_OK != stat )
+			{
+				test_result = false;
+				tc_log_message ("ERROR", "cq_enqueue() didn't return OK below capacity");
+			}
+			
+			/* values should come back in enqueue order */
+			for ( uint32_t v=0; ( v < tc_param->capacity ) && ( true == test_result ); v++ )
+			{
+				val = (cq_val_t)~tc_param->p_vector[v % tc_param->vec_len];
+				if ( ( CQ_OK != cq_dequeue( tc_data, &val ) ) || 
+					 ( val != tc_param->p_vector[v % tc_param->vec_len] ) )
+				{
+					test_result = false;
+					tc_log_message ("ERROR", "cq_dequeue() didn't return values in FIFO order");
+				}
+			}
+			
+			if ( ( true == test_result ) && ( CQ_IS_EMPTY != cq_dequeue( tc_data, &val ) ) )
+			{
+				test_result = false;
+				tc_log_message ("ERROR", "cq_dequeue() didn't return EMPTY after all values were read");
+			}
+			
+			test_case_state = TEST_CASE_LOG_RESULT;
+			break;
+		
+		case TEST_CASE_LOG_RESULT:
+			/* log test case result */
+			tc_log_result ( test_result );
+			test_case_state = TEST_CASE_IDLE;
+			break;
+		
+		case TEST_CASE_IDLE:
+			break;
+		
+		default:
+			break;
+	}
+	
+}
+
+/*! PERFORMANCE TESTING
+ * @brief this function is the measured body of the throughput test case.
+ *  Description: initialize the queue, enqueue Q_SIZE-1 values and dequeue
+ *  them again
+ * @param[in] ctx  queue.
+ *
+ * @return None.
+ */
+static void perf_fill_drain ( void *ctx )
+{
+	cq_t *q = (cq_t *)ctx;
+	cq_val_t val;
+	
+	cq_init ( q );
+	for ( uint32_t v=0; v < ( Q_SIZE - 1u ); v++ )
+	{
+		(void)cq_enqueue ( q, (cq_val_t)v );
+	}
+	for ( uint32_t v=0; v < ( Q_SIZE - 1u ); v++ )
+	{
+		(void)cq_dequeue ( q, &val );
+	}
+}
+
 /*** end of file ***/
 
 
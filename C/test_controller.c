@@ -6,19 +6,142 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+
+#ifdef TC_HEAP_CHECK
+#include <malloc.h>
+#endif
+
+#ifdef TC_FORK_SERVER
+#include <poll.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 #include "test_controller.h"
+#include "tc_guard.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define TC_PRINT_SIZE	256u 	/* longest console output line */
+#define TC_CMD_SIZE		32u 	/* longest console command line */
+
+#ifdef TC_FORK_SERVER
+#ifndef TC_FORK_TIMEOUT
+#define TC_FORK_TIMEOUT	10000 	/* ms a forked test case may run */
+#endif
+#ifndef TC_RERUN_MAX
+#define TC_RERUN_MAX	32u 	/* parallel reruns of a failed case */
+#endif
+#ifndef TC_JOBS_MAX
+#define TC_JOBS_MAX		16u 	/* concurrently scheduled cases */
+#endif
+#define TC_JOB_OUT		4096u 	/* console output buffered per concurrent case */
+
+/* Defines a concurrently running test case, see tc_set_jobs()
+*/
+typedef struct TC_JOB {
+	
+	pid_t 		pid; 		/* 0 = free slot */
+	int 		fd; 		/* read side of its console pipe */
+	uint32_t 	index;
+	struct timespec start;
+	bool 		timed_out;
+	uint32_t 	len;
+	bool 		truncated;
+	char 		out[TC_JOB_OUT];
+	
+} tc_job_t;
+#endif
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static void _tc_printf ( const char *fmt, ... );
+static void _stdout_write ( const uint8_t *data, uint32_t len );
+static void _console_poll ( void );
+static void _console_command ( const char *cmd );
+static void _case_result ( bool pass );
+static void _case_verdict ( bool pass );
+static void _case_end ( void );
+static bool _dag_next ( uint32_t *p_index );
+static void _dag_skip_rest ( const char *reason );
+static void _metrics_reset ( void );
+static void _metrics_publish ( tc_state_t prev );
+static void _timeline_event ( const char *name, char phase, uint32_t index, const char *text );
+static void _timeline_state ( tc_state_t prev, tc_state_t next );
+#ifdef TC_FORK_SERVER
+static void _fork_case ( void );
+static int64_t _ms_since ( const struct timespec *start );
+static void _fork_write ( const uint8_t *data, uint32_t len );
+static void _rerun_case ( void );
+static void _rerun_worker ( uint32_t worker );
+static void _null_write ( const uint8_t *data, uint32_t len );
+static void _jobs_tasks ( void );
+static void _job_start ( tc_job_t *job, uint32_t index );
+static bool _jobs_collect ( void );
+static void _job_report ( tc_job_t *job, int wstat );
+static void _jobs_kill ( void );
+#endif
 
 /******************************************************************************
  * 						Private variable declarations
 ******************************************************************************/
 
-static test_case_t *p_test_list;
+static const tc_transport_t stdout_transport = { .p_write_fn = _stdout_write };
+static const tc_transport_t *p_transport = &stdout_transport;
+static char print_buff[TC_PRINT_SIZE];
+static char cmd_buff[TC_CMD_SIZE];
+static uint32_t cmd_len;
+
+static tc_result_fn_t p_result_listener;
+static tc_init_t *p_test_list;
+static test_case_t curr_test;
+static uint32_t curr_index;
 static uint32_t total_tests;
 static uint32_t test_counter;
 static bool test_result_logged;
+static uint32_t tests_passed;
+static uint32_t tests_failed;
+static uint32_t tests_skipped;
+static uint32_t dag_total; /* cases covered by p_case_state */
+static uint32_t dag_first; /* run position of first case not yet decided */
+#ifdef TC_HEAP_CHECK
+static size_t heap_before; /* heap in use when current case started */
+#endif
 static tc_state_t tc_state;
 
+static tc_metrics_t *p_metrics;
+static tc_clock_fn_t p_metrics_clock;
+static uint64_t state_since; /* clock when tc_state was entered */
+
+static tc_timeline_t *p_timeline;
+static tc_clock_fn_t p_timeline_clock;
+static uint16_t timeline_lane;
+static const char *const state_names[] = { "TC_IDLE", "TC_INIT", "TC_INIT_WAIT", "TC_RUN",
+										   "TC_RUN_WAIT", "TC_COMPLETE" };
+
+#ifdef TC_FORK_SERVER
+static bool fork_mode;
+static int fork_fd = -1; /* child side of output pipe */
+static const tc_transport_t fork_transport = { .p_write_fn = _fork_write };
+static const tc_transport_t null_transport = { .p_write_fn = _null_write };
+static uint32_t rerun_count;
+static tc_rerun_fn_t p_rerun_listener;
+static bool rerun_pending; /* current case failed, verdict after reruns */
+static uint32_t tests_flaky;
+static uint32_t jobs_max; /* concurrent cases, 0 or 1 = one at a time */
+static uint32_t jobs_running;
+static tc_job_t jobs[TC_JOBS_MAX];
+#endif
+
 /******************************************************************************
  * 						Public function definitions
 ******************************************************************************/
@@ -28,10 +151,51 @@ static tc_state_t tc_state;
  */
 void tc_init ( tc_init_t *tc_init )
 {
-	p_test_list = tc_init->tc;
-	total_tests = tc_init->total_test_cases;
+	tc_state_t prev = tc_state;
+	
+	p_test_list = tc_init;
+	if ( NULL != tc_init->p_order )
+	{
+		total_tests = tc_init->total_order;
+	}
+	else
+	{
+		total_tests = tc_get_total ( tc_init );
+	}
 	test_counter = 0;
 	test_result_logged = false;
+	tests_passed = 0;
+	tests_failed = 0;
+	tests_skipped = 0;
+#ifdef TC_FORK_SERVER
+	tests_flaky = 0;
+	rerun_pending = false;
+#endif
+	
+	if ( NULL != tc_init->p_arena )
+	{
+		tc_init->p_arena->used = 0;
+	}
+	
+	/* Selected cases are pending for the dependency scheduler */
+	if ( NULL != tc_init->p_case_state )
+	{
+		dag_total = tc_get_total ( tc_init );
+		dag_first = 0;
+		memset ( tc_init->p_case_state, TC_CASE_UNSELECTED, dag_total );
+		for ( uint32_t i = 0; i < total_tests; i++ )
+		{
+			uint32_t idx = ( NULL != tc_init->p_order ) ? tc_init->p_order[i] : i;
+			
+			if ( idx < dag_total )
+			{
+				tc_init->p_case_state[idx] = TC_CASE_PENDING;
+			}
+		}
+	}
+	
+	/* Arm guard zones around fixtures */
+	tc_guard_arm ( tc_init->p_fixtures, tc_init->total_fixtures );
 	
 	if ( total_tests > 0 )
 	{
@@ -41,6 +205,8 @@ void tc_init ( tc_init_t *tc_init )
 	{
 		tc_state = TC_IDLE;
 	}
+	_timeline_state ( prev, tc_state );
+	_metrics_reset ();
 }
 
 /* This function maintains the test exeution states and performs respective
@@ -48,21 +214,77 @@ void tc_init ( tc_init_t *tc_init )
  */
 void tc_tasks ( void )
 {
+	tc_state_t prev = tc_state;
+	bool found;
+	
+	/* Handle pending console commands */
+	_console_poll ();
+	
 	switch ( tc_state )
 	{		
 		case TC_INIT:
-			printf ("Executing test number: %d of %d\r\n", 
-					(unsigned int)(test_counter+1), (unsigned int)total_tests);
-			tc_state = TC_INIT_WAIT;
+			/* Fetch (or generate) next test case in the list */
+			curr_index = test_counter;
+			if ( NULL != p_test_list->p_case_state )
+			{
+#ifdef TC_FORK_SERVER
+				if ( jobs_max > 1u )
+				{
+					/* concurrent cases, stays in TC_INIT until all are done */
+					_jobs_tasks ();
+					break;
+				}
+#endif
+				if ( false == _dag_next ( &curr_index ) )
+				{
+					_dag_skip_rest ("dependency cycle");
+					tc_state = TC_IDLE;
+					break;
+				}
+				p_test_list->p_case_state[curr_index] = TC_CASE_RUNNING;
+			}
+			else if ( NULL != p_test_list->p_order )
+			{
+				curr_index = p_test_list->p_order[test_counter];
+			}
+			found = tc_get_test_case ( p_test_list, curr_index, &curr_test );
+			/* position varies with order and scheduling, index and name
+			   identify the case */
+			_tc_printf ("Executing test number: %d of %d, case %u (%s)\r\n", 
+					(unsigned int)(test_counter+1), (unsigned int)total_tests, (unsigned int)curr_index,
+					( ( true == found ) && ( NULL != curr_test.name ) ) ? curr_test.name : "-");
+			if ( true == found )
+			{
+				/* Take before image of fixtures */
+				tc_guard_snapshot ( p_test_list->p_fixtures, p_test_list->total_fixtures );
+#ifdef TC_HEAP_CHECK
+				heap_before = mallinfo2 ().uordblks;
+#endif
+				tc_state = TC_INIT_WAIT;
+			}
+			else
+			{
+				tc_log_message ("ERROR", "invalid test case index");
+				tc_state = TC_COMPLETE;
+			}
 			test_result_logged = false;
+#ifdef TC_FORK_SERVER
+			if ( ( true == fork_mode ) && ( TC_INIT_WAIT == tc_state ) )
+			{
+				/* Case runs in a child, result is final on return */
+				_fork_case ();
+			}
+#endif
 			break;
 			
 		case TC_INIT_WAIT:
 			/* Initilaize next test case in the list */
-			if ( p_test_list->p_tc_init_fn( p_test_list->p_input_data ) == true )
+			_timeline_event ("init", 'B', curr_index, NULL);
+			if ( curr_test.p_tc_init_fn( curr_test.p_input_data ) == true )
 			{
 				tc_state = TC_RUN_WAIT;
 			}
+			_timeline_event ("init", 'E', curr_index, NULL);
 			break;
 			
 		case TC_RUN_WAIT:
@@ -70,7 +292,9 @@ void tc_tasks ( void )
 			   result is not logged */
 			if (  false == test_result_logged )
 			{
-				p_test_list->p_tc_run_fn();
+				_timeline_event ("run", 'B', curr_index, NULL);
+				curr_test.p_tc_run_fn();
+				_timeline_event ("run", 'E', curr_index, NULL);
 			}
 			else
 			{
@@ -79,10 +303,22 @@ void tc_tasks ( void )
 			break;
 			
 		case TC_COMPLETE:
+#ifdef TC_FORK_SERVER
+			if ( true == rerun_pending )
+			{
+				_rerun_case ();
+			}
+#endif
 			/* Mark current test case completed and go to next test case */
+			if ( ( NULL != p_test_list->p_case_state ) && ( curr_index < dag_total ) &&
+				 ( TC_CASE_RUNNING == p_test_list->p_case_state[curr_index] ) )
+			{
+				/* no result logged */
+				p_test_list->p_case_state[curr_index] = TC_CASE_FAIL;
+			}
+			_case_end ();
 			test_counter++;
-			p_test_list++;
-			printf ("Test %d completed\r\n", (unsigned int)test_counter);
+			_tc_printf ("Test %d completed\r\n", (unsigned int)test_counter);
 			if ( test_counter  < total_tests )
 			{
 				tc_state = TC_INIT;
@@ -100,31 +336,1117 @@ void tc_tasks ( void )
 		default:
 			break;
 	}
+	
+	if ( prev != tc_state )
+	{
+		_timeline_state ( prev, tc_state );
+		_metrics_publish ( prev );
+	}
 }
 
-/* This function logs test case result
+/* This function logs test case result. A case which damaged guard zones or
+ * fixture memory it doesn't own fails regardless of its own verdict.
  */
-void tc_log_result ( const bool pass )
+void tc_log_result ( bool pass )
 {
+	void *p_owned = curr_test.p_fixture;
+	
+	if ( NULL == p_owned )
+	{
+		p_owned = curr_test.p_input_data;
+	}
+	_timeline_event ("verify", 'B', curr_index, NULL);
+	if ( false == tc_guard_verify ( p_test_list->p_fixtures, p_test_list->total_fixtures,
+									p_owned, curr_test.fixture_size ) )
+	{
+		pass = false;
+	}
+	_timeline_event ("verify", 'E', curr_index, NULL);
+	_timeline_event ("result", 'i', curr_index, ( true == pass ) ? "PASS" : "FAIL");
+	
 	test_result_logged = true;
-	printf ("Test Result: ");
+	_tc_printf ("Test Result: ");
 	if ( true == pass )
 	{
-		printf ("PASS\r\n");
+		_tc_printf ("PASS\r\n");
 	}
 	else
 	{
-		printf ("FAIL\r\n");
+		_tc_printf ("FAIL\r\n");
 	}
-		
+	
+	_case_result ( pass );
 }
 
 /* This function logs messages
 */
 void tc_log_message ( const char *tag, const char *msg )
 {
-	printf ("[%s] %s\r\n", tag, msg);
+	_tc_printf ("[%s] %s\r\n", tag, msg);
+	_timeline_event (tag, 'i', ( TC_IDLE != tc_state ) ? curr_index : TC_TL_NO_CASE, msg);
+}
+
+/* This function allocates running test case memory from the arena
+*/
+void *tc_alloc ( uint32_t size )
+{
+	tc_arena_t *arena = ( NULL != p_test_list ) ? p_test_list->p_arena : NULL;
+	uint32_t pad;
+	void *p;
+	
+	if ( NULL == arena )
+	{
+		return NULL;
+	}
+	pad = (uint32_t)( -(uintptr_t)( arena->p_mem + arena->used ) ) & ( TC_ARENA_ALIGN - 1u );
+	if ( ( arena->size - arena->used ) < pad ||
+		 ( arena->size - arena->used - pad ) < size )
+	{
+		tc_log_message ("ERROR", "test case arena exhausted");
+		return NULL;
+	}
+	p = arena->p_mem + arena->used + pad;
+	arena->used += pad + size;
+	
+	return p;
+}
+
+/* This function logs a skipped test case with the reason
+*/
+void tc_log_skip ( uint32_t index, const char *reason )
+{
+	test_case_t tc;
+	const char *name = "-";
+	
+	if ( ( NULL != p_test_list ) && ( true == tc_get_test_case ( p_test_list, index, &tc ) ) &&
+		 ( NULL != tc.name ) )
+	{
+		name = tc.name;
+	}
+	tests_skipped++;
+	if ( ( NULL != p_test_list ) && ( NULL != p_test_list->p_case_state ) && ( index < dag_total ) )
+	{
+		p_test_list->p_case_state[index] = TC_CASE_SKIP;
+	}
+	_tc_printf ("Skipped test case: %u (%s), %s\r\n", (unsigned int)index, name, reason);
+	_tc_printf ("Test Result: SKIP\r\n");
+	_timeline_event ("skip", 'i', index, reason);
+	_metrics_publish ( tc_state );
+}
+
+/* This function selects console transport
+ */
+void tc_set_transport ( const tc_transport_t *transport )
+{
+	p_transport = ( NULL != transport ) ? transport : &stdout_transport;
+}
+
+/* This function sets test case result listener
+ */
+void tc_set_result_listener ( tc_result_fn_t listener )
+{
+	p_result_listener = listener;
+}
+
+/* This function sets live metrics block
+ */
+void tc_set_metrics ( tc_metrics_t *block, tc_clock_fn_t clock_fn )
+{
+	p_metrics = block;
+	p_metrics_clock = clock_fn;
+	_metrics_reset ();
+}
+
+/* This function sets timeline recorder
+ */
+void tc_set_timeline ( tc_timeline_t *timeline, tc_clock_fn_t clock_fn )
+{
+	p_timeline = ( ( NULL != timeline ) && ( timeline->size > 0 ) ) ? timeline : NULL;
+	p_timeline_clock = clock_fn;
+}
+
+/* This function stops the test run
+ */
+void tc_abort ( void )
+{
+	tc_state_t prev = tc_state;
+	
+#ifdef TC_FORK_SERVER
+	if ( true == rerun_pending )
+	{
+		/* no reruns for an abandoned case */
+		rerun_pending = false;
+		tests_failed++;
+		if ( NULL != p_result_listener )
+		{
+			p_result_listener ( curr_index, curr_test.name, false );
+		}
+	}
+	_jobs_kill ();
+#endif
+	tc_state = TC_IDLE;
+	_timeline_state ( prev, tc_state );
+	_metrics_publish ( prev );
+}
+
+#ifdef TC_FORK_SERVER
+/* This function enables per test case process isolation
+ */
+void tc_set_fork_mode ( bool enable )
+{
+	fork_mode = enable;
+}
+
+/* This function enables reruns of failed test cases
+ */
+void tc_set_rerun ( uint32_t reruns, tc_rerun_fn_t listener )
+{
+	rerun_count = ( reruns < TC_RERUN_MAX ) ? reruns : TC_RERUN_MAX;
+	p_rerun_listener = listener;
+}
+
+/* This function enables concurrent dependency scheduling
+ */
+void tc_set_jobs ( uint32_t jobs )
+{
+	jobs_max = ( jobs < TC_JOBS_MAX ) ? jobs : TC_JOBS_MAX;
+}
+
+/* This function returns number of flaky test cases
+*/
+uint32_t tc_get_flaky_count ( void )
+{
+	return tests_flaky;
+}
+#endif
+
+/* This function returns number of static and generated test cases
+*/
+uint32_t tc_get_total ( const tc_init_t *tc_init )
+{
+	uint32_t total = tc_init->total_test_cases;
+	
+	if ( NULL != tc_init->p_gen )
+	{
+		total += tc_init->p_gen->p_count_fn ( tc_init->p_gen->p_gen_data );
+	}
+	
+	return total;
+}
+
+/* This function returns test case from static list or, past its end, from
+ * the generator
+ */
+bool tc_get_test_case ( const tc_init_t *tc_init, uint32_t index, test_case_t *tc )
+{
+	bool stat = false;
+	
+	if ( index < tc_init->total_test_cases )
+	{
+		*tc = tc_init->tc[index];
+		stat = true;
+	}
+	else if ( NULL != tc_init->p_gen )
+	{
+		/* fields a generator doesn't know of stay unset */
+		memset ( tc, 0, sizeof(*tc) );
+		stat = tc_init->p_gen->p_gen_fn ( tc_init->p_gen->p_gen_data, 
+						index - tc_init->total_test_cases, tc );
+	}
+	
+	return stat;
+}
+
+/* This function returns true when there is no pending test case
+*/
+bool tc_is_idle ( void )
+{
+	return ( TC_IDLE == tc_state );
+}
+
+/* This function returns index of test case being executed
+*/
+uint32_t tc_get_test_index ( void )
+{
+	return curr_index;
+}
+
+/* This function returns number of failed test cases
+*/
+uint32_t tc_get_fail_count ( void )
+{
+	return tests_failed;
+}
+
+/* This function returns number of skipped test cases
+*/
+uint32_t tc_get_skip_count ( void )
+{
+	return tests_skipped;
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function formats console output and sends it over transport
+ */
+static void _tc_printf ( const char *fmt, ... )
+{
+	va_list args;
+	int len;
+	
+	va_start ( args, fmt );
+	len = vsnprintf ( print_buff, TC_PRINT_SIZE, fmt, args );
+	va_end ( args );
+	
+	if ( len > 0 )
+	{
+		if ( len >= (int)TC_PRINT_SIZE )
+		{
+			len = TC_PRINT_SIZE - 1;
+		}
+		p_transport->p_write_fn ( (const uint8_t *)print_buff, (uint32_t)len );
+	}
+}
+
+/* This function is default transport output
+ */
+static void _stdout_write ( const uint8_t *data, uint32_t len )
+{
+	fwrite ( data, 1, len, stdout );
+}
+
+/* This function collects received bytes into command lines
+ */
+static void _console_poll ( void )
+{
+	uint8_t rx[16];
+	uint32_t len;
+	
+	if ( NULL == p_transport->p_read_fn )
+	{
+		return;
+	}
+	
+	while ( ( len = p_transport->p_read_fn ( rx, sizeof(rx) ) ) > 0 )
+	{
+		for ( uint32_t i = 0; i < len; i++ )
+		{
+			if ( ( '\r' == rx[i] ) || ( '\n' == rx[i] ) )
+			{
+				cmd_buff[cmd_len] = '\0';
+				if ( cmd_len > 0 )
+				{
+					_console_command ( cmd_buff );
+				}
+				cmd_len = 0;
+			}
+			else if ( cmd_len < ( TC_CMD_SIZE - 1u ) )
+			{
+				cmd_buff[cmd_len++] = (char)rx[i];
+			}
+		}
+	}
+}
+
+/* This function executes a console command
+ */
+static void _console_command ( const char *cmd )
+{
+	if ( 0 == strcmp ( cmd, "status" ) )
+	{
+		_tc_printf ("Status: state %u, test %u of %u, failed %u\r\n", (unsigned int)tc_state,
+				(unsigned int)test_counter, (unsigned int)total_tests, (unsigned int)tests_failed);
+	}
+	else if ( 0 == strcmp ( cmd, "abort" ) )
+	{
+		tc_abort ();
+		_tc_printf ("Test run aborted\r\n");
+	}
+	else if ( 0 == strcmp ( cmd, "run" ) )
+	{
+		/* restart configured list, or compiled-in one if none yet */
+		tc_init ( ( NULL != p_test_list ) ? p_test_list : &tc_init_data );
+	}
+	else
+	{
+		tc_log_message ("ERROR", "unknown console command");
+	}
+}
+
+/* This function counts final result of current test case and reports it to
+ * the listener. In rerun mode a failure is only final after reruns.
+ */
+static void _case_result ( bool pass )
+{
+#ifdef TC_FORK_SERVER
+	if ( ( false == pass ) && ( rerun_count > 0 ) )
+	{
+		rerun_pending = true;
+		return;
+	}
+#endif
+	_case_verdict ( pass );
+}
+
+/* This function counts final result of current test case, records it for
+ * the dependency scheduler and reports it to the listener
+ */
+static void _case_verdict ( bool pass )
+{
+	if ( false == pass )
+	{
+		tests_failed++;
+	}
+	else
+	{
+		tests_passed++;
+	}
+	if ( ( NULL != p_test_list->p_case_state ) && ( curr_index < dag_total ) )
+	{
+		p_test_list->p_case_state[curr_index] = ( true == pass ) ? TC_CASE_PASS : TC_CASE_FAIL;
+	}
+	if ( NULL != p_result_listener )
+	{
+		p_result_listener ( curr_index, curr_test.name, pass );
+	}
+}
+
+/* This function releases arena memory of completed test case and reports
+ * its usage, and with TC_HEAP_CHECK heap memory the case didn't free
+ */
+static void _case_end ( void )
+{
+	tc_arena_t *arena = p_test_list->p_arena;
+#ifdef TC_HEAP_CHECK
+	size_t heap_now = mallinfo2 ().uordblks;
+	
+	if ( heap_now > heap_before )
+	{
+		_tc_printf ("[WARNING] test case %u (%s) leaked %u bytes into the heap\r\n",
+				(unsigned int)curr_index, ( NULL != curr_test.name ) ? curr_test.name : "-",
+				(unsigned int)( heap_now - heap_before ));
+	}
+	heap_before = heap_now;
+#endif
+	if ( ( NULL != arena ) && ( arena->used > 0 ) )
+	{
+		_tc_printf ("Arena peak: %u of %u bytes\r\n", (unsigned int)arena->used,
+				(unsigned int)arena->size);
+		if ( arena->used > arena->peak )
+		{
+			arena->peak = arena->used;
+		}
+		arena->used = 0;
+	}
+}
+
+/* This function picks the first pending case in run order whose
+ * prerequisites all passed. Cases with a prerequisite which failed, was
+ * skipped or isn't part of the run are skipped on the way, repeatedly as a
+ * skip may decide cases earlier in the order. Returns false if no case is
+ * ready now.
+ */
+static bool _dag_next ( uint32_t *p_index )
+{
+	uint8_t *state = p_test_list->p_case_state;
+	test_case_t tc;
+	uint32_t idx;
+	uint32_t dep;
+	bool ready;
+	bool skipped;
+	char reason[48];
+	
+	do
+	{
+		/* decided cases at the front aren't scanned again */
+		for ( ; dag_first < total_tests; dag_first++ )
+		{
+			idx = ( NULL != p_test_list->p_order ) ? p_test_list->p_order[dag_first] : dag_first;
+			if ( ( idx < dag_total ) && ( TC_CASE_PENDING == state[idx] ) )
+			{
+				break;
+			}
+		}
+		skipped = false;
+		for ( uint32_t pos = dag_first; pos < total_tests; pos++ )
+		{
+			idx = ( NULL != p_test_list->p_order ) ? p_test_list->p_order[pos] : pos;
+			if ( ( idx >= dag_total ) || ( TC_CASE_PENDING != state[idx] ) )
+			{
+				continue;
+			}
+			ready = true;
+			if ( true == tc_get_test_case ( p_test_list, idx, &tc ) )
+			{
+				for ( uint32_t d = 0; ( d < tc.total_deps ) && ( TC_CASE_PENDING == state[idx] ); d++ )
+				{
+					dep = tc.p_deps[d];
+					if ( ( dep < dag_total ) && ( TC_CASE_PASS == state[dep] ) )
+					{
+						continue;
+					}
+					if ( ( dep < dag_total ) && ( ( TC_CASE_PENDING == state[dep] ) ||
+												  ( TC_CASE_RUNNING == state[dep] ) ) )
+					{
+						ready = false;
+						continue;
+					}
+					snprintf ( reason, sizeof(reason), "prerequisite %u not passed", (unsigned int)dep );
+					tc_log_skip ( idx, reason );
+					skipped = true;
+				}
+			}
+			if ( ( true == ready ) && ( TC_CASE_PENDING == state[idx] ) )
+			{
+				*p_index = idx;
+				return true;
+			}
+		}
+	} while ( true == skipped );
+	
+	return false;
+}
+
+/* This function skips every case still pending, when no case is ready and
+ * none is running their prerequisites can't complete
+ */
+static void _dag_skip_rest ( const char *reason )
+{
+	uint32_t idx;
+	
+	for ( uint32_t pos = dag_first; pos < total_tests; pos++ )
+	{
+		idx = ( NULL != p_test_list->p_order ) ? p_test_list->p_order[pos] : pos;
+		if ( ( idx < dag_total ) && ( TC_CASE_PENDING == p_test_list->p_case_state[idx] ) )
+		{
+			tc_log_skip ( idx, reason );
+		}
+	}
+}
+
+/* This function starts metrics of a new run
+ */
+static void _metrics_reset ( void )
+{
+	tc_metrics_t *m = p_metrics;
+	
+	if ( NULL == m )
+	{
+		return;
+	}
+	state_since = ( NULL != p_metrics_clock ) ? p_metrics_clock () : 0u;
+	
+	__atomic_store_n ( &m->seq, m->seq + 1u, __ATOMIC_RELAXED );
+	__atomic_thread_fence ( __ATOMIC_RELEASE );
+	m->magic = TC_METRICS_MAGIC;
+	m->version = TC_METRICS_VERSION;
+	m->size = sizeof(tc_metrics_t);
+	m->start_ns = state_since;
+	memset ( m->state_ns, 0, sizeof(m->state_ns) );
+	m->case_name[0] = '\0';
+	__atomic_store_n ( &m->seq, m->seq + 1u, __ATOMIC_RELEASE );
+	
+	_metrics_publish ( tc_state );
+}
+
+/* This function publishes progress after a state change, time since the
+ * previous change is accounted to state 'prev'. Readers see an odd sequence
+ * while the block is written.
+ */
+static void _metrics_publish ( tc_state_t prev )
+{
+	tc_metrics_t *m = p_metrics;
+	uint64_t now;
+	
+	if ( NULL == m )
+	{
+		return;
+	}
+	now = ( NULL != p_metrics_clock ) ? p_metrics_clock () : 0u;
+	
+	__atomic_store_n ( &m->seq, m->seq + 1u, __ATOMIC_RELAXED );
+	__atomic_thread_fence ( __ATOMIC_RELEASE );
+	if ( (uint32_t)prev < TC_METRICS_STATES )
+	{
+		m->state_ns[prev] += now - state_since;
+	}
+	state_since = now;
+	m->update_ns = now;
+	m->state = (uint32_t)tc_state;
+	m->case_index = curr_index;
+	m->completed = test_counter;
+	m->total = total_tests;
+	m->passed = tests_passed;
+	m->failed = tests_failed;
+	m->skipped = tests_skipped;
+#ifdef TC_FORK_SERVER
+	m->flaky = tests_flaky;
+#else
+	m->flaky = 0;
+#endif
+	if ( TC_INIT == prev )
+	{
+		/* next case fetched */
+		strncpy ( m->case_name, ( NULL != curr_test.name ) ? curr_test.name : "-",
+				  TC_METRICS_NAME - 1u );
+		m->case_name[TC_METRICS_NAME - 1u] = '\0';
+	}
+	__atomic_store_n ( &m->seq, m->seq + 1u, __ATOMIC_RELEASE );
+}
+
+/* This function records a timeline event in the next ring slot
+ */
+static void _timeline_event ( const char *name, char phase, uint32_t index, const char *text )
+{
+	tc_tl_event_t *ev;
+	uint32_t slot;
+	
+	if ( NULL == p_timeline )
+	{
+		return;
+	}
+	slot = __atomic_fetch_add ( &p_timeline->head, 1u, __ATOMIC_RELAXED ) % p_timeline->size;
+	ev = &p_timeline->p_events[slot];
+	ev->ts_ns = ( NULL != p_timeline_clock ) ? p_timeline_clock () : 0u;
+	/* copied, the caller's string may be gone (or in a child process) when
+	   the timeline is saved */
+	ev->name[0] = '\0';
+	if ( NULL != name )
+	{
+		strncpy ( ev->name, name, TC_TL_NAME - 1u );
+		ev->name[TC_TL_NAME - 1u] = '\0';
+	}
+	ev->index = index;
+	ev->lane = timeline_lane;
+	ev->phase = phase;
+	ev->text[0] = '\0';
+	if ( NULL != text )
+	{
+		strncpy ( ev->text, text, TC_TL_TEXT - 1u );
+		ev->text[TC_TL_TEXT - 1u] = '\0';
+	}
+}
+
+/* This function records a state change: end of previous state, begin of
+ * next one, and test case span from fetched case until leaving TC_COMPLETE
+ * (or abort)
+ */
+static void _timeline_state ( tc_state_t prev, tc_state_t next )
+{
+	if ( NULL == p_timeline )
+	{
+		return;
+	}
+	if ( TC_IDLE != prev )
+	{
+		_timeline_event (state_names[prev], 'E', TC_TL_NO_CASE, NULL);
+	}
+	if ( ( prev > TC_INIT ) && ( next <= TC_INIT ) )
+	{
+		_timeline_event (NULL, 'E', curr_index, NULL);
+	}
+	if ( ( prev <= TC_INIT ) && ( next > TC_INIT ) )
+	{
+		_timeline_event (NULL, 'B', curr_index, NULL);
+	}
+	if ( TC_IDLE != next )
+	{
+		_timeline_event (state_names[next], 'B', TC_TL_NO_CASE, NULL);
+	}
+}
+
+#ifdef TC_FORK_SERVER
+/* This function runs current test case in a copy-on-write child. The child
+ * executes init/run states, its console output is forwarded through a pipe
+ * and its verdict comes back as exit status, so fixture damage or a crash
+ * stays in the child. A killed or hanging child fails the case.
+ */
+static void _fork_case ( void )
+{
+	struct pollfd pfd;
+	uint8_t buff[256];
+	uint32_t failed = tests_failed;
+	struct timespec start;
+	int fds[2];
+	int wstat = 0;
+	bool timed_out = false;
+	ssize_t len;
+	pid_t pid;
+	bool pass;
+	
+	fflush ( NULL );
+	if ( 0 != pipe ( fds ) )
+	{
+		/* no isolation available, run case in process */
+		tc_log_message ("ERROR", "pipe failed, test case runs without isolation");
+		return;
+	}
+	pid = fork ();
+	if ( pid < 0 )
+	{
+		close ( fds[0] );
+		close ( fds[1] );
+		tc_log_message ("ERROR", "fork failed, test case runs without isolation");
+		return;
+	}
+	
+	if ( 0 == pid )
+	{
+		close ( fds[0] );
+		fork_fd = fds[1];
+		p_transport = &fork_transport;
+		p_result_listener = NULL;
+		p_metrics = NULL;
+		rerun_count = 0;
+		timeline_lane = TC_TL_LANE_FORK;
+		_timeline_state ( TC_IDLE, tc_state );
+		while ( ( TC_COMPLETE != tc_state ) && ( TC_IDLE != tc_state ) )
+		{
+			tc_tasks ();
+		}
+		_case_end ();
+		_timeline_state ( tc_state, TC_IDLE );
+		_exit ( ( tests_failed == failed ) ? 0 : 1 );
+	}
+	
+	/* Forward child output until it closes the pipe, a child still running
+	   after TC_FORK_TIMEOUT is killed whether it keeps logging or not */
+	close ( fds[1] );
+	clock_gettime ( CLOCK_MONOTONIC, &start );
+	pfd.fd = fds[0];
+	pfd.events = POLLIN;
+	for ( ;; )
+	{
+		if ( ( false == timed_out ) && ( _ms_since ( &start ) >= TC_FORK_TIMEOUT ) )
+		{
+			timed_out = true;
+			kill ( pid, SIGKILL );
+		}
+		if ( poll ( &pfd, 1, 100 ) == 0 )
+		{
+			continue;
+		}
+		len = read ( fds[0], buff, sizeof(buff) );
+		if ( len <= 0 )
+		{
+			break;
+		}
+		p_transport->p_write_fn ( buff, (uint32_t)len );
+	}
+	close ( fds[0] );
+	waitpid ( pid, &wstat, 0 );
+	
+	pass = ( WIFEXITED ( wstat ) && ( 0 == WEXITSTATUS ( wstat ) ) );
+	if ( WIFSIGNALED ( wstat ) )
+	{
+		_tc_printf ("[ERROR] test case %u (%s) %s by signal %d\r\n", (unsigned int)curr_index,
+				( NULL != curr_test.name ) ? curr_test.name : "-",
+				( true == timed_out ) ? "timed out, killed" : "terminated", 
+				WTERMSIG ( wstat ));
+		_tc_printf ("Test Result: FAIL\r\n");
+	}
+	_timeline_event ("result", 'i', curr_index, ( true == pass ) ? "PASS" : "FAIL");
+	
+	test_result_logged = true;
+	_case_result ( pass );
+	tc_state = TC_COMPLETE;
+}
+
+/* This function returns milliseconds elapsed since start (CLOCK_MONOTONIC)
+ */
+static int64_t _ms_since ( const struct timespec *start )
+{
+	struct timespec now;
+	
+	clock_gettime ( CLOCK_MONOTONIC, &now );
+	
+	return (int64_t)( now.tv_sec - start->tv_sec ) * 1000 + ( now.tv_nsec - start->tv_nsec ) / 1000000;
+}
+
+/* This function is console transport of a forked test case
+ */
+static void _fork_write ( const uint8_t *data, uint32_t len )
+{
+	ssize_t n;
+	
+	while ( len > 0 )
+	{
+		n = write ( fork_fd, data, len );
+		if ( n <= 0 )
+		{
+			return;
+		}
+		data += n;
+		len -= (uint32_t)n;
+	}
+}
+
+/* This function reruns failed current test case in parallel workers and
+ * classifies it, FLAKY if any rerun passed. Workers running longer than
+ * TC_FORK_TIMEOUT are killed and count as failed.
+ */
+static void _rerun_case ( void )
+{
+	pid_t pids[TC_RERUN_MAX];
+	uint32_t started;
+	uint32_t running;
+	uint32_t passed = 0;
+	uint32_t fail_rate;
+	tc_verdict_t verdict;
+	int wstat;
+	struct timespec start;
+	bool timed_out = false;
+	
+	rerun_pending = false;
+	fflush ( NULL );
+	clock_gettime ( CLOCK_MONOTONIC, &start );
+	for ( started = 0; started < rerun_count; started++ )
+	{
+		pids[started] = fork ();
+		if ( pids[started] < 0 )
+		{
+			break;
+		}
+		if ( 0 == pids[started] )
+		{
+			_rerun_worker ( started );
+		}
+	}
+	
+	for ( running = started; running > 0; )
+	{
+		for ( uint32_t i = 0; i < started; i++ )
+		{
+			if ( ( pids[i] > 0 ) && ( waitpid ( pids[i], &wstat, WNOHANG ) == pids[i] ) )
+			{
+				if ( WIFEXITED ( wstat ) && ( 0 == WEXITSTATUS ( wstat ) ) )
+				{
+					passed++;
+				}
+				pids[i] = 0;
+				running--;
+			}
+		}
+		if ( running > 0 )
+		{
+			poll ( NULL, 0, 1 );
+			if ( ( false == timed_out ) && ( _ms_since ( &start ) >= TC_FORK_TIMEOUT ) )
+			{
+				timed_out = true;
+				for ( uint32_t i = 0; i < started; i++ )
+				{
+					if ( pids[i] > 0 )
+					{
+						kill ( pids[i], SIGKILL );
+					}
+				}
+			}
+		}
+	}
+	
+	verdict = ( passed > 0 ) ? TC_VERDICT_FLAKY : TC_VERDICT_FAIL;
+	if ( ( NULL != p_test_list->p_case_state ) && ( curr_index < dag_total ) )
+	{
+		/* dependents of a flaky case don't run */
+		p_test_list->p_case_state[curr_index] = TC_CASE_FAIL;
+	}
+	if ( TC_VERDICT_FLAKY == verdict )
+	{
+		tests_flaky++;
+	}
+	else
+	{
+		tests_failed++;
+	}
+	/* failed share of all executions, first one included */
+	fail_rate = ( ( started + 1u - passed ) * 100u ) / ( started + 1u );
+	_timeline_event ("rerun", 'i', curr_index, ( TC_VERDICT_FLAKY == verdict ) ? "FLAKY" : "FAIL");
+	_tc_printf ("Rerun Result: %s, %u of %u reruns passed, fail rate %u%%\r\n",
+			( TC_VERDICT_FLAKY == verdict ) ? "FLAKY" : "FAIL", (unsigned int)passed,
+			(unsigned int)started, (unsigned int)fail_rate);
+	
+	if ( NULL != p_result_listener )
+	{
+		p_result_listener ( curr_index, curr_test.name, false );
+	}
+	if ( NULL != p_rerun_listener )
+	{
+		p_rerun_listener ( curr_index, curr_test.name, verdict, started, passed );
+	}
+}
+
+/* This function executes current test case once more in a rerun worker, on
+ * fixtures restored to their before image, and exits with its verdict
+ */
+static void _rerun_worker ( uint32_t worker )
+{
+	uint32_t failed = tests_failed;
+	
+	p_transport = &null_transport;
+	p_result_listener = NULL;
+	p_metrics = NULL;
+	rerun_count = 0;
+	
+	tc_guard_restore ( p_test_list->p_fixtures, p_test_list->total_fixtures );
+	if ( false == tc_get_test_case ( p_test_list, curr_index, &curr_test ) )
+	{
+		_exit ( 1 );
+	}
+	test_result_logged = false;
+	tc_state = TC_INIT_WAIT;
+	timeline_lane = (uint16_t)( TC_TL_LANE_RERUN + worker );
+	_timeline_state ( TC_IDLE, tc_state );
+	while ( ( TC_COMPLETE != tc_state ) && ( TC_IDLE != tc_state ) )
+	{
+		tc_tasks ();
+	}
+	_timeline_state ( tc_state, TC_IDLE );
+	_exit ( ( tests_failed == failed ) ? 0 : 1 );
+}
+
+/* This function discards console output of rerun workers
+ */
+static void _null_write ( const uint8_t *data, uint32_t len )
+{
+	(void)data;
+	(void)len;
+}
+
+/* This function runs concurrent dependency scheduling: it completes one
+ * finished case per call, else starts ready cases in free slots, else
+ * waits briefly for console output of running ones
+ */
+static void _jobs_tasks ( void )
+{
+	uint32_t idx;
+	uint32_t slot = 0;
+	
+	if ( ( jobs_running > 0 ) && ( true == _jobs_collect () ) )
+	{
+		return;
+	}
+	while ( ( jobs_running < jobs_max ) && ( true == _dag_next ( &idx ) ) )
+	{
+		while ( 0 != jobs[slot].pid )
+		{
+			slot++;
+		}
+		_job_start ( &jobs[slot], idx );
+	}
+	if ( 0 == jobs_running )
+	{
+		_dag_skip_rest ("dependency cycle");
+		tc_state = TC_IDLE;
+	}
+}
+
+/* This function starts a test case in a forked child of the initialized
+ * process, which runs its init/run states and exits with its verdict
+ */
+static void _job_start ( tc_job_t *job, uint32_t index )
+{
+	uint32_t failed = tests_failed;
+	int fds[2];
+	pid_t pid = -1;
+	
+	p_test_list->p_case_state[index] = TC_CASE_RUNNING;
+	job->index = index;
+	job->len = 0;
+	job->truncated = false;
+	job->timed_out = false;
+	clock_gettime ( CLOCK_MONOTONIC, &job->start );
+	
+	fflush ( NULL );
+	if ( 0 == pipe ( fds ) )
+	{
+		pid = fork ();
+		if ( pid < 0 )
+		{
+			close ( fds[0] );
+			close ( fds[1] );
+		}
+	}
+	if ( pid < 0 )
+	{
+		job->len = (uint32_t)snprintf ( job->out, TC_JOB_OUT, "[ERROR] fork failed\r\n" );
+		_job_report ( job, 1 << 8 );
+		return;
+	}
+	
+	if ( 0 == pid )
+	{
+		close ( fds[0] );
+		fork_fd = fds[1];
+		p_transport = &fork_transport;
+		p_result_listener = NULL;
+		p_metrics = NULL;
+		rerun_count = 0;
+		jobs_max = 0;
+		timeline_lane = (uint16_t)( TC_TL_LANE_JOB + (uint32_t)( job - jobs ) );
+		curr_index = index;
+		if ( false == tc_get_test_case ( p_test_list, curr_index, &curr_test ) )
+		{
+			tc_log_message ("ERROR", "invalid test case index");
+			_exit ( 1 );
+		}
+		tc_guard_snapshot ( p_test_list->p_fixtures, p_test_list->total_fixtures );
+		test_result_logged = false;
+		tc_state = TC_INIT_WAIT;
+		_timeline_state ( TC_IDLE, tc_state );
+		while ( ( TC_COMPLETE != tc_state ) && ( TC_IDLE != tc_state ) )
+		{
+			tc_tasks ();
+		}
+		_case_end ();
+		_timeline_state ( tc_state, TC_IDLE );
+		_exit ( ( tests_failed == failed ) ? 0 : 1 );
+	}
+	
+	close ( fds[1] );
+	fcntl ( fds[0], F_SETFL, fcntl ( fds[0], F_GETFL ) | O_NONBLOCK );
+	job->fd = fds[0];
+	job->pid = pid;
+	jobs_running++;
+}
+
+/* This function buffers console output of running cases and reports the
+ * first one which closed its output. Cases running longer than
+ * TC_FORK_TIMEOUT are killed. Returns true if a case was reported.
+ */
+static bool _jobs_collect ( void )
+{
+	struct pollfd pfd[TC_JOBS_MAX];
+	tc_job_t *slot[TC_JOBS_MAX];
+	char discard[256];
+	uint32_t total = 0;
+	ssize_t len;
+	int wstat = 0;
+	
+	for ( uint32_t i = 0; i < TC_JOBS_MAX; i++ )
+	{
+		if ( 0 != jobs[i].pid )
+		{
+			pfd[total].fd = jobs[i].fd;
+			pfd[total].events = POLLIN;
+			slot[total++] = &jobs[i];
+		}
+	}
+	
+	for ( uint32_t i = 0; i < total; i++ )
+	{
+		if ( ( false == slot[i]->timed_out ) && ( _ms_since ( &slot[i]->start ) >= TC_FORK_TIMEOUT ) )
+		{
+			slot[i]->timed_out = true;
+			kill ( slot[i]->pid, SIGKILL );
+		}
+	}
+	if ( poll ( pfd, total, 10 ) <= 0 )
+	{
+		return false;
+	}
+	
+	for ( uint32_t i = 0; i < total; i++ )
+	{
+		tc_job_t *job = slot[i];
+		
+		if ( 0 == pfd[i].revents )
+		{
+			continue;
+		}
+		for ( ;; )
+		{
+			if ( job->len < TC_JOB_OUT )
+			{
+				len = read ( job->fd, &job->out[job->len], TC_JOB_OUT - job->len );
+			}
+			else
+			{
+				len = read ( job->fd, discard, sizeof(discard) );
+				job->truncated = job->truncated || ( len > 0 );
+			}
+			if ( len <= 0 )
+			{
+				break;
+			}
+			if ( job->len < TC_JOB_OUT )
+			{
+				job->len += (uint32_t)len;
+			}
+		}
+		if ( 0 == len )
+		{
+			/* output closed, case is done */
+			close ( job->fd );
+			waitpid ( job->pid, &wstat, 0 );
+			jobs_running--;
+			_job_report ( job, wstat );
+			return true;
+		}
+	}
+	
+	return false;
+}
+
+/* This function reports a completed concurrent case with its buffered
+ * output as one block, in completion order
+ */
+static void _job_report ( tc_job_t *job, int wstat )
+{
+	bool pass = ( WIFEXITED ( wstat ) && ( 0 == WEXITSTATUS ( wstat ) ) );
+	
+	job->pid = 0;
+	curr_index = job->index;
+	if ( false == tc_get_test_case ( p_test_list, curr_index, &curr_test ) )
+	{
+		memset ( &curr_test, 0, sizeof(curr_test) );
+	}
+	
+	_tc_printf ("Executing test number: %d of %d, case %u (%s)\r\n", 
+			(unsigned int)(test_counter+1), (unsigned int)total_tests, (unsigned int)curr_index,
+			( NULL != curr_test.name ) ? curr_test.name : "-");
+	p_transport->p_write_fn ( (const uint8_t *)job->out, job->len );
+	if ( true == job->truncated )
+	{
+		/* cut output may end mid-line */
+		_tc_printf ("%s[WARNING] test case %u output truncated\r\n",
+				( ( job->len > 0 ) && ( '\n' != job->out[job->len - 1u] ) ) ? "\r\n" : "",
+				(unsigned int)curr_index);
+	}
+	if ( WIFSIGNALED ( wstat ) )
+	{
+		_tc_printf ("[ERROR] test case %u (%s) %s by signal %d\r\n", (unsigned int)curr_index,
+				( NULL != curr_test.name ) ? curr_test.name : "-",
+				( true == job->timed_out ) ? "timed out, killed" : "terminated", 
+				WTERMSIG ( wstat ));
+		_tc_printf ("Test Result: FAIL\r\n");
+	}
+	_timeline_event ("result", 'i', curr_index, ( true == pass ) ? "PASS" : "FAIL");
+	
+	_case_verdict ( pass );
+	test_counter++;
+	_tc_printf ("Test %d completed\r\n", (unsigned int)test_counter);
+	_metrics_publish ( tc_state );
+}
+
+/* This function stops running concurrent cases
+ */
+static void _jobs_kill ( void )
+{
+	for ( uint32_t i = 0; i < TC_JOBS_MAX; i++ )
+	{
+		if ( 0 != jobs[i].pid )
+		{
+			kill ( jobs[i].pid, SIGKILL );
+			close ( jobs[i].fd );
+			waitpid ( jobs[i].pid, NULL, 0 );
+			jobs[i].pid = 0;
+		}
+	}
+	jobs_running = 0;
 }
+#endif
 
 /*** end of file ***/
 
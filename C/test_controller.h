@@ -11,6 +11,31 @@
 #define TEST_CONTROLLER_H
 
 
+/* Defines size of guard zones placed around registered fixtures and the
+ * canary value they are filled with
+*/
+#define TC_GUARD_SIZE	64u
+#define TC_GUARD_BYTE	(uint8_t)0xCA
+
+/* Declares fixture storage of 'count' objects surrounded by guard zones, 
+ * followed by a shadow copy used for before/after comparison. Guard size is
+ * a multiple of any object alignment so no padding ends up between zones.
+*/
+#define TC_FIXTURE_DECLARE(type, count) 	\
+	struct { 								\
+		uint8_t guard_lo[TC_GUARD_SIZE]; 	\
+		type 	obj[count]; 				\
+		uint8_t guard_hi[TC_GUARD_SIZE]; 	\
+		type 	shadow[count]; 				\
+	}
+
+/* Initializes tc_fixture_t from storage declared by TC_FIXTURE_DECLARE
+*/
+#define TC_FIXTURE_INIT(zone) 	{ .p_obj = (void *)(zone).obj, 				\
+								  .p_shadow = (void *)(zone).shadow, 		\
+								  .size = sizeof((zone).obj), 				\
+								  .elem_size = sizeof((zone).obj[0]) }
+
 /* test case initialize function pointer*/
 typedef bool (*tc_init_fn_t) ( void *test_input_data );
 
@@ -24,21 +49,144 @@ typedef struct TEST_CASE {
 	tc_init_fn_t 	p_tc_init_fn; 
 	tc_run_fn_t 	p_tc_run_fn;
 	void 			*p_input_data;
+	const char 		*name; /* test case id, optional */
+	void 			*p_fixture; /* fixture memory the case may modify, 
+								   defaults to p_input_data */
+	uint32_t 		fixture_size; /* bytes at p_fixture the case may modify,
+								   0 = one fixture object */
+	const uint32_t 	*p_deps; /* optional, indexes of cases which must pass
+								before this one runs, see tc_init_t.p_case_state */
+	uint32_t 		total_deps;
 	
-	/* Additionally, test case name/id, 
-	log message buffer can be added */
+	/* Additionally, log message buffer can be added */
 	
 } test_case_t;
 
+/* Declares prerequisites of a test case from an array of case indexes,
+ * e.g. { .p_tc_run_fn = bond_run, TC_DEPENDS_ON(bond_deps) }
+*/
+#define TC_DEPENDS_ON(deps) 	.p_deps = (deps), .total_deps = sizeof(deps) / sizeof((deps)[0])
+
+/* test case generator count function pointer, returns number of cases */
+typedef uint32_t (*tc_gen_count_fn_t) ( void *gen_data );
+
+/* test case generator function pointer, fills test case at given index */
+typedef bool (*tc_gen_fn_t) ( void *gen_data, uint32_t index, test_case_t *tc );
+
+/* Test cases generated on demand, so that large parameter spaces don't need
+ * a test_case_t per case in memory
+*/
+typedef struct TEST_CASE_GEN {
+	
+	tc_gen_count_fn_t 	p_count_fn;
+	tc_gen_fn_t 		p_gen_fn;
+	void 				*p_gen_data;
+	
+} tc_gen_t;
+
+/* Fixture registered with test controller, its guard zones and contents
+ * outside the running case's own object are verified after every case
+*/
+typedef struct TC_FIXTURE {
+	
+	void 		*p_obj; 	/* objects, guard zones are right before and after */
+	void 		*p_shadow; 	/* snapshot taken before each case, same size */
+	uint32_t 	size; 		/* size of all objects */
+	uint32_t 	elem_size; 	/* size of one object */
+	
+} tc_fixture_t;
+
+/* Per test case bump allocator memory, see tc_alloc(). Allocations are
+ * released all at once when the case completes.
+*/
+typedef struct TC_ARENA {
+	
+	uint8_t 	*p_mem;
+	uint32_t 	size;
+	uint32_t 	used; 	/* bytes allocated by running case, padding included */
+	uint32_t 	peak; 	/* most bytes any case allocated */
+	
+} tc_arena_t;
+
+/* Initializes tc_arena_t over a byte array
+*/
+#define TC_ARENA_INIT(buff) 	{ .p_mem = (buff), .size = sizeof(buff) }
+
+/* Defines alignment of arena allocations
+*/
+#ifndef TC_ARENA_ALIGN
+#define TC_ARENA_ALIGN	8u
+#endif
+
 /*
 */
 typedef struct TEST_CASES {
 	
 	test_case_t *tc;
 	uint32_t 	total_test_cases;
+	tc_gen_t 	*p_gen; 		/* optional, generated cases follow the tc list */
+	const uint32_t *p_order; 	/* optional, run only these case indexes in this order */
+	uint32_t 	total_order;
+	tc_fixture_t *p_fixtures; 	/* optional, guarded fixtures */
+	uint32_t 	total_fixtures;
+	tc_arena_t 	*p_arena; 		/* optional, per case allocations */
+	uint8_t 	*p_case_state; 	/* optional, one tc_case_state_t per case (tc_get_total),
+								   enables dependency scheduling of test_case_t.p_deps */
 	
 } tc_init_t;
 
+/* Defines test case state kept by the dependency scheduler. The next case
+ * is the first pending one in run order whose prerequisites all passed; a
+ * case with a prerequisite which failed, was skipped or isn't part of the
+ * run is skipped, so are cases left in a dependency cycle.
+*/
+typedef enum TC_CASE_STATES {
+	
+	TC_CASE_UNSELECTED = 0, /* not part of the run */
+	TC_CASE_PENDING = 1,
+	TC_CASE_RUNNING = 2,
+	TC_CASE_PASS = 3,
+	TC_CASE_FAIL = 4, /* FLAKY included */
+	TC_CASE_SKIP = 5
+		
+} tc_case_state_t;
+
+/* transport write function pointer, sends console output */
+typedef void (*tc_write_fn_t) ( const uint8_t *data, uint32_t len );
+
+/* transport read function pointer, returns number of received bytes without
+   blocking (0 if nothing is pending) */
+typedef uint32_t (*tc_read_fn_t) ( uint8_t *data, uint32_t len );
+
+/* Console transport, all controller output and console commands go 
+ * through it. Default transport writes to stdout and receives nothing.
+*/
+typedef struct TC_TRANSPORT {
+	
+	tc_write_fn_t 	p_write_fn;
+	tc_read_fn_t 	p_read_fn; 	/* optional */
+	
+} tc_transport_t;
+
+/* test case result listener function pointer, called once a case result is
+   final (guard verification included) */
+typedef void (*tc_result_fn_t) ( uint32_t index, const char *name, bool pass );
+
+/* Defines verdict of a failed test case after its reruns
+*/
+typedef enum TC_VERDICTS {
+	
+	TC_VERDICT_PASS = 0,
+	TC_VERDICT_FAIL = 1, /* failed every rerun */
+	TC_VERDICT_FLAKY = 2 /* passed at least one rerun */
+		
+} tc_verdict_t;
+
+/* rerun listener function pointer, called once reruns of a failed case are
+   done, 'passed' of 'reruns' executions passed */
+typedef void (*tc_rerun_fn_t) ( uint32_t index, const char *name, tc_verdict_t verdict,
+								uint32_t reruns, uint32_t passed );
+
 /*
 */
 typedef enum TC_STATES {
@@ -52,9 +200,87 @@ typedef enum TC_STATES {
 		
 } tc_state_t;
 
+/* Defines live metrics block layout, see tc_set_metrics()
+*/
+#define TC_METRICS_MAGIC	0x424D4354u 	/* "TCMB" */
+#define TC_METRICS_VERSION	1u
+#define TC_METRICS_STATES	6u 		/* tc_state_t values */
+#define TC_METRICS_NAME		48u 	/* longest published case name, '\0' included */
+
+/* clock function pointer, returns monotonic time in nanoseconds */
+typedef uint64_t (*tc_clock_fn_t) ( void );
+
+/* Live progress and metrics of a test run, published by the controller for
+ * readers outside the run (e.g. in shared memory). Seqlock protected: seq is
+ * odd while the block is written, a reader copies it and retries unless seq
+ * was even and unchanged around the copy. Layout changes bump the version.
+*/
+typedef struct TC_METRICS {
+	
+	uint32_t 	magic; 		/* TC_METRICS_MAGIC once the block is valid */
+	uint16_t 	version; 	/* TC_METRICS_VERSION */
+	uint16_t 	size; 		/* sizeof(tc_metrics_t) */
+	uint32_t 	seq; 		/* seqlock sequence */
+	uint32_t 	pid; 		/* writer process, set by block owner */
+	uint32_t 	state; 		/* tc_state_t */
+	uint32_t 	case_index; /* running (or last) test case index */
+	uint32_t 	completed; 	/* cases completed in this run */
+	uint32_t 	total; 		/* cases to run */
+	uint32_t 	passed;
+	uint32_t 	failed;
+	uint32_t 	skipped;
+	uint32_t 	flaky;
+	uint64_t 	start_ns; 	/* clock at tc_init() */
+	uint64_t 	update_ns; 	/* clock at last update */
+	uint64_t 	state_ns[TC_METRICS_STATES]; /* time spent per tc_state_t */
+	char 		case_name[TC_METRICS_NAME];
+	
+} tc_metrics_t;
+
+/* Defines timeline event limits and lanes, see tc_set_timeline()
+*/
+#define TC_TL_NAME			16u 	/* event name (state, phase or log tag) kept */
+#define TC_TL_TEXT			32u 	/* message text kept per instant event */
+#define TC_TL_NO_CASE		0xFFFFFFFFu
+#define TC_TL_LANE_MAIN		0u 		/* controller */
+#define TC_TL_LANE_FORK		1u 		/* fork-server case child */
+#define TC_TL_LANE_RERUN	2u 		/* first rerun worker, one lane each */
+#define TC_TL_LANE_JOB		34u 	/* first concurrent case slot, one lane each */
+
+/* Timeline event, Chrome trace event phases: 'B' begin, 'E' end of a span,
+ * 'i' instant
+*/
+typedef struct TC_TL_EVENT {
+	
+	uint64_t 	ts_ns;
+	char 		name[TC_TL_NAME]; /* copied, empty = test case span */
+	uint32_t 	index; 		/* test case index, TC_TL_NO_CASE if none */
+	uint16_t 	lane;
+	char 		phase;
+	char 		text[TC_TL_TEXT]; /* instant event message */
+	
+} tc_tl_event_t;
+
+/* Timeline ring buffer, the oldest events are overwritten once it's full.
+ * Slots are claimed atomically, so forked workers can record into the same
+ * ring when it's in shared memory.
+*/
+typedef struct TC_TIMELINE {
+	
+	tc_tl_event_t 	*p_events;
+	uint32_t 		size; 	/* events */
+	uint32_t 		head; 	/* events recorded */
+	
+} tc_timeline_t;
+
+/* Initializes tc_timeline_t over a tc_tl_event_t array
+*/
+#define TC_TIMELINE_INIT(buff) 	{ .p_events = (buff), .size = sizeof(buff) / sizeof((buff)[0]) }
+
 /*!
  * @brief Initializes test controller. 
  * 	configures test controller with test case details. 
+ * 	tc_init is referenced, not copied, it must stay valid during the run.
  *
  * @param[in] tc_init  contains test case details.
  *
@@ -62,6 +288,113 @@ typedef enum TC_STATES {
  */
 void tc_init ( tc_init_t *tc_init );
 
+/*!
+ * @brief Sets console transport. 
+ * 	Received lines are handled as console commands:
+ * 	"run" restarts the test list (tc_init_data before first tc_init()),
+ * 	"abort" stops it, "status" prints progress.
+ *
+ * @param[in] transport  transport to use, NULL for default (stdout).
+ *
+ * @return None.
+ */
+void tc_set_transport ( const tc_transport_t *transport );
+
+/*!
+ * @brief Sets test case result listener, e.g. to stream results to a host.
+ *
+ * @param[in] listener  listener function, NULL to remove.
+ *
+ * @return None.
+ */
+void tc_set_result_listener ( tc_result_fn_t listener );
+
+/*!
+ * @brief Sets live metrics block. The controller updates it on every state
+ * 	change only, with a few stores and one clock read, so the run isn't
+ * 	slowed down by readers. Forked workers don't publish, in fork-server
+ * 	mode a whole case is accounted to TC_INIT.
+ *
+ * @param[in] block  metrics block, NULL to stop publishing.
+ * @param[in] clock_fn  clock for timings, NULL to publish counts only.
+ *
+ * @return None.
+ */
+void tc_set_metrics ( tc_metrics_t *block, tc_clock_fn_t clock_fn );
+
+/*!
+ * @brief Sets timeline recorder. Controller states, test case spans, test
+ * 	case init / run / verify phases, results and tc_log_message() calls
+ * 	are recorded as begin/end and instant events, e.g. for a Chrome trace
+ * 	export (tc_timeline.c). Forked workers record in their own lanes.
+ *
+ * @param[in] timeline  event ring, NULL to stop recording.
+ * @param[in] clock_fn  event clock.
+ *
+ * @return None.
+ */
+void tc_set_timeline ( tc_timeline_t *timeline, tc_clock_fn_t clock_fn );
+
+/*!
+ * @brief Stops the test run, the running case is abandoned.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ */
+void tc_abort ( void );
+
+#ifdef TC_FORK_SERVER
+/*!
+ * @brief Enables fork-server mode (hosted builds with TC_FORK_SERVER). Every
+ * 	test case runs in a forked copy of the initialized process, so fixture
+ * 	damage and crashes can't affect other cases. A crashed or hanging case
+ * 	(TC_FORK_TIMEOUT ms) is reported as FAIL.
+ *
+ * @param[in] enable  true to fork per test case.
+ *
+ * @return None.
+ */
+void tc_set_fork_mode ( bool enable );
+
+/*!
+ * @brief Enables rerun mode (hosted builds with TC_FORK_SERVER). A failed
+ * 	case is executed 'reruns' more times in parallel forked workers, each on
+ * 	fixtures restored to their state before the case. It is FLAKY if any
+ * 	rerun passes, else FAIL. A FLAKY case is reported as not passed to the
+ * 	result listener but isn't counted by tc_get_fail_count().
+ *
+ * @param[in] reruns  reruns per failed case (up to TC_RERUN_MAX), 0 = off.
+ * @param[in] listener  rerun listener, optional.
+ *
+ * @return None.
+ */
+void tc_set_rerun ( uint32_t reruns, tc_rerun_fn_t listener );
+
+/*!
+ * @brief Enables concurrent dependency scheduling (hosted builds with
+ * 	TC_FORK_SERVER, list with p_case_state). Up to 'jobs' ready cases run at
+ * 	once, each in a forked copy of the initialized process as in fork-server
+ * 	mode, so cases don't see each other's fixture changes. A case starts as
+ * 	soon as its prerequisites passed; its console output is buffered and
+ * 	sent as one block when it completes. Failed cases aren't rerun.
+ *
+ * @param[in] jobs  concurrent cases (up to TC_JOBS_MAX), 0 or 1 = one at a time.
+ *
+ * @return None.
+ */
+void tc_set_jobs ( uint32_t jobs );
+
+/*!
+ * @brief Provides number of test cases classified FLAKY since tc_init().
+ *
+ * @param[in] None.
+ *
+ * @return flaky test case count.
+ */
+uint32_t tc_get_flaky_count ( void );
+#endif
+
 /*!
  * @brief Executes test controller tasks. 
  * 	maintains state machine and executes test cases from the list. 
@@ -91,6 +424,85 @@ void tc_log_result ( const bool pass );
  */
 void tc_log_message ( const char *tag, const char *msg );
 
+/*!
+ * @brief Allocates memory for the running test case from the list's arena.
+ * 	Memory is valid until the case completes, then the arena is reset at
+ * 	once, so cases don't free it. Usable from init and run functions.
+ *
+ * @param[in] size  bytes to allocate.
+ *
+ * @return memory aligned to TC_ARENA_ALIGN, NULL if arena is missing or full.
+ */
+void *tc_alloc ( uint32_t size );
+
+/*!
+ * @brief Logs a test case of the configured list as skipped, e.g. when it
+ * 	is left out of a time budgeted run.
+ *
+ * @param[in] index  test case index.
+ * @param[in] reason  why it is skipped.
+ *
+ * @return None.
+ */
+void tc_log_skip ( uint32_t index, const char *reason );
+
+/*!
+ * @brief Provides number of test cases in a list, generated ones included.
+ *
+ * @param[in] tc_init  test case list.
+ *
+ * @return total test case count.
+ */
+uint32_t tc_get_total ( const tc_init_t *tc_init );
+
+/*!
+ * @brief Provides test case at given index of a list. A generated test case
+ * 	is only valid until the next case of the same generator is obtained.
+ *
+ * @param[in] tc_init  test case list.
+ * @param[in] index  test case index.
+ * @param[out] tc  test case.
+ *
+ * @return true if index is valid.
+ */
+bool tc_get_test_case ( const tc_init_t *tc_init, uint32_t index, test_case_t *tc );
+
+/*!
+ * @brief Provides test controller idle status.
+ *
+ * @param[in] None.
+ *
+ * @return true if all test cases are completed (or none configured).
+ */
+bool tc_is_idle ( void );
+
+/*!
+ * @brief Provides index of test case currently being executed.
+ *
+ * @param[in] None.
+ *
+ * @return test case index in the configured list (not the run position).
+ */
+uint32_t tc_get_test_index ( void );
+
+/*!
+ * @brief Provides number of failed test cases since tc_init().
+ *
+ * @param[in] None.
+ *
+ * @return failed test case count.
+ */
+uint32_t tc_get_fail_count ( void );
+
+/*!
+ * @brief Provides number of skipped test cases since tc_init().
+ *
+ * @param[in] None.
+ *
+ * @return skipped test case count.
+ */
+uint32_t tc_get_skip_count ( void );
+
 /* Test case list data to initialize
 */
 extern tc_init_t tc_init_data;
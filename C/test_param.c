@@ -0,0 +1,236 @@
+/** @file test_param.c
+ *
+ * @brief This file implements table driven parametrized test cases. One run
+ *        function is expanded over the cartesian product of fixtures,
+ *        capacities and input vectors. Cases are generated on demand by the
+ *        test controller from the suite descriptor, input vectors are read in
+ *        place from a memory mapped vector file.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define TP_HAS_MMAP
+#endif
+
+#include "test_controller.h"
+#include "test_param.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define TP_NAME_SIZE	64u
+#define TP_PATH_SIZE	512u
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+static tp_param_t param; /* parameters of last generated case */
+static char name_buff[TP_NAME_SIZE]; /* name of last generated case */
+static const char *vectors_dir; /* base of relative vector file paths */
+static uint32_t map_errors; /* suites whose vector file isn't available */
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static uint32_t _rd_u32 ( const uint8_t *p );
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+/* This function validates vector file header and points at vector data
+*/
+bool tp_vectors_from_mem ( tp_vectors_t *vectors, const void *image, uint32_t size )
+{
+	const uint8_t *p = (const uint8_t *)image;
+	uint32_t vec_len;
+	uint32_t total;
+
+	if ( ( NULL == p ) || ( size < TP_HEADER_SIZE ) || ( 0 != memcmp ( p, "TPV1", 4 ) ) )
+	{
+		return false;
+	}
+
+	vec_len = _rd_u32 ( &p[4] );
+	total = _rd_u32 ( &p[8] );
+	if ( ( 0 == vec_len ) || ( ( (uint64_t)vec_len * total ) > ( size - TP_HEADER_SIZE ) ) )
+	{
+		return false;
+	}
+
+	vectors->p_data = &p[TP_HEADER_SIZE];
+	vectors->vec_len = vec_len;
+	vectors->total_vectors = total;
+
+	return true;
+}
+
+/* This function maps vector file, pages are only read when a generated case
+ * touches its vector
+*/
+bool tp_vectors_map ( tp_vectors_t *vectors, const char *path )
+{
+	bool stat = false;
+
+#ifdef TP_HAS_MMAP
+	struct stat st;
+	void *map;
+	int fd;
+
+	fd = open ( path, O_RDONLY );
+	if ( fd < 0 )
+	{
+		return false;
+	}
+
+	if ( ( 0 == fstat ( fd, &st ) ) && ( st.st_size >= (off_t)TP_HEADER_SIZE ) &&
+		 ( st.st_size <= (off_t)UINT32_MAX ) )
+	{
+		map = mmap ( NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if ( MAP_FAILED != map )
+		{
+			stat = tp_vectors_from_mem ( vectors, map, (uint32_t)st.st_size );
+			if ( true == stat )
+			{
+				vectors->p_map = map;
+				vectors->map_size = (uint32_t)st.st_size;
+			}
+			else
+			{
+				munmap ( map, (size_t)st.st_size );
+			}
+		}
+	}
+	close ( fd );
+#else
+	(void)vectors;
+	(void)path;
+#endif
+
+	return stat;
+}
+
+/* This function releases a mapped vector file
+*/
+void tp_vectors_unmap ( tp_vectors_t *vectors )
+{
+#ifdef TP_HAS_MMAP
+	if ( NULL != vectors->p_map )
+	{
+		munmap ( (void *)vectors->p_map, vectors->map_size );
+	}
+#endif
+	memset ( vectors, 0, sizeof(tp_vectors_t) );
+}
+
+/* This function sets base directory of relative vector file paths
+*/
+void tp_set_vectors_dir ( const char *dir )
+{
+	vectors_dir = dir;
+}
+
+/* This function returns number of suites without vectors
+*/
+uint32_t tp_get_map_errors ( void )
+{
+	return map_errors;
+}
+
+/* This function returns number of parameter combinations, the vector file is
+ * mapped here on first use
+*/
+uint32_t tp_count ( void *gen_data )
+{
+	tp_suite_t *suite = (tp_suite_t *)gen_data;
+	char path[TP_PATH_SIZE];
+
+	if ( ( false == suite->map_tried ) && ( NULL != suite->vectors_file ) )
+	{
+		suite->map_tried = true;
+		if ( ( NULL != vectors_dir ) && ( '/' != suite->vectors_file[0] ) )
+		{
+			snprintf ( path, sizeof(path), "%s/%s", vectors_dir, suite->vectors_file );
+		}
+		else
+		{
+			snprintf ( path, sizeof(path), "%s", suite->vectors_file );
+		}
+		if ( false == tp_vectors_map ( &suite->vectors, path ) )
+		{
+			map_errors++;
+			tc_log_message ( "ERROR", "parametrized suite: vector file not available" );
+		}
+	}
+
+	return suite->total_fixtures * suite->total_capacities * suite->vectors.total_vectors;
+}
+
+/* This function expands a case index into (fixture, capacity, vector), vector
+ * being the fastest changing parameter
+*/
+bool tp_generate ( void *gen_data, uint32_t index, test_case_t *tc )
+{
+	tp_suite_t *suite = (tp_suite_t *)gen_data;
+	uint32_t vec;
+	uint32_t cap;
+	uint32_t fix;
+
+	if ( index >= tp_count ( suite ) )
+	{
+		return false;
+	}
+
+	vec = index % suite->vectors.total_vectors;
+	index /= suite->vectors.total_vectors;
+	cap = index % suite->total_capacities;
+	fix = index / suite->total_capacities;
+
+	param.p_fixture = suite->p_fixtures[fix];
+	param.capacity = suite->p_capacities[cap];
+	param.p_vector = &suite->vectors.p_data[vec * suite->vectors.vec_len];
+	param.vec_len = suite->vectors.vec_len;
+
+	snprintf ( name_buff, TP_NAME_SIZE, "%s/f%u/c%u/v%u", suite->name, (unsigned int)fix,
+			   (unsigned int)param.capacity, (unsigned int)vec );
+
+	tc->p_tc_init_fn = suite->p_tc_init_fn;
+	tc->p_tc_run_fn = suite->p_tc_run_fn;
+	tc->p_input_data = (void *)&param;
+	tc->name = name_buff;
+	tc->p_fixture = param.p_fixture;
+	tc->fixture_size = 0;
+
+	return true;
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function reads little endian 32-bit value
+*/
+static uint32_t _rd_u32 ( const uint8_t *p )
+{
+	return (uint32_t)p[0] | ( (uint32_t)p[1] << 8 ) | ( (uint32_t)p[2] << 16 ) | ( (uint32_t)p[3] << 24 );
+}
+
+/*** end of file ***/
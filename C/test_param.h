@@ -0,0 +1,140 @@
+/** @file test_param.h
+ *
+ * @brief This file provides public interface functions and data structures for
+ *        test_param.c (table driven parametrized test case generation)
+ *
+ * @par Vector file format (little endian)
+ *        offset 0   "TPV1"
+ *        offset 4   uint32 values per vector
+ *        offset 8   uint32 number of vectors
+ *        offset 12  uint32 reserved (0)
+ *        offset 16  vectors, one byte per value
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd.  All rights reserved.
+ */
+
+#ifndef TEST_PARAM_H
+#define TEST_PARAM_H
+
+
+/* Defines size of vector file header
+*/
+#define TP_HEADER_SIZE	16u
+
+/* Defines input vectors, usually mapped from a vector file
+*/
+typedef struct TP_VECTORS {
+
+	const uint8_t 	*p_data; 		/* first value of first vector */
+	uint32_t 		vec_len; 		/* values per vector */
+	uint32_t 		total_vectors;
+	const void 		*p_map; 		/* mapping to release, NULL if not mapped */
+	uint32_t 		map_size;
+
+} tp_vectors_t;
+
+/* Defines parametrized suite: one test case per combination of fixture,
+ * capacity and input vector
+*/
+typedef struct TP_SUITE {
+
+	const char 		*name; 				/* name prefix of generated cases */
+	tc_init_fn_t 	p_tc_init_fn; 		/* receives tp_param_t as input data */
+	tc_run_fn_t 	p_tc_run_fn;
+	void 			**p_fixtures;
+	uint32_t 		total_fixtures;
+	const uint32_t 	*p_capacities;
+	uint32_t 		total_capacities;
+	const char 		*vectors_file; 		/* mapped on first use */
+	tp_vectors_t 	vectors;
+	bool 			map_tried; 			/* vectors_file mapping attempted */
+
+} tp_suite_t;
+
+/* Defines parameters of one generated test case
+*/
+typedef struct TP_PARAM {
+
+	void 			*p_fixture;
+	uint32_t 		capacity;
+	const uint8_t 	*p_vector;
+	uint32_t 		vec_len;
+
+} tp_param_t;
+
+/*!
+ * @brief Sets up vectors from a vector file image in memory (e.g. in flash).
+ *
+ * @param[out] vectors  vectors to set up.
+ * @param[in] image  vector file image.
+ * @param[in] size  image size in bytes.
+ *
+ * @return true if image is valid.
+ */
+bool tp_vectors_from_mem ( tp_vectors_t *vectors, const void *image, uint32_t size );
+
+/*!
+ * @brief Maps a vector file read only into memory (hosted builds only).
+ *
+ * @param[out] vectors  vectors to set up.
+ * @param[in] path  vector file path.
+ *
+ * @return true if file is mapped and valid.
+ */
+bool tp_vectors_map ( tp_vectors_t *vectors, const char *path );
+
+/*!
+ * @brief Releases a mapped vector file.
+ *
+ * @param[in] vectors  mapped vectors.
+ *
+ * @return None.
+ */
+void tp_vectors_unmap ( tp_vectors_t *vectors );
+
+/*!
+ * @brief Sets directory relative vector file paths of suites are resolved
+ *        against, default is the current directory. Call before the first
+ *        tp_count().
+ *
+ * @param[in] dir  directory, NULL = current directory.
+ *
+ * @return None.
+ */
+void tp_set_vectors_dir ( const char *dir );
+
+/*!
+ * @brief Provides number of suites whose vector file couldn't be mapped, their
+ *        generated cases are missing from the list.
+ *
+ * @param[in] None.
+ *
+ * @return number of suites without vectors.
+ */
+uint32_t tp_get_map_errors ( void );
+
+/*!
+ * @brief Provides number of generated test cases, tc_gen_t count function.
+ *
+ * @param[in] gen_data  pointer to tp_suite_t.
+ *
+ * @return fixtures x capacities x vectors.
+ */
+uint32_t tp_count ( void *gen_data );
+
+/*!
+ * @brief Expands one test case, tc_gen_t generator function. Parameters and
+ *        name are held in a single scratch slot, valid until next call.
+ *
+ * @param[in] gen_data  pointer to tp_suite_t.
+ * @param[in] index  generated case index.
+ * @param[out] tc  test case.
+ *
+ * @return true if index is valid.
+ */
+bool tp_generate ( void *gen_data, uint32_t index, test_case_t *tc );
+
+#endif /* TEST_PARAM_H */
+
+/*** end of file ***/
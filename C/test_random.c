@@ -0,0 +1,484 @@
+/** @file test_random.c
+ *
+ * @brief This file implements a randomized differential tester for circular
+ *        queue. Seeded operation sequences are executed on the SUT and every
+ *        result is compared against a simple reference model. A failing
+ *        sequence is shrunk to a minimal repro before it is logged.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "sut/circular_queue.h"
+#include "cq_trace.h"
+#include "test_controller.h"
+#include "test_random.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+/* Defines guard area placed after queue under test, large enough to absorb
+ * any write through an 8-bit index
+*/
+#define TR_GUARD_SIZE	256u
+#define TR_GUARD_BYTE	(uint8_t)0xA5
+
+/* Defines number of slots in queue buffer
+*/
+#define TR_BUFF_LEN		( sizeof(((cq_t *)0)->buff) / sizeof(cq_val_t) )
+
+/* Defines size of repro message buffer
+*/
+#define TR_MSG_SIZE		512u
+
+/* Defines randomized test run states
+*/
+typedef enum TR_STATES {
+
+	TR_STATE_IDLE = 0, 			/* test case is not running */
+	TR_STATE_INIT = 1, 			/* test case initialize */
+	TR_STATE_RUN = 2, 			/* run one sequence per call */
+	TR_STATE_VERIFY = 3, 		/* shrink and report failure */
+	TR_STATE_LOG_RESULT = 4 	/* log test result */
+
+} tr_state_t;
+
+/* Defines queue under test followed by its guard area
+*/
+typedef struct TR_FIXTURE {
+
+	cq_t 		q;
+	uint8_t 	guard[TR_GUARD_SIZE];
+
+} tr_fixture_t;
+
+/* Defines reference model, a plain FIFO with capacity CQ_SIZE
+*/
+typedef struct TR_MODEL {
+
+	cq_val_t 	vals[CQ_SIZE];
+	uint32_t 	head;
+	uint32_t 	count;
+
+} tr_model_t;
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+static tr_fixture_t fixture; /* queue under test */
+static tr_model_t model; /* reference model */
+static tr_op_t ops_buff[TR_MAX_OPS]; /* current sequence */
+static tr_op_t trial_buff[TR_MAX_OPS]; /* shrink candidate */
+static char msg_buff[TR_MSG_SIZE]; /* repro message */
+
+static const tr_config_t *p_cfg; /* current test configuration */
+static tr_state_t tr_state; /* test case run state */
+static tr_result_t tr_result; /* first failure */
+static uint32_t iteration; /* current sequence number */
+static uint32_t fail_ops; /* length of failing sequence */
+static uint32_t fail_seed; /* seed of failing sequence */
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static uint32_t _rand ( uint32_t *state );
+static void _fixture_reset ( void );
+static bool _guard_intact ( void );
+static uint32_t _seq_load ( uint32_t seed );
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+/* This function generates a random operation sequence. Enqueue is weighted
+ * above dequeue so that sequences regularly reach full queue and wrap around.
+*/
+void tr_generate ( uint32_t seed, tr_op_t *ops, uint32_t total_ops )
+{
+	uint32_t state = seed;
+	uint32_t r;
+
+	for ( uint32_t i = 0; i < total_ops; i++ )
+	{
+		r = _rand ( &state );
+
+		switch ( r % 16u )
+		{
+			case 0:
+				ops[i].type = TR_OP_INIT;
+				break;
+
+			case 1: case 2: case 3:
+				ops[i].type = TR_OP_IS_EMPTY;
+				break;
+
+			case 4: case 5: case 6: case 7: case 8:
+				ops[i].type = TR_OP_DEQUEUE;
+				break;
+
+			default:
+				ops[i].type = TR_OP_ENQUEUE;
+				break;
+		}
+		ops[i].val = (cq_val_t)( r >> 8 );
+	}
+}
+
+/* This function executes a sequence on a fresh queue. Indexes are checked
+ * after every operation, execution stops at first mismatch so that a corrupt
+ * index is never used for another write.
+*/
+bool tr_execute ( const tr_op_t *ops, uint32_t total_ops, tr_result_t *res )
+{
+	cq_status_t stat;
+	cq_val_t val;
+	bool has_space;
+
+	_fixture_reset ();
+
+	res->pass = true;
+	res->fail_op = 0;
+	res->reason = "";
+
+	for ( uint32_t i = 0; ( i < total_ops ) && ( true == res->pass ); i++ )
+	{
+		switch ( ops[i].type )
+		{
+			case TR_OP_INIT:
+				cq_init ( &fixture.q );
+				model.head = 0;
+				model.count = 0;
+				break;
+
+			case TR_OP_ENQUEUE:
+				stat = cq_enqueue ( &fixture.q, ops[i].val );
+				if ( model.count < CQ_SIZE )
+				{
+					model.vals[( model.head + model.count ) % CQ_SIZE] = ops[i].val;
+					model.count++;
+					if ( CQ_OK != stat )
+					{
+						res->pass = false;
+						res->reason = "cq_enqueue() didn't return OK for non-full queue";
+					}
+				}
+				else if ( CQ_IS_FULL != stat )
+				{
+					res->pass = false;
+					res->reason = "cq_enqueue() didn't return FULL for full queue";
+				}
+				break;
+
+			case TR_OP_DEQUEUE:
+				val = (cq_val_t)~model.vals[model.head];
+				stat = cq_dequeue ( &fixture.q, &val );
+				if ( model.count > 0 )
+				{
+					if ( CQ_OK != stat )
+					{
+						res->pass = false;
+						res->reason = "cq_dequeue() didn't return OK for non-empty queue";
+					}
+					else if ( val != model.vals[model.head] )
+					{
+						res->pass = false;
+						res->reason = "cq_dequeue() returned value out of FIFO order";
+					}
+					model.head = ( model.head + 1u ) % CQ_SIZE;
+					model.count--;
+				}
+				else if ( CQ_IS_EMPTY != stat )
+				{
+					res->pass = false;
+					res->reason = "cq_dequeue() didn't return EMPTY for empty queue";
+				}
+				break;
+
+			case TR_OP_IS_EMPTY:
+				has_space = ( model.count < CQ_SIZE );
+				if ( cq_is_empty ( &fixture.q ) != has_space )
+				{
+					res->pass = false;
+					res->reason = "cq_is_empty() disagrees with queue fill level";
+				}
+				break;
+
+			default:
+				break;
+		}
+
+		if ( ( true == res->pass ) &&
+			 ( ( fixture.q.wr >= TR_BUFF_LEN ) || ( fixture.q.rd >= TR_BUFF_LEN ) ) )
+		{
+			res->pass = false;
+			res->reason = "queue index out of buffer bounds";
+		}
+
+		if ( false == res->pass )
+		{
+			res->fail_op = i;
+		}
+	}
+
+	if ( ( true == res->pass ) && ( false == _guard_intact () ) )
+	{
+		res->pass = false;
+		res->fail_op = total_ops - 1u;
+		res->reason = "write past queue object detected";
+	}
+
+	return res->pass;
+}
+
+/* This function shrinks a failing sequence. Operations after the failing one
+ * are dropped, then chunks of halving size are removed as long as the
+ * sequence keeps failing, finally enqueue values are simplified to 0.
+*/
+uint32_t tr_shrink ( tr_op_t *ops, uint32_t total_ops )
+{
+	tr_result_t res;
+	uint32_t chunk;
+	uint32_t start;
+	bool removed;
+	cq_val_t val;
+
+	if ( true == tr_execute ( ops, total_ops, &res ) )
+	{
+		/* not a failing sequence */
+		return total_ops;
+	}
+	total_ops = res.fail_op + 1u;
+
+	for ( chunk = total_ops / 2u; chunk > 0; chunk /= 2u )
+	{
+		do
+		{
+			removed = false;
+			start = 0;
+			while ( ( start + chunk ) <= total_ops )
+			{
+				memcpy ( trial_buff, ops, start * sizeof(tr_op_t) );
+				memcpy ( &trial_buff[start], &ops[start + chunk],
+						 ( total_ops - start - chunk ) * sizeof(tr_op_t) );
+
+				if ( false == tr_execute ( trial_buff, total_ops - chunk, &res ) )
+				{
+					total_ops = res.fail_op + 1u;
+					memcpy ( ops, trial_buff, total_ops * sizeof(tr_op_t) );
+					removed = true;
+				}
+				else
+				{
+					start += chunk;
+				}
+			}
+		} while ( true == removed );
+	}
+
+	for ( uint32_t i = 0; i < total_ops; i++ )
+	{
+		if ( ( TR_OP_ENQUEUE == ops[i].type ) && ( 0 != ops[i].val ) )
+		{
+			val = ops[i].val;
+			ops[i].val = 0;
+			if ( true == tr_execute ( ops, total_ops, &res ) )
+			{
+				ops[i].val = val;
+			}
+		}
+	}
+
+	return total_ops;
+}
+
+/* This function formats a sequence, output is truncated with "..." when the
+ * buffer is too small.
+*/
+void tr_format ( const tr_op_t *ops, uint32_t total_ops, char *buf, uint32_t len )
+{
+	uint32_t pos = 0;
+	int n = 0;
+
+	buf[0] = '\0';
+	for ( uint32_t i = 0; i < total_ops; i++ )
+	{
+		switch ( ops[i].type )
+		{
+			case TR_OP_INIT:
+				n = snprintf ( &buf[pos], len - pos, "INIT " );
+				break;
+
+			case TR_OP_ENQUEUE:
+				n = snprintf ( &buf[pos], len - pos, "ENQ(%u) ", (unsigned int)ops[i].val );
+				break;
+
+			case TR_OP_DEQUEUE:
+				n = snprintf ( &buf[pos], len - pos, "DEQ " );
+				break;
+
+			default:
+				n = snprintf ( &buf[pos], len - pos, "EMPTY? " );
+				break;
+		}
+
+		if ( ( n < 0 ) || ( ( pos + (uint32_t)n ) >= ( len - 4u ) ) )
+		{
+			snprintf ( &buf[pos], len - pos, "..." );
+			break;
+		}
+		pos += (uint32_t)n;
+	}
+}
+
+/* This function initializes randomized test case
+*/
+bool tr_tc_init ( void *test_input_data )
+{
+	p_cfg = (const tr_config_t *) test_input_data;
+	tr_state = TR_STATE_INIT;
+
+	return true;
+}
+
+/* This function runs randomized test case, one sequence per call so that
+ * controller keeps its cooperative scheduling
+*/
+void tr_tc_run ( void )
+{
+	uint32_t total_ops;
+	int n;
+
+	switch ( tr_state )
+	{
+		case TR_STATE_INIT:
+			/* Initialize test case */
+			iteration = 0;
+			tr_result.pass = true;
+			tr_state = TR_STATE_RUN;
+			break;
+
+		case TR_STATE_RUN:
+			/* run next sequence */
+			total_ops = _seq_load ( p_cfg->seed + iteration );
+			if ( false == tr_execute ( ops_buff, total_ops, &tr_result ) )
+			{
+				fail_seed = p_cfg->seed + iteration;
+				fail_ops = total_ops;
+				tr_state = TR_STATE_VERIFY;
+			}
+			else if ( ( ++iteration >= p_cfg->iterations ) || ( NULL != p_cfg->p_ops ) )
+			{
+				tr_state = TR_STATE_VERIFY;
+			}
+			break;
+
+		case TR_STATE_VERIFY:
+			/* report minimal repro of the failure */
+			if ( false == tr_result.pass )
+			{
+				tc_log_message ( "ERROR", tr_result.reason );
+
+				fail_ops = tr_shrink ( ops_buff, fail_ops );
+				n = snprintf ( msg_buff, TR_MSG_SIZE, "seed %lu, minimal repro (%lu ops): ",
+							   (unsigned long)fail_seed, (unsigned long)fail_ops );
+				tr_format ( ops_buff, fail_ops, &msg_buff[n], TR_MSG_SIZE - (uint32_t)n );
+				tc_log_message ( "ERROR", msg_buff );
+			}
+			tr_state = TR_STATE_LOG_RESULT;
+			break;
+
+		case TR_STATE_LOG_RESULT:
+			/* log test case result */
+			tc_log_result ( tr_result.pass );
+			tr_state = TR_STATE_IDLE;
+			break;
+
+		case TR_STATE_IDLE:
+			break;
+
+		default:
+			break;
+	}
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function returns next xorshift32 random number
+*/
+static uint32_t _rand ( uint32_t *state )
+{
+	uint32_t x = *state;
+
+	if ( 0 == x )
+	{
+		x = 0x9E3779B9u;
+	}
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+/* This function resets queue under test, guard area and reference model
+*/
+static void _fixture_reset ( void )
+{
+	memset ( fixture.guard, TR_GUARD_BYTE, TR_GUARD_SIZE );
+	cq_init ( &fixture.q );
+	model.head = 0;
+	model.count = 0;
+}
+
+/* This function returns true if guard area after queue is untouched
+*/
+static bool _guard_intact ( void )
+{
+	for ( uint32_t i = 0; i < TR_GUARD_SIZE; i++ )
+	{
+		if ( TR_GUARD_BYTE != fixture.guard[i] )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* This function loads sequence to run, either fixed one from configuration
+ * or a random one generated from seed
+*/
+static uint32_t _seq_load ( uint32_t seed )
+{
+	uint32_t total_ops;
+
+	if ( NULL != p_cfg->p_ops )
+	{
+		total_ops = ( p_cfg->total_ops < TR_MAX_OPS ) ? p_cfg->total_ops : TR_MAX_OPS;
+		memcpy ( ops_buff, p_cfg->p_ops, total_ops * sizeof(tr_op_t) );
+	}
+	else
+	{
+		total_ops = ( p_cfg->ops_per_seq < TR_MAX_OPS ) ? p_cfg->ops_per_seq : TR_MAX_OPS;
+		tr_generate ( seed, ops_buff, total_ops );
+	}
+
+	return total_ops;
+}
+
+/*** end of file ***/
@@ -0,0 +1,126 @@
+/** @file test_random.h
+ *
+ * @brief This file provides public interface functions and data structures for
+ *        test_random.c (randomized differential tester for circular queue)
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd.  All rights reserved.
+ */
+
+#ifndef TEST_RANDOM_H
+#define TEST_RANDOM_H
+
+
+/* Defines maximum number of operations in one sequence
+*/
+#define TR_MAX_OPS	(uint32_t)1024
+
+/* Defines queue operations driven by randomized tester
+*/
+typedef enum TR_OP_TYPES {
+
+	TR_OP_INIT = 0, 		/* cq_init() */
+	TR_OP_ENQUEUE = 1, 		/* cq_enqueue() with op value */
+	TR_OP_DEQUEUE = 2, 		/* cq_dequeue() */
+	TR_OP_IS_EMPTY = 3 		/* cq_is_empty() */
+
+} tr_op_type_t;
+
+/* Defines one queue operation of a sequence
+*/
+typedef struct TR_OP {
+
+	uint8_t 	type; 	/* operation type, see tr_op_type_t */
+	cq_val_t 	val; 	/* value to enqueue, unused for other operations */
+
+} tr_op_t;
+
+/* Defines randomized test configuration, passed as test case input data
+*/
+typedef struct TR_CONFIG {
+
+	uint32_t 		seed; 			/* seed of the first sequence, must not be 0 */
+	uint32_t 		iterations; 	/* number of sequences to run */
+	uint32_t 		ops_per_seq; 	/* operations per sequence (<= TR_MAX_OPS) */
+	const tr_op_t 	*p_ops; 		/* optional fixed sequence, replayed instead of random ones */
+	uint32_t 		total_ops; 		/* number of operations in p_ops */
+
+} tr_config_t;
+
+/* Defines result of a sequence execution
+*/
+typedef struct TR_RESULT {
+
+	bool 		pass; 		/* true if SUT matched the reference model */
+	uint32_t 	fail_op; 	/* index of first mismatching operation */
+	const char 	*reason; 	/* mismatch description */
+
+} tr_result_t;
+
+/*!
+ * @brief Generates a random operation sequence.
+ *
+ * @param[in] seed  sequence seed, must not be 0.
+ * @param[out] ops  operation buffer.
+ * @param[in] total_ops  number of operations to generate.
+ *
+ * @return None.
+ */
+void tr_generate ( uint32_t seed, tr_op_t *ops, uint32_t total_ops );
+
+/*!
+ * @brief Executes an operation sequence on a fresh queue and compares every
+ *        result against the reference model.
+ *
+ * @param[in] ops  operation sequence.
+ * @param[in] total_ops  number of operations.
+ * @param[out] res  execution result.
+ *
+ * @return true if SUT matched the reference model.
+ */
+bool tr_execute ( const tr_op_t *ops, uint32_t total_ops, tr_result_t *res );
+
+/*!
+ * @brief Shrinks a failing sequence in place to a minimal failing sequence.
+ *
+ * @param[in,out] ops  failing operation sequence.
+ * @param[in] total_ops  number of operations.
+ *
+ * @return number of operations in the shrunk sequence.
+ */
+uint32_t tr_shrink ( tr_op_t *ops, uint32_t total_ops );
+
+/*!
+ * @brief Formats an operation sequence as a readable repro string.
+ *
+ * @param[in] ops  operation sequence.
+ * @param[in] total_ops  number of operations.
+ * @param[out] buf  output buffer.
+ * @param[in] len  output buffer size.
+ *
+ * @return None.
+ */
+void tr_format ( const tr_op_t *ops, uint32_t total_ops, char *buf, uint32_t len );
+
+/*!
+ * @brief Test case init function, registrable as test_case_t.p_tc_init_fn.
+ *
+ * @param[in] test_input_data  pointer to tr_config_t.
+ *
+ * @return initilaization status. true or false.
+ */
+bool tr_tc_init ( void *test_input_data );
+
+/*!
+ * @brief Test case run function, registrable as test_case_t.p_tc_run_fn.
+ *        Runs one sequence per call, shrinks and logs the first failure.
+ *
+ * @param[in] None.
+ *
+ * @return None.
+ */
+void tr_tc_run ( void );
+
+#endif /* TEST_RANDOM_H */
+
+/*** end of file ***/
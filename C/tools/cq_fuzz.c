@@ -0,0 +1,648 @@
+/** @file cq_fuzz.c
+ *
+ * @brief This file implements a coverage-guided fuzzing front end for the
+ *        circular queue. Input bytes are decoded into queue operation
+ *        sequences which are executed and checked against the reference
+ *        model of the randomized tester (tr_execute), so every invariant it
+ *        verifies (statuses, FIFO order, index bounds, writes past the queue)
+ *        is a fuzzing oracle.
+ *
+ *        Built with -DCQ_FUZZ_LIBFUZZER the file only provides
+ *        LLVMFuzzerTestOneInput() for libFuzzer. Otherwise it is a standalone
+ *        in-process fuzzer: SUT code is compiled with edge coverage
+ *        instrumentation, inputs reaching new edges (or edge hit counts) are
+ *        kept in the corpus and mutated further. Failing inputs are shrunk,
+ *        saved and can be exported as test_case_t regression cases.
+ *
+ * @par Input encoding
+ *        Every byte is one operation, bits 0..1 select init, enqueue,
+ *        dequeue or is_empty. An enqueue takes its value from the next byte.
+ *
+ * @par Build and run
+ *        standalone (gcc or clang):
+ *        gcc -O2 -I.. -fsanitize-coverage=trace-pc -c ../sut/circular_queue.c -o cq_cov.o
+ *        gcc -O2 -I.. cq_fuzz.c ../test_random.c ../test_controller.c ../tc_guard.c \
+ *            ../test_app.c ../test_param.c ../tc_perf.c cq_cov.o -o cq_fuzz
+ *        ./cq_fuzz [-n runs] [-s seed] [-d crash_dir] [-x export.c] [seed_file ...]
+ *          -n  number of executions (default 1000000), 0 runs seed files only
+ *          -s  random seed (default 1)
+ *          -d  directory for failing inputs (default fuzz_crashes)
+ *          -x  write unique failures as test_case_t regression cases
+ *        libFuzzer:
+ *        clang -O1 -g -fsanitize=fuzzer,address -DCQ_FUZZ_LIBFUZZER -I.. cq_fuzz.c \
+ *            ../test_random.c ../test_controller.c ../tc_guard.c ../test_app.c \
+ *            ../test_param.c ../tc_perf.c ../sut/circular_queue.c -o cq_libfuzzer
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef CQ_FUZZ_LIBFUZZER
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#include "sut/circular_queue.h"
+#include "test_controller.h"
+#include "test_random.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define FZ_MAX_INPUT	( 2u * TR_MAX_OPS ) 	/* bytes, enough for TR_MAX_OPS operations */
+#define FZ_MSG_SIZE		1024u
+
+#ifndef CQ_FUZZ_LIBFUZZER
+
+#define FZ_MAP_SIZE		8192u 		/* edge map entries, power of 2 */
+#define FZ_MAX_CORPUS	4096u
+#define FZ_MAX_CRASHES	64u
+#define FZ_MAX_STACK	4u 			/* mutations stacked per execution */
+#define FZ_STAT_PERIOD	0x3FFFFu 	/* executions between status lines, 2^n-1 */
+
+/* Defines corpus entry
+*/
+typedef struct FZ_INPUT {
+
+	uint8_t 	*data;
+	uint32_t 	len;
+
+} fz_input_t;
+
+/* Defines unique failure, identified by oracle message and failing operation
+*/
+typedef struct FZ_CRASH {
+
+	const char 	*reason;
+	uint8_t 	op_type;
+	tr_op_t 	ops[TR_MAX_OPS]; 	/* shrunk sequence */
+	uint32_t 	total_ops;
+	uint32_t 	hash;
+
+} fz_crash_t;
+
+#endif
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+static tr_op_t fz_ops[TR_MAX_OPS];
+static char msg_buff[FZ_MSG_SIZE];
+
+#ifndef CQ_FUZZ_LIBFUZZER
+static uint8_t cov_map[FZ_MAP_SIZE]; /* edge hit counts of current execution */
+static uint8_t virgin_map[FZ_MAP_SIZE]; /* hit count classes seen so far, per edge */
+static uint32_t prev_loc;
+static uint32_t next_guard_id = 1;
+
+static fz_input_t corpus[FZ_MAX_CORPUS];
+static uint32_t total_corpus;
+static fz_crash_t crashes[FZ_MAX_CRASHES];
+static uint32_t total_crashes;
+static uint32_t total_edges;
+static uint32_t rng_state = 1;
+#endif
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static uint32_t _decode ( const uint8_t *data, uint32_t len, tr_op_t *ops );
+
+#ifndef CQ_FUZZ_LIBFUZZER
+static uint32_t _rand ( void );
+static uint32_t _mutate ( uint8_t *data, uint32_t len );
+static bool _run_input ( const uint8_t *data, uint32_t len, const char *crash_dir );
+static bool _new_coverage ( void );
+static void _add_corpus ( const uint8_t *data, uint32_t len );
+static bool _record_crash ( uint32_t total_ops, const tr_result_t *res, const char *crash_dir );
+static uint32_t _encode ( const tr_op_t *ops, uint32_t total_ops, uint8_t *data );
+static uint32_t _hash ( const uint8_t *data, uint32_t len );
+static bool _load_file ( const char *path, uint8_t *data, uint32_t *len );
+static bool _export ( const char *path );
+#endif
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+/* This function is libFuzzer entry point, a failing sequence aborts
+*/
+int LLVMFuzzerTestOneInput ( const uint8_t *data, size_t size )
+{
+	tr_result_t res;
+	uint32_t total_ops;
+
+	if ( size > FZ_MAX_INPUT )
+	{
+		size = FZ_MAX_INPUT;
+	}
+	total_ops = _decode ( data, (uint32_t)size, fz_ops );
+
+	if ( false == tr_execute ( fz_ops, total_ops, &res ) )
+	{
+		total_ops = tr_shrink ( fz_ops, res.fail_op + 1u );
+		tr_format ( fz_ops, total_ops, msg_buff, FZ_MSG_SIZE );
+		fprintf ( stderr, "[ERROR] %s\r\n[ERROR] minimal repro (%u ops): %s\r\n",
+				  res.reason, (unsigned int)total_ops, msg_buff );
+		abort ();
+	}
+
+	return 0;
+}
+
+#ifndef CQ_FUZZ_LIBFUZZER
+
+/* Edge coverage callbacks: gcc/clang -fsanitize-coverage=trace-pc calls the
+ * first one per basic block, clang trace-pc-guard the other two. An edge is
+ * the pair of previous and current block, as in AFL.
+*/
+void __sanitizer_cov_trace_pc ( void )
+{
+	uintptr_t pc = (uintptr_t)__builtin_return_address ( 0 );
+	uint32_t cur = (uint32_t)( ( pc >> 4 ) ^ ( pc << 8 ) ) & ( FZ_MAP_SIZE - 1u );
+
+	cov_map[cur ^ prev_loc]++;
+	prev_loc = cur >> 1;
+}
+
+void __sanitizer_cov_trace_pc_guard_init ( uint32_t *start, uint32_t *stop )
+{
+	for ( uint32_t *g = start; g < stop; g++ )
+	{
+		if ( 0 == *g )
+		{
+			*g = ( next_guard_id++ * 2654435761u ) & ( FZ_MAP_SIZE - 1u );
+		}
+	}
+}
+
+void __sanitizer_cov_trace_pc_guard ( uint32_t *guard )
+{
+	cov_map[*guard ^ prev_loc]++;
+	prev_loc = *guard >> 1;
+}
+
+int main ( int argc, char *argv[] )
+{
+	static uint8_t input[FZ_MAX_INPUT];
+	struct timespec t0;
+	struct timespec t1;
+	const char *crash_dir = "fuzz_crashes";
+	const char *export_file = NULL;
+	unsigned long long runs = 1000000ull;
+	unsigned long long execs = 0;
+	const fz_input_t *parent;
+	uint32_t len;
+	double secs;
+	int opt;
+
+	while ( ( opt = getopt ( argc, argv, "n:s:d:x:h" ) ) != -1 )
+	{
+		switch ( opt )
+		{
+			case 'n':
+				runs = strtoull ( optarg, NULL, 0 );
+				break;
+
+			case 's':
+				rng_state = (uint32_t)strtoul ( optarg, NULL, 0 );
+				rng_state = ( 0 != rng_state ) ? rng_state : 1u;
+				break;
+
+			case 'd':
+				crash_dir = optarg;
+				break;
+
+			case 'x':
+				export_file = optarg;
+				break;
+
+			default:
+				printf ( "usage: %s [-n runs] [-s seed] [-d crash_dir] [-x export.c] [seed_file ...]\r\n", argv[0] );
+				return ( 'h' == opt ) ? 0 : 2;
+		}
+	}
+
+	clock_gettime ( CLOCK_MONOTONIC, &t0 );
+
+	/* Seed corpus, an empty input if no seed files are given */
+	for ( int i = optind; i < argc; i++ )
+	{
+		if ( true == _load_file ( argv[i], input, &len ) )
+		{
+			_run_input ( input, len, crash_dir );
+			execs++;
+		}
+		else
+		{
+			printf ( "[ERROR] can't read seed file %s\r\n", argv[i] );
+		}
+	}
+	if ( 0 == total_corpus )
+	{
+		input[0] = TR_OP_INIT;
+		_add_corpus ( input, 1u );
+	}
+
+	for ( unsigned long long r = 0; r < runs; r++ )
+	{
+		parent = &corpus[_rand () % total_corpus];
+		memcpy ( input, parent->data, parent->len );
+		len = _mutate ( input, parent->len );
+		_run_input ( input, len, crash_dir );
+		execs++;
+
+		if ( 0 == ( execs & FZ_STAT_PERIOD ) )
+		{
+			clock_gettime ( CLOCK_MONOTONIC, &t1 );
+			secs = (double)( t1.tv_sec - t0.tv_sec ) + (double)( t1.tv_nsec - t0.tv_nsec ) / 1e9;
+			printf ( "#%llu exec/s %.0f corpus %u edges %u failures %u\r\n", execs, (double)execs / secs,
+					 (unsigned int)total_corpus, (unsigned int)total_edges, (unsigned int)total_crashes );
+			fflush ( stdout );
+		}
+	}
+
+	clock_gettime ( CLOCK_MONOTONIC, &t1 );
+	secs = (double)( t1.tv_sec - t0.tv_sec ) + (double)( t1.tv_nsec - t0.tv_nsec ) / 1e9;
+	printf ( "done: %llu execs in %.2f s (%.0f exec/s), corpus %u, edges %u, unique failures %u\r\n",
+			 execs, secs, ( secs > 0.0 ) ? (double)execs / secs : 0.0, (unsigned int)total_corpus,
+			 (unsigned int)total_edges, (unsigned int)total_crashes );
+
+	if ( ( NULL != export_file ) && ( false == _export ( export_file ) ) )
+	{
+		printf ( "[ERROR] can't write %s\r\n", export_file );
+		return 2;
+	}
+
+	return ( 0 == total_crashes ) ? 0 : 1;
+}
+
+#endif
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function decodes input bytes into queue operations
+*/
+static uint32_t _decode ( const uint8_t *data, uint32_t len, tr_op_t *ops )
+{
+	uint32_t total = 0;
+
+	for ( uint32_t i = 0; ( i < len ) && ( total < TR_MAX_OPS ); i++ )
+	{
+		ops[total].type = data[i] & 0x03u;
+		ops[total].val = 0;
+		if ( ( TR_OP_ENQUEUE == ops[total].type ) && ( ( i + 1u ) < len ) )
+		{
+			ops[total].val = (cq_val_t)data[++i];
+		}
+		total++;
+	}
+
+	return total;
+}
+
+#ifndef CQ_FUZZ_LIBFUZZER
+
+/* This function returns next xorshift32 random number
+*/
+static uint32_t _rand ( void )
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+
+	return rng_state;
+}
+
+/* This function applies a stack of random mutations, returns new length
+*/
+static uint32_t _mutate ( uint8_t *data, uint32_t len )
+{
+	const fz_input_t *other;
+	uint32_t stack = 1u + ( _rand () % FZ_MAX_STACK );
+	uint32_t pos;
+	uint32_t n;
+
+	for ( uint32_t s = 0; s < stack; s++ )
+	{
+		pos = ( len > 0 ) ? ( _rand () % len ) : 0;
+
+		switch ( _rand () % 7u )
+		{
+			case 0: /* flip a bit */
+				if ( len > 0 )
+				{
+					data[pos] ^= (uint8_t)( 1u << ( _rand () % 8u ) );
+				}
+				break;
+
+			case 1: /* random byte */
+				if ( len > 0 )
+				{
+					data[pos] = (uint8_t)_rand ();
+				}
+				break;
+
+			case 2: /* insert random operation */
+			case 3:
+				n = ( _rand () & 1u ) ? 2u : 1u;
+				if ( ( len + n ) <= FZ_MAX_INPUT )
+				{
+					memmove ( &data[pos + n], &data[pos], len - pos );
+					data[pos] = (uint8_t)_rand ();
+					if ( 2u == n )
+					{
+						data[pos] = (uint8_t)( ( data[pos] & ~0x03u ) | TR_OP_ENQUEUE );
+						data[pos + 1u] = (uint8_t)_rand ();
+					}
+					len += n;
+				}
+				break;
+
+			case 4: /* delete a range */
+				if ( len > 1u )
+				{
+					n = 1u + ( _rand () % ( len - pos ) );
+					memmove ( &data[pos], &data[pos + n], len - pos - n );
+					len -= n;
+				}
+				break;
+
+			case 5: /* duplicate a range, reaches deep fill levels fast */
+				n = ( len > pos ) ? ( 1u + ( _rand () % ( len - pos ) ) ) : 0u;
+				if ( ( n > 0 ) && ( ( len + n ) <= FZ_MAX_INPUT ) )
+				{
+					memmove ( &data[pos + n], &data[pos], len - pos );
+					len += n;
+				}
+				break;
+
+			default: /* splice tail of another corpus entry */
+				other = &corpus[_rand () % total_corpus];
+				if ( other->len > 0 )
+				{
+					n = _rand () % other->len;
+					n = ( ( pos + other->len - n ) <= FZ_MAX_INPUT ) ? n : other->len;
+					memcpy ( &data[pos], &other->data[n], other->len - n );
+					len = pos + other->len - n;
+				}
+				break;
+		}
+	}
+
+	return len;
+}
+
+/* This function executes one input, keeps it if it reached new coverage and
+ * records it if it failed. Returns true if the input passed.
+*/
+static bool _run_input ( const uint8_t *data, uint32_t len, const char *crash_dir )
+{
+	tr_result_t res;
+	uint32_t total_ops = _decode ( data, len, fz_ops );
+
+	memset ( cov_map, 0, sizeof(cov_map) );
+	prev_loc = 0;
+
+	if ( false == tr_execute ( fz_ops, total_ops, &res ) )
+	{
+		_record_crash ( res.fail_op + 1u, &res, crash_dir );
+		return false;
+	}
+	if ( true == _new_coverage () )
+	{
+		_add_corpus ( data, len );
+	}
+
+	return true;
+}
+
+/* This function merges hit count classes of current execution into virgin
+ * map, returns true if any edge or hit count class is new
+*/
+static bool _new_coverage ( void )
+{
+	static const uint8_t classes[8] = { 1, 2, 4, 8, 8, 16, 32, 64 };
+	uint64_t w;
+	uint8_t c;
+	uint8_t cls;
+	bool found = false;
+
+	for ( uint32_t i = 0; i < FZ_MAP_SIZE; i += 8u )
+	{
+		memcpy ( &w, &cov_map[i], 8 );
+		if ( 0 == w )
+		{
+			continue;
+		}
+		for ( uint32_t k = i; k < ( i + 8u ); k++ )
+		{
+			c = cov_map[k];
+			if ( 0 == c )
+			{
+				continue;
+			}
+			/* AFL style buckets: 1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+ */
+			cls = ( c < 4u ) ? classes[c - 1u] : ( c < 8u ) ? 8u : ( c < 16u ) ? 16u :
+				  ( c < 32u ) ? 32u : ( c < 128u ) ? 64u : 128u;
+			if ( 0 != ( cls & ~virgin_map[k] ) )
+			{
+				if ( 0 == virgin_map[k] )
+				{
+					total_edges++;
+				}
+				virgin_map[k] |= cls;
+				found = true;
+			}
+		}
+	}
+
+	return found;
+}
+
+/* This function adds a copy of an input to the corpus
+*/
+static void _add_corpus ( const uint8_t *data, uint32_t len )
+{
+	uint8_t *copy;
+
+	if ( total_corpus >= FZ_MAX_CORPUS )
+	{
+		return;
+	}
+	copy = malloc ( FZ_MAX_INPUT );
+	if ( NULL == copy )
+	{
+		return;
+	}
+	memcpy ( copy, data, len );
+	corpus[total_corpus].data = copy;
+	corpus[total_corpus].len = len;
+	total_corpus++;
+}
+
+/* This function shrinks and stores a failure not seen before, returns true if
+ * it's new
+*/
+static bool _record_crash ( uint32_t total_ops, const tr_result_t *res, const char *crash_dir )
+{
+	static uint8_t encoded[FZ_MAX_INPUT];
+	fz_crash_t *c;
+	uint8_t op_type = fz_ops[total_ops - 1u].type;
+	uint32_t len;
+	char path[512];
+	FILE *f;
+	int n;
+
+	for ( uint32_t i = 0; i < total_crashes; i++ )
+	{
+		if ( ( res->reason == crashes[i].reason ) && ( op_type == crashes[i].op_type ) )
+		{
+			return false;
+		}
+	}
+	if ( total_crashes >= FZ_MAX_CRASHES )
+	{
+		return false;
+	}
+
+	c = &crashes[total_crashes++];
+	c->reason = res->reason;
+	c->op_type = op_type;
+	c->total_ops = tr_shrink ( fz_ops, total_ops );
+	memcpy ( c->ops, fz_ops, c->total_ops * sizeof(tr_op_t) );
+	len = _encode ( c->ops, c->total_ops, encoded );
+	c->hash = _hash ( encoded, len );
+
+	tr_format ( c->ops, c->total_ops, msg_buff, FZ_MSG_SIZE );
+	printf ( "[ERROR] %s\r\n[ERROR] minimal repro (%u ops): %s\r\n", res->reason,
+			 (unsigned int)c->total_ops, msg_buff );
+
+	mkdir ( crash_dir, 0755 );
+	n = snprintf ( path, sizeof(path), "%s/crash-%08x.bin", crash_dir, (unsigned int)c->hash );
+	f = ( n > 0 ) ? fopen ( path, "wb" ) : NULL;
+	if ( NULL != f )
+	{
+		fwrite ( encoded, 1, len, f );
+		fclose ( f );
+		printf ( "[INFO] input saved to %s\r\n", path );
+	}
+	fflush ( stdout );
+
+	return true;
+}
+
+/* This function encodes operations into fuzzer input bytes
+*/
+static uint32_t _encode ( const tr_op_t *ops, uint32_t total_ops, uint8_t *data )
+{
+	uint32_t len = 0;
+
+	for ( uint32_t i = 0; i < total_ops; i++ )
+	{
+		data[len++] = ops[i].type;
+		if ( TR_OP_ENQUEUE == ops[i].type )
+		{
+			data[len++] = (uint8_t)ops[i].val;
+		}
+	}
+
+	return len;
+}
+
+/* This function returns FNV-1a hash of data
+*/
+static uint32_t _hash ( const uint8_t *data, uint32_t len )
+{
+	uint32_t h = 2166136261u;
+
+	for ( uint32_t i = 0; i < len; i++ )
+	{
+		h = ( h ^ data[i] ) * 16777619u;
+	}
+
+	return h;
+}
+
+/* This function reads an input file, truncated to FZ_MAX_INPUT
+*/
+static bool _load_file ( const char *path, uint8_t *data, uint32_t *len )
+{
+	FILE *f = fopen ( path, "rb" );
+
+	if ( NULL == f )
+	{
+		return false;
+	}
+	*len = (uint32_t)fread ( data, 1, FZ_MAX_INPUT, f );
+	fclose ( f );
+
+	return true;
+}
+
+/* This function writes unique failures as regression test cases replaying
+ * the shrunk sequence through the randomized tester
+*/
+static bool _export ( const char *path )
+{
+	static const char *op_names[] = { "TR_OP_INIT", "TR_OP_ENQUEUE", "TR_OP_DEQUEUE", "TR_OP_IS_EMPTY" };
+	FILE *f = fopen ( path, "w" );
+
+	if ( NULL == f )
+	{
+		return false;
+	}
+
+	fprintf ( f, "/* Queue fuzzer regression cases, generated by cq_fuzz.\n"
+				 " * Add fuzz_regression_cases[] entries to the test case list.\n */\n\n"
+				 "#include <stdint.h>\n#include <stdbool.h>\n\n"
+				 "#include \"sut/circular_queue.h\"\n#include \"test_controller.h\"\n"
+				 "#include \"test_random.h\"\n\n" );
+
+	for ( uint32_t i = 0; i < total_crashes; i++ )
+	{
+		fprintf ( f, "/* %s */\nstatic const tr_op_t fuzz_ops_%08x[] = {\n",
+				  crashes[i].reason, (unsigned int)crashes[i].hash );
+		for ( uint32_t k = 0; k < crashes[i].total_ops; k++ )
+		{
+			fprintf ( f, "\t{ %s, %u },\n", op_names[crashes[i].ops[k].type & 0x03u],
+					  (unsigned int)crashes[i].ops[k].val );
+		}
+		fprintf ( f, "};\nstatic tr_config_t fuzz_cfg_%08x = { .seed = 1, .iterations = 1,\n"
+					 "\t.p_ops = fuzz_ops_%08x, .total_ops = %u };\n\n",
+				  (unsigned int)crashes[i].hash, (unsigned int)crashes[i].hash,
+				  (unsigned int)crashes[i].total_ops );
+	}
+
+	fprintf ( f, "test_case_t fuzz_regression_cases[] = {\n" );
+	for ( uint32_t i = 0; i < total_crashes; i++ )
+	{
+		fprintf ( f, "\t{\n\t\t.p_tc_init_fn = tr_tc_init,\n\t\t.p_tc_run_fn = tr_tc_run,\n"
+					 "\t\t.p_input_data = (void *)&fuzz_cfg_%08x,\n\t\t.name = \"fuzz_%08x\"\n\t},\n",
+				  (unsigned int)crashes[i].hash, (unsigned int)crashes[i].hash );
+	}
+	fprintf ( f, "};\n\nconst uint32_t fuzz_regression_total = %u;\n",
+			  (unsigned int)total_crashes );
+
+	return ( 0 == fclose ( f ) );
+}
+
+#endif
+
+/*** end of file ***/
@@ -0,0 +1,528 @@
+/** @file cq_model_check.c
+ *
+ * @brief This file implements a parallel bounded model checker for circular
+ *        queue. Starting from an initialized queue, every reachable state is
+ *        explored breadth first over all operations (init, enqueue of each
+ *        value of a small domain, dequeue, is_empty) and checked against a
+ *        reference FIFO of capacity CQ_SIZE:
+ *          - wr/rd indexes stay inside buff[]
+ *          - enqueue is accepted only while count < capacity
+ *          - dequeue returns values in FIFO order
+ *          - cq_is_empty agrees with the fill level
+ *        Buffer slots outside the live [rd, wr) range are overwritten with a
+ *        poison value after every step. Stale contents then do not multiply
+ *        the state space, and a read of a stale slot still shows up as a FIFO
+ *        violation since poison is never enqueued.
+ *        States are deduplicated in a lock-free open addressing hash set and
+ *        each BFS level is split across worker threads. When the whole state
+ *        space is explored without violation the queue is proven correct for
+ *        the given capacity and value domain, otherwise the shortest
+ *        counterexample is printed.
+ *
+ * @par Build and run (capacity is selected at build time)
+ *        gcc -O2 -pthread -I.. -DCQ_SIZE=4 cq_model_check.c \
+ *            ../sut/circular_queue.c -o cq_model_check
+ *        ./cq_model_check [-t threads] [-v values] [-m max_states]
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "sut/circular_queue.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define MC_MAX_THREADS		64u
+#define MC_MAX_VALUES		16u
+#define MC_CHUNK			256u 		/* frontier states taken per grab */
+#define MC_GUARD_SIZE		256u 		/* absorbs writes through 8-bit index */
+#define MC_NO_PARENT		UINT32_MAX
+#define MC_POISON			(cq_val_t)0xFF 	/* marks buffer slots outside [rd, wr) */
+
+/* Defines number of slots in queue buffer
+*/
+#define MC_BUFF_LEN			( sizeof(((cq_t *)0)->buff) / sizeof(cq_val_t) )
+
+/* Defines operations explored from every state
+*/
+typedef enum MC_OPS {
+
+	MC_OP_INIT = 0,
+	MC_OP_ENQUEUE = 1,
+	MC_OP_DEQUEUE = 2,
+	MC_OP_IS_EMPTY = 3
+
+} mc_op_t;
+
+/* Defines explored state: raw SUT queue plus reference model contents,
+ * model values are stored from head so that equal queues compare equal
+*/
+typedef struct MC_KEY {
+
+	cq_t 		q;
+	uint8_t 	count;
+	cq_val_t 	vals[CQ_SIZE];
+
+} mc_key_t;
+
+/* Defines state node, nodes are stored in BFS order
+*/
+typedef struct MC_NODE {
+
+	mc_key_t 	key;
+	uint32_t 	parent; 	/* index of predecessor node */
+	uint8_t 	op; 		/* operation leading to this node */
+	cq_val_t 	val; 		/* enqueued value */
+	uint8_t 	dup; 		/* lost an insert race, not part of state space */
+
+} mc_node_t;
+
+/* Defines SUT queue placed in front of a guard area
+*/
+typedef struct MC_FIXTURE {
+
+	mc_key_t 	key;
+	uint8_t 	guard[MC_GUARD_SIZE];
+
+} mc_fixture_t;
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+static mc_node_t *nodes; /* state storage */
+static _Atomic uint32_t *table; /* hash set, holds node index + 1 */
+static uint32_t table_mask;
+static uint32_t max_nodes;
+static _Atomic uint32_t total_nodes;
+static _Atomic uint32_t frontier_next; /* next frontier node to grab */
+static uint32_t frontier_end;
+static _Atomic uint64_t transitions;
+static atomic_bool overflow;
+
+static uint32_t total_values = 2;
+
+/* first violation found */
+static pthread_mutex_t violation_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool violation_found;
+static uint32_t violation_node;
+static uint8_t violation_op;
+static cq_val_t violation_val;
+static const char *violation_reason;
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static uint32_t _hash ( const mc_key_t *key );
+static bool _insert ( const mc_key_t *key, uint32_t parent, uint8_t op, cq_val_t val );
+static const char *_step ( const mc_key_t *from, uint8_t op, cq_val_t val, mc_key_t *to );
+static void _report ( uint32_t parent, uint8_t op, cq_val_t val, const char *reason );
+static void *_worker ( void *arg );
+static void _print_path ( uint32_t idx, uint8_t last_op, cq_val_t last_val );
+static void _poison_stale ( cq_t *q );
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+int main ( int argc, char *argv[] )
+{
+	pthread_t threads[MC_MAX_THREADS];
+	uint32_t total_threads = (uint32_t)sysconf ( _SC_NPROCESSORS_ONLN );
+	uint32_t level_start = 0;
+	uint32_t depth = 0;
+	uint32_t states = 0;
+	uint32_t table_size;
+	mc_key_t init_key;
+	int opt;
+
+	max_nodes = 1u << 22;
+
+	while ( ( opt = getopt ( argc, argv, "t:v:m:h" ) ) != -1 )
+	{
+		switch ( opt )
+		{
+			case 't':
+				total_threads = (uint32_t)strtoul ( optarg, NULL, 0 );
+				break;
+
+			case 'v':
+				total_values = (uint32_t)strtoul ( optarg, NULL, 0 );
+				break;
+
+			case 'm':
+				max_nodes = (uint32_t)strtoul ( optarg, NULL, 0 );
+				break;
+
+			default:
+				printf ( "usage: %s [-t threads] [-v values] [-m max_states]\r\n", argv[0] );
+				return ( 'h' == opt ) ? 0 : 2;
+		}
+	}
+
+	if ( ( 0 == total_threads ) || ( total_threads > MC_MAX_THREADS ) )
+	{
+		total_threads = ( 0 == total_threads ) ? 1u : MC_MAX_THREADS;
+	}
+	if ( ( 0 == total_values ) || ( total_values > MC_MAX_VALUES ) )
+	{
+		total_values = ( 0 == total_values ) ? 1u : MC_MAX_VALUES;
+	}
+
+	/* hash set is kept at most half full */
+	for ( table_size = 1024u; table_size < ( 2u * max_nodes ); table_size <<= 1 )
+	{
+	}
+	table_mask = table_size - 1u;
+
+	nodes = malloc ( (size_t)max_nodes * sizeof(mc_node_t) );
+	table = calloc ( table_size, sizeof(*table) );
+	if ( ( NULL == nodes ) || ( NULL == table ) )
+	{
+		printf ( "[ERROR] out of memory for %u states\r\n", (unsigned int)max_nodes );
+		return 2;
+	}
+
+	printf ( "[INFO] capacity %u, values %u, threads %u\r\n", (unsigned int)CQ_SIZE,
+			 (unsigned int)total_values, (unsigned int)total_threads );
+
+	/* initial state is a freshly initialized queue */
+	memset ( &init_key, 0, sizeof(init_key) );
+	cq_init ( &init_key.q );
+	_poison_stale ( &init_key.q );
+	_insert ( &init_key, MC_NO_PARENT, MC_OP_INIT, 0 );
+
+	while ( ( level_start < atomic_load ( &total_nodes ) ) &&
+			( false == violation_found ) && ( false == atomic_load ( &overflow ) ) )
+	{
+		frontier_end = atomic_load ( &total_nodes );
+		atomic_store ( &frontier_next, level_start );
+
+		for ( uint32_t i = 0; i < total_threads; i++ )
+		{
+			pthread_create ( &threads[i], NULL, _worker, NULL );
+		}
+		for ( uint32_t i = 0; i < total_threads; i++ )
+		{
+			pthread_join ( threads[i], NULL );
+		}
+
+		level_start = frontier_end;
+		depth++;
+	}
+
+	if ( atomic_load ( &total_nodes ) > max_nodes )
+	{
+		atomic_store ( &total_nodes, max_nodes );
+	}
+	for ( uint32_t i = 0; i < atomic_load ( &total_nodes ); i++ )
+	{
+		states += ( 0 == nodes[i].dup ) ? 1u : 0u;
+	}
+
+	printf ( "[INFO] %u states, %llu transitions, depth %u\r\n", (unsigned int)states,
+			 (unsigned long long)atomic_load ( &transitions ), (unsigned int)depth );
+
+	if ( true == violation_found )
+	{
+		printf ( "[ERROR] VIOLATION: %s\r\n", violation_reason );
+		_print_path ( violation_node, violation_op, violation_val );
+		return 1;
+	}
+
+	if ( true == atomic_load ( &overflow ) )
+	{
+		printf ( "[ERROR] state limit %u reached, state space not fully explored\r\n",
+				 (unsigned int)max_nodes );
+		return 2;
+	}
+
+	printf ( "[INFO] PROVED: all invariants hold in every reachable state\r\n" );
+
+	return 0;
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function hashes a state key (FNV-1a)
+*/
+static uint32_t _hash ( const mc_key_t *key )
+{
+	const uint8_t *p = (const uint8_t *)key;
+	uint32_t h = 2166136261u;
+
+	for ( uint32_t i = 0; i < sizeof(mc_key_t); i++ )
+	{
+		h = ( h ^ p[i] ) * 16777619u;
+	}
+
+	return h;
+}
+
+/* This function adds a state unless already known. The set is probed before
+ * a node is reserved so that storage is only wasted on lost insert races.
+*/
+static bool _insert ( const mc_key_t *key, uint32_t parent, uint8_t op, cq_val_t val )
+{
+	uint32_t slot = _hash ( key ) & table_mask;
+	uint32_t idx = MC_NO_PARENT;
+	uint32_t cur;
+
+	for ( ;; )
+	{
+		cur = atomic_load_explicit ( &table[slot], memory_order_acquire );
+		if ( 0 == cur )
+		{
+			if ( MC_NO_PARENT == idx )
+			{
+				idx = atomic_fetch_add ( &total_nodes, 1u );
+				if ( idx >= max_nodes )
+				{
+					atomic_store ( &overflow, true );
+					return false;
+				}
+				nodes[idx].key = *key;
+				nodes[idx].parent = parent;
+				nodes[idx].op = op;
+				nodes[idx].val = val;
+				nodes[idx].dup = 0;
+			}
+			if ( true == atomic_compare_exchange_strong_explicit ( &table[slot], &cur, idx + 1u,
+										memory_order_acq_rel, memory_order_acquire ) )
+			{
+				return true;
+			}
+		}
+
+		if ( 0 == memcmp ( &nodes[cur - 1u].key, key, sizeof(mc_key_t) ) )
+		{
+			if ( MC_NO_PARENT != idx )
+			{
+				nodes[idx].dup = 1;
+			}
+			return false;
+		}
+		slot = ( slot + 1u ) & table_mask;
+	}
+}
+
+/* This function applies one operation to a copy of the state and checks the
+ * invariants, returns violation reason or NULL
+*/
+static const char *_step ( const mc_key_t *from, uint8_t op, cq_val_t val, mc_key_t *to )
+{
+	mc_fixture_t fx;
+	cq_status_t stat;
+	cq_val_t out;
+	const char *reason = NULL;
+
+	fx.key = *from;
+
+	switch ( op )
+	{
+		case MC_OP_INIT:
+			cq_init ( &fx.key.q );
+			fx.key.count = 0;
+			break;
+
+		case MC_OP_ENQUEUE:
+			stat = cq_enqueue ( &fx.key.q, val );
+			if ( fx.key.count < CQ_SIZE )
+			{
+				fx.key.vals[fx.key.count++] = val;
+				if ( CQ_OK != stat )
+				{
+					reason = "cq_enqueue() rejected value while count < capacity";
+				}
+			}
+			else if ( CQ_IS_FULL != stat )
+			{
+				reason = "cq_enqueue() accepted value, count exceeds capacity";
+			}
+			break;
+
+		case MC_OP_DEQUEUE:
+			out = (cq_val_t)~fx.key.vals[0];
+			stat = cq_dequeue ( &fx.key.q, &out );
+			if ( fx.key.count > 0 )
+			{
+				if ( CQ_OK != stat )
+				{
+					reason = "cq_dequeue() returned EMPTY while count > 0";
+				}
+				else if ( out != fx.key.vals[0] )
+				{
+					reason = "cq_dequeue() violated FIFO order";
+				}
+				fx.key.count--;
+				memmove ( &fx.key.vals[0], &fx.key.vals[1], fx.key.count );
+				fx.key.vals[fx.key.count] = 0;
+			}
+			else if ( CQ_IS_EMPTY != stat )
+			{
+				reason = "cq_dequeue() returned a value from empty queue";
+			}
+			break;
+
+		default:
+			if ( cq_is_empty ( &fx.key.q ) != ( fx.key.count < CQ_SIZE ) )
+			{
+				reason = "cq_is_empty() disagrees with fill level";
+			}
+			break;
+	}
+
+	if ( ( NULL == reason ) && ( ( fx.key.q.wr >= MC_BUFF_LEN ) || ( fx.key.q.rd >= MC_BUFF_LEN ) ) )
+	{
+		reason = "queue index out of buffer bounds";
+	}
+
+	if ( NULL == reason )
+	{
+		_poison_stale ( &fx.key.q );
+	}
+	*to = fx.key;
+
+	return reason;
+}
+
+/* This function records the first violation
+*/
+static void _report ( uint32_t parent, uint8_t op, cq_val_t val, const char *reason )
+{
+	pthread_mutex_lock ( &violation_lock );
+	if ( ( false == violation_found ) || ( parent < violation_node ) )
+	{
+		violation_found = true;
+		violation_node = parent;
+		violation_op = op;
+		violation_val = val;
+		violation_reason = reason;
+	}
+	pthread_mutex_unlock ( &violation_lock );
+}
+
+/* This function expands frontier states in chunks until the level is done
+*/
+static void *_worker ( void *arg )
+{
+	mc_key_t next;
+	const char *reason;
+	uint32_t first;
+	uint32_t last;
+	uint64_t local_transitions = 0;
+
+	(void)arg;
+
+	for ( ;; )
+	{
+		first = atomic_fetch_add ( &frontier_next, MC_CHUNK );
+		if ( first >= frontier_end )
+		{
+			break;
+		}
+		last = ( ( first + MC_CHUNK ) < frontier_end ) ? ( first + MC_CHUNK ) : frontier_end;
+
+		for ( uint32_t i = first; i < last; i++ )
+		{
+			if ( 0 != nodes[i].dup )
+			{
+				continue;
+			}
+
+			for ( uint8_t op = MC_OP_INIT; op <= MC_OP_IS_EMPTY; op++ )
+			{
+				uint32_t total = ( MC_OP_ENQUEUE == op ) ? total_values : 1u;
+
+				for ( uint32_t v = 0; v < total; v++ )
+				{
+					local_transitions++;
+					reason = _step ( &nodes[i].key, op, (cq_val_t)v, &next );
+					if ( NULL != reason )
+					{
+						_report ( i, op, (cq_val_t)v, reason );
+					}
+					else
+					{
+						_insert ( &next, i, op, (cq_val_t)v );
+					}
+				}
+			}
+		}
+	}
+
+	atomic_fetch_add ( &transitions, local_transitions );
+
+	return NULL;
+}
+
+/* This function prints the operation path from initial state to a node
+*/
+static void _print_path ( uint32_t idx, uint8_t last_op, cq_val_t last_val )
+{
+	static const char *op_names[] = { "INIT", "ENQ", "DEQ", "EMPTY?" };
+	uint32_t path[256];
+	uint32_t len = 0;
+
+	while ( ( MC_NO_PARENT != nodes[idx].parent ) && ( len < 256u ) )
+	{
+		path[len++] = idx;
+		idx = nodes[idx].parent;
+	}
+
+	printf ( "[ERROR] counterexample (%u ops):", (unsigned int)( len + 1u ) );
+	while ( len > 0 )
+	{
+		idx = path[--len];
+		if ( MC_OP_ENQUEUE == nodes[idx].op )
+		{
+			printf ( " ENQ(%u)", (unsigned int)nodes[idx].val );
+		}
+		else
+		{
+			printf ( " %s", op_names[nodes[idx].op] );
+		}
+	}
+	if ( MC_OP_ENQUEUE == last_op )
+	{
+		printf ( " ENQ(%u)\r\n", (unsigned int)last_val );
+	}
+	else
+	{
+		printf ( " %s\r\n", op_names[last_op] );
+	}
+}
+
+/* This function overwrites buffer slots which don't hold a queued value,
+ * these are [wr, rd) or the whole buffer when wr == rd (empty queue)
+*/
+static void _poison_stale ( cq_t *q )
+{
+	uint32_t idx = q->wr;
+
+	do
+	{
+		q->buff[idx] = MC_POISON;
+		idx = ( idx + 1u ) % MC_BUFF_LEN;
+	} while ( idx != q->rd );
+}
+
+/*** end of file ***/
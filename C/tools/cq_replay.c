@@ -0,0 +1,287 @@
+/** @file cq_replay.c
+ *
+ * @brief This file implements the replay engine for circular queue call
+ *        traces recorded by cq_trace.c. Every recorded call is executed
+ *        against the SUT build the tool is linked with and its results are
+ *        compared with the recorded ones; the first divergence is reported
+ *        with the test case it belongs to. Queue images recorded for writes
+ *        made outside the API are restored before the next call.
+ *
+ * @par Build and run
+ *        gcc -O2 -I.. cq_replay.c ../sut/circular_queue.c -o cq_replay
+ *        ./cq_replay [-v] [-k] trace_file
+ *          -v  print every replayed call
+ *          -k  keep going after a divergence, report all of them
+ *        Exit code is 0 when the SUT reproduces the trace, 1 on divergence,
+ *        2 on a bad trace file.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sut/circular_queue.h"
+#include "cq_trace.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+/* Defines guard area after each replayed queue, absorbs writes beyond a
+ * queue the same way neighbouring memory did while recording
+*/
+#define RP_GUARD_SIZE	256u
+
+/* Defines replayed queue
+*/
+typedef struct RP_QUEUE {
+
+	cq_t 		q;
+	uint8_t 	guard[RP_GUARD_SIZE];
+
+} rp_queue_t;
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+static rp_queue_t queues[CQT_MAX_QUEUES];
+static const char *op_names[] = { "cq_init", "cq_enqueue", "cq_dequeue", "cq_is_empty", "sync", "case" };
+
+/* record bytes following the op byte, indexed by cqt_op_t */
+static const uint32_t payload_size[] = { 0, sizeof(cq_val_t) + 1u, 1u + sizeof(cq_val_t), 1u, sizeof(cq_t), 4u };
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static uint8_t *_load ( const char *path, uint32_t *len );
+static uint32_t _get_u32 ( const uint8_t *p );
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+int main ( int argc, char *argv[] )
+{
+	struct timespec t0;
+	struct timespec t1;
+	uint8_t *trace;
+	uint32_t len;
+	uint32_t pos;
+	uint32_t rec = 0;
+	uint32_t total_records;
+	uint32_t flags;
+	uint32_t curr_case = 0xFFFFFFFFu;
+	uint32_t diverged = 0;
+	bool verbose = false;
+	bool keep_going = false;
+	cq_status_t stat;
+	cq_val_t val;
+	uint8_t op;
+	uint8_t id;
+	uint32_t exp;
+	uint32_t act;
+	uint32_t arg;
+	double ms;
+	int opt;
+
+	while ( ( opt = getopt ( argc, argv, "vkh" ) ) != -1 )
+	{
+		switch ( opt )
+		{
+			case 'v':
+				verbose = true;
+				break;
+
+			case 'k':
+				keep_going = true;
+				break;
+
+			default:
+				printf ( "usage: %s [-v] [-k] trace_file\r\n", argv[0] );
+				return ( 'h' == opt ) ? 0 : 2;
+		}
+	}
+	if ( optind >= argc )
+	{
+		printf ( "usage: %s [-v] [-k] trace_file\r\n", argv[0] );
+		return 2;
+	}
+
+	trace = _load ( argv[optind], &len );
+	if ( ( NULL == trace ) || ( len < CQT_HEADER_SIZE ) || ( 0 != memcmp ( trace, "CQT1", 4 ) ) )
+	{
+		printf ( "[ERROR] %s is not a queue trace\r\n", argv[optind] );
+		return 2;
+	}
+	if ( ( sizeof(cq_t) != trace[5] ) || ( sizeof(cq_val_t) != trace[6] ) )
+	{
+		printf ( "[ERROR] trace recorded with a different cq_t layout (%u/%u bytes)\r\n",
+				 (unsigned int)trace[5], (unsigned int)trace[6] );
+		return 2;
+	}
+	if ( CQ_SIZE != trace[4] )
+	{
+		printf ( "[INFO] trace recorded with CQ_SIZE %u, replaying with %u\r\n",
+				 (unsigned int)trace[4], (unsigned int)CQ_SIZE );
+	}
+	total_records = _get_u32 ( &trace[8] );
+	flags = _get_u32 ( &trace[12] );
+	if ( 0 != ( flags & CQT_FLAG_QUEUES ) )
+	{
+		printf ( "[WARNING] trace is incomplete, calls on more than %u queues weren't recorded\r\n",
+				 (unsigned int)CQT_MAX_QUEUES );
+	}
+	else if ( 0 != ( flags & CQT_FLAG_TRUNCATED ) )
+	{
+		printf ( "[INFO] trace is truncated, recording buffer was full\r\n" );
+	}
+
+	clock_gettime ( CLOCK_MONOTONIC, &t0 );
+
+	for ( pos = CQT_HEADER_SIZE; ( pos < len ) && ( rec < total_records ); rec++ )
+	{
+		op = trace[pos] & CQT_OP_MASK;
+		id = (uint8_t)( trace[pos] >> CQT_ID_SHIFT ) & ( CQT_MAX_QUEUES - 1u );
+		pos++;
+		exp = 0;
+		act = 0;
+		arg = 0;
+
+		if ( op > CQT_OP_CASE )
+		{
+			printf ( "[ERROR] unknown record %u at offset %u\r\n", (unsigned int)rec, (unsigned int)( pos - 1u ) );
+			return 2;
+		}
+		if ( ( len - pos ) < payload_size[op] )
+		{
+			printf ( "[ERROR] trace ends inside record %u\r\n", (unsigned int)rec );
+			return 2;
+		}
+
+		switch ( op )
+		{
+			case CQT_OP_CASE:
+				curr_case = _get_u32 ( &trace[pos] );
+				pos += 4u;
+				continue;
+
+			case CQT_OP_SYNC:
+				memcpy ( &queues[id].q, &trace[pos], sizeof(cq_t) );
+				pos += sizeof(cq_t);
+				continue;
+
+			case CQT_OP_INIT:
+				cq_init ( &queues[id].q );
+				break;
+
+			case CQT_OP_ENQUEUE:
+				memcpy ( &val, &trace[pos], sizeof(val) );
+				arg = val;
+				exp = trace[pos + sizeof(val)];
+				act = (uint32_t)cq_enqueue ( &queues[id].q, val );
+				pos += sizeof(val) + 1u;
+				break;
+
+			case CQT_OP_DEQUEUE:
+				val = 0;
+				stat = cq_dequeue ( &queues[id].q, &val );
+				memcpy ( &arg, &trace[pos + 1u], sizeof(val) );
+				/* status and value compared as one */
+				exp = ( (uint32_t)trace[pos] << 16 ) | arg;
+				act = ( (uint32_t)stat << 16 ) | ( ( CQ_OK == stat ) ? val : 0u );
+				pos += 1u + sizeof(val);
+				break;
+
+			case CQT_OP_IS_EMPTY:
+				exp = trace[pos];
+				act = ( true == cq_is_empty ( &queues[id].q ) ) ? 1u : 0u;
+				pos++;
+				break;
+
+			default:
+				break;
+		}
+
+		if ( true == verbose )
+		{
+			printf ( "%u case %u q%u %s(%u) = 0x%x\r\n", (unsigned int)rec, (unsigned int)curr_case,
+					 (unsigned int)id, op_names[op], (unsigned int)arg, (unsigned int)act );
+		}
+		if ( exp != act )
+		{
+			diverged++;
+			printf ( "[DIVERGED] record %u, test case %u, q%u %s(%u): recorded 0x%x, replayed 0x%x\r\n",
+					 (unsigned int)rec, (unsigned int)curr_case, (unsigned int)id, op_names[op],
+					 (unsigned int)arg, (unsigned int)exp, (unsigned int)act );
+			if ( false == keep_going )
+			{
+				break;
+			}
+		}
+	}
+
+	clock_gettime ( CLOCK_MONOTONIC, &t1 );
+	ms = (double)( t1.tv_sec - t0.tv_sec ) * 1e3 + (double)( t1.tv_nsec - t0.tv_nsec ) / 1e6;
+	printf ( "%u of %u records replayed in %.3f ms, %u divergence(s)%s\r\n",
+			 (unsigned int)rec, (unsigned int)total_records, ms, (unsigned int)diverged,
+			 ( 0 != ( flags & CQT_FLAG_TRUNCATED ) ) ? ", trace incomplete" : "" );
+
+	free ( trace );
+
+	return ( 0 == diverged ) ? 0 : 1;
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function reads a whole file into memory
+*/
+static uint8_t *_load ( const char *path, uint32_t *len )
+{
+	FILE *f = fopen ( path, "rb" );
+	uint8_t *buff = NULL;
+	long size;
+
+	if ( NULL == f )
+	{
+		return NULL;
+	}
+	if ( ( 0 == fseek ( f, 0, SEEK_END ) ) && ( ( size = ftell ( f ) ) > 0 ) &&
+		 ( 0 == fseek ( f, 0, SEEK_SET ) ) )
+	{
+		buff = malloc ( (size_t)size );
+		if ( ( NULL != buff ) && ( (size_t)size != fread ( buff, 1, (size_t)size, f ) ) )
+		{
+			free ( buff );
+			buff = NULL;
+		}
+		*len = (uint32_t)size;
+	}
+	fclose ( f );
+
+	return buff;
+}
+
+/* This function loads little endian u32
+*/
+static uint32_t _get_u32 ( const uint8_t *p )
+{
+	return (uint32_t)p[0] | ( (uint32_t)p[1] << 8 ) |
+		   ( (uint32_t)p[2] << 16 ) | ( (uint32_t)p[3] << 24 );
+}
+
+/*** end of file ***/
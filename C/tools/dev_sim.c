@@ -0,0 +1,424 @@
+/** @file dev_sim.c
+ *
+ * @brief This file implements a host side device simulator. The test
+ *        controller and test application run as on target, with the
+ *        controller console transport connected to a pseudo-terminal. Host
+ *        tools open the pty slave like the board's serial port. The link is
+ *        emulated with configurable one way latency and bandwidth in both
+ *        directions; in virtual time mode bytes are delivered at full host
+ *        speed and the time the link would have taken is reported instead,
+ *        which makes link bound runs deterministic to benchmark.
+ *
+ * @par Build and run
+ *        gcc -O2 -I.. dev_sim.c ../test_controller.c ../tc_guard.c \
+ *            ../test_app.c ../test_random.c ../test_param.c \
+ *            ../tc_proto.c ../tc_perf.c ../sut/circular_queue.c -o dev_sim
+ *        ./dev_sim [-b bytes_per_sec] [-l latency_us] [-p link_path] [-V] [-w] [-k] [-B]
+ *          -b  link bandwidth per direction in bytes/s, 0 = unlimited (default)
+ *          -l  one way link latency in microseconds (default 0)
+ *          -p  create symlink to the pty slave at given path
+ *          -V  virtual link time
+ *          -w  wait for "run" console command before starting test list
+ *          -k  keep serving console commands after test list completed
+ *          -B  binary protocol (tc_proto) instead of text console, keeps
+ *              serving host commands until terminated
+ *        The pty slave path is printed on stdout once it is ready.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+
+#include "test_controller.h"
+#include "tc_proto.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define SIM_LINK_SIZE		65536u 		/* bytes in flight per direction */
+#define SIM_DRAIN_TIMEOUT	2000000u 	/* max wait for host to read output, us */
+#define SIM_DRAIN_QUIET		20000u 		/* output idle time before closing, us */
+#define SIM_IDLE_POLL		1 			/* poll timeout when nothing is due, ms */
+
+/* Defines one link direction, every byte carries its delivery time
+*/
+typedef struct SIM_LINK {
+
+	uint8_t 	data[SIM_LINK_SIZE];
+	uint64_t 	due[SIM_LINK_SIZE];
+	uint32_t 	head;
+	uint32_t 	count;
+	uint64_t 	tx_free; 	/* time the sender finishes serializing queued bytes */
+	uint64_t 	tx_frac; 	/* part of a us not in tx_free yet, in us * bandwidth */
+	uint64_t 	total; 		/* bytes carried */
+
+} sim_link_t;
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+static sim_link_t up_link; /* device -> host */
+static sim_link_t down_link; /* host -> device */
+static int master_fd = -1;
+static int slave_fd = -1;
+
+static uint64_t bandwidth; /* bytes per second, 0 = unlimited */
+static uint64_t latency; /* us */
+static bool virtual_time;
+static uint64_t link_time; /* latest delivery time, virtual mode */
+static uint64_t start_time;
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static uint64_t _now ( void );
+static void _link_push ( sim_link_t *link, uint8_t byte );
+static bool _link_due ( const sim_link_t *link );
+static bool _host_connected ( void );
+static void _service ( void );
+static void _dev_write ( const uint8_t *data, uint32_t len );
+static uint32_t _dev_read ( uint8_t *data, uint32_t len );
+
+static const tc_transport_t sim_transport = {
+	.p_write_fn = _dev_write,
+	.p_read_fn = _dev_read
+};
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+int main ( int argc, char *argv[] )
+{
+	struct termios tio;
+	const char *link_path = NULL;
+	const char *slave_name;
+	bool wait_run = false;
+	bool keep = false;
+	bool binary = false;
+	uint32_t waited = 0;
+	uint32_t quiet = 0;
+	int pending = 0;
+	int opt;
+
+	while ( ( opt = getopt ( argc, argv, "b:l:p:VwkBh" ) ) != -1 )
+	{
+		switch ( opt )
+		{
+			case 'b':
+				bandwidth = strtoull ( optarg, NULL, 0 );
+				break;
+
+			case 'l':
+				latency = strtoull ( optarg, NULL, 0 );
+				break;
+
+			case 'p':
+				link_path = optarg;
+				break;
+
+			case 'V':
+				virtual_time = true;
+				break;
+
+			case 'w':
+				wait_run = true;
+				break;
+
+			case 'k':
+				keep = true;
+				break;
+
+			case 'B':
+				binary = true;
+				keep = true;
+				wait_run = true;
+				break;
+
+			default:
+				fprintf ( stderr, "usage: %s [-b bytes_per_sec] [-l latency_us] [-p link_path] [-V] [-w] [-k] [-B]\r\n", argv[0] );
+				return ( 'h' == opt ) ? 0 : 2;
+		}
+	}
+
+	/* Open pty and put the line into raw mode, settings stay with the pty */
+	master_fd = posix_openpt ( O_RDWR | O_NOCTTY );
+	if ( ( master_fd < 0 ) || ( 0 != grantpt ( master_fd ) ) || ( 0 != unlockpt ( master_fd ) ) )
+	{
+		fprintf ( stderr, "[ERROR] pty not available\r\n" );
+		return 1;
+	}
+	slave_name = ptsname ( master_fd );
+	slave_fd = open ( slave_name, O_RDWR | O_NOCTTY );
+	if ( ( slave_fd < 0 ) || ( 0 != tcgetattr ( slave_fd, &tio ) ) )
+	{
+		fprintf ( stderr, "[ERROR] pty slave not available\r\n" );
+		return 1;
+	}
+	cfmakeraw ( &tio );
+	tcsetattr ( slave_fd, TCSANOW, &tio );
+	/* closed again, master sees hang up until host opens the slave */
+	close ( slave_fd );
+	fcntl ( master_fd, F_SETFL, fcntl ( master_fd, F_GETFL ) | O_NONBLOCK );
+
+	if ( NULL != link_path )
+	{
+		unlink ( link_path );
+		if ( 0 != symlink ( slave_name, link_path ) )
+		{
+			fprintf ( stderr, "[ERROR] can't create link %s\r\n", link_path );
+		}
+	}
+	printf ( "%s\n", slave_name );
+	fflush ( stdout );
+
+	start_time = _now ();
+	if ( true == binary )
+	{
+		tc_proto_init ( &tc_init_data, &sim_transport );
+	}
+	else
+	{
+		tc_set_transport ( &sim_transport );
+	}
+	if ( false == wait_run )
+	{
+		tc_init ( &tc_init_data );
+	}
+
+	for ( ;; )
+	{
+		tc_tasks ();
+		if ( true == binary )
+		{
+			tc_proto_tasks ();
+		}
+		_service ();
+
+		if ( false == tc_is_idle () )
+		{
+			/* test list started, by tc_init() or "run" command */
+			wait_run = false;
+		}
+		else if ( ( false == keep ) && ( false == wait_run ) )
+		{
+			break;
+		}
+		else
+		{
+			/* nothing to execute, sleep until host input or next delivery */
+			if ( true == _host_connected () )
+			{
+				poll ( &(struct pollfd){ .fd = master_fd, .events = POLLIN }, 1, SIM_IDLE_POLL );
+			}
+			else
+			{
+				usleep ( SIM_IDLE_POLL * 1000 );
+			}
+		}
+	}
+
+	/* Give host a chance to read remaining output before pty goes away */
+	slave_fd = open ( slave_name, O_RDWR | O_NOCTTY );
+	while ( ( waited < SIM_DRAIN_TIMEOUT ) && ( quiet < SIM_DRAIN_QUIET ) )
+	{
+		_service ();
+		usleep ( 1000 );
+		waited += 1000u;
+		/* written bytes reach the slave input queue asynchronously, so
+		   it has to stay empty for a while */
+		pending = 0;
+		ioctl ( slave_fd, FIONREAD, &pending );
+		quiet = ( ( 0 == up_link.count ) && ( 0 == pending ) ) ? ( quiet + 1000u ) : 0;
+	}
+
+	fprintf ( stderr, "[INFO] device sent %llu bytes, received %llu bytes, %s time %.3f ms\r\n",
+			  (unsigned long long)up_link.total, (unsigned long long)down_link.total,
+			  ( true == virtual_time ) ? "virtual link" : "run",
+			  (double)( ( true == virtual_time ) ? link_time : ( _now () - start_time ) ) / 1000.0 );
+
+	if ( NULL != link_path )
+	{
+		unlink ( link_path );
+	}
+	close ( slave_fd );
+	close ( master_fd );
+
+	return ( 0 == tc_get_fail_count () ) ? 0 : 1;
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function returns current time in us, link time in virtual mode
+*/
+static uint64_t _now ( void )
+{
+	struct timespec ts;
+
+	if ( true == virtual_time )
+	{
+		return link_time;
+	}
+	clock_gettime ( CLOCK_MONOTONIC, &ts );
+
+	return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/* This function queues one byte on a link. Its delivery time is the time
+ * the sender finishes serializing it plus latency. A full link blocks the
+ * sender like a full UART FIFO; only the device side waits here, host input
+ * isn't pushed without room (see _service()).
+*/
+static void _link_push ( sim_link_t *link, uint8_t byte )
+{
+	uint64_t now;
+	uint32_t tail;
+
+	while ( link->count >= SIM_LINK_SIZE )
+	{
+		_service ();
+		if ( link->count >= SIM_LINK_SIZE )
+		{
+			usleep ( 100 );
+		}
+	}
+
+	now = _now ();
+	if ( link->tx_free < now )
+	{
+		link->tx_free = now;
+		link->tx_frac = 0;
+	}
+	if ( 0 != bandwidth )
+	{
+		/* a byte takes 1000000 / bandwidth us, the remainder is carried to
+		   the next byte so rates above 1 MB/s or not dividing it are kept */
+		link->tx_frac += 1000000u;
+		link->tx_free += link->tx_frac / bandwidth;
+		link->tx_frac %= bandwidth;
+	}
+
+	tail = ( link->head + link->count ) % SIM_LINK_SIZE;
+	link->data[tail] = byte;
+	link->due[tail] = link->tx_free + latency;
+	link->count++;
+	link->total++;
+
+	if ( ( true == virtual_time ) && ( link->due[tail] > link_time ) )
+	{
+		link_time = link->due[tail];
+	}
+}
+
+/* This function returns true if the oldest byte on the link is delivered
+*/
+static bool _link_due ( const sim_link_t *link )
+{
+	return ( link->count > 0 ) &&
+		   ( ( true == virtual_time ) || ( link->due[link->head] <= _now () ) );
+}
+
+/* This function returns true if the pty slave is open, master reports hang
+ * up otherwise. Only the final drain keeps the slave open on our side.
+*/
+static bool _host_connected ( void )
+{
+	struct pollfd pfd = { .fd = master_fd, .events = POLLIN };
+
+	return ( poll ( &pfd, 1, 0 ) >= 0 ) && ( 0 == ( pfd.revents & POLLHUP ) );
+}
+
+/* This function moves host input onto down link and delivers due output
+ * to the host. Host input is only read while the down link has room, the
+ * rest stays in the pty, so _link_push() never waits on the down link here.
+*/
+static void _service ( void )
+{
+	uint8_t rx[256];
+	uint32_t room;
+	ssize_t len;
+
+	if ( false == _host_connected () )
+	{
+		/* output is held back until a host opens the link */
+		return;
+	}
+
+	/* a full down link is drained by the controller only, leave backpressure
+	   to the pty */
+	room = SIM_LINK_SIZE - down_link.count;
+	while ( ( room > 0 ) &&
+			( ( len = read ( master_fd, rx, ( room < sizeof(rx) ) ? room : sizeof(rx) ) ) > 0 ) )
+	{
+		for ( ssize_t i = 0; i < len; i++ )
+		{
+			_link_push ( &down_link, rx[i] );
+		}
+		room -= (uint32_t)len;
+	}
+
+	while ( true == _link_due ( &up_link ) )
+	{
+		if ( 1 != write ( master_fd, &up_link.data[up_link.head], 1 ) )
+		{
+			/* host isn't reading, keep byte queued */
+			break;
+		}
+		up_link.head = ( up_link.head + 1u ) % SIM_LINK_SIZE;
+		up_link.count--;
+	}
+}
+
+/* This function is controller transport output, device side of up link
+*/
+static void _dev_write ( const uint8_t *data, uint32_t len )
+{
+	for ( uint32_t i = 0; i < len; i++ )
+	{
+		_link_push ( &up_link, data[i] );
+	}
+	_service ();
+}
+
+/* This function is controller transport input, device side of down link
+*/
+static uint32_t _dev_read ( uint8_t *data, uint32_t len )
+{
+	uint32_t total = 0;
+
+	_service ();
+	while ( ( total < len ) && ( true == _link_due ( &down_link ) ) )
+	{
+		data[total++] = down_link.data[down_link.head];
+		down_link.head = ( down_link.head + 1u ) % SIM_LINK_SIZE;
+		down_link.count--;
+	}
+
+	return total;
+}
+
+/*** end of file ***/
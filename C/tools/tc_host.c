@@ -0,0 +1,616 @@
+/** @file tc_host.c
+ *
+ * @brief This file implements the host side of the binary test control
+ *        protocol (tc_proto). It selects and runs test cases on a target
+ *        without reflashing and prints the results streamed back. Commands
+ *        are pipelined: up to a window of commands is in flight, so selecting
+ *        a long list of cases costs no serial round trip per frame.
+ *
+ *        The target is either a serial device (e.g. the pty of
+ *        "dev_sim -B") or, with -s, the compiled-in test application running
+ *        in a child process over a socketpair.
+ *
+ * @par Build and run
+ *        gcc -O2 -I.. tc_host.c ../tc_proto.c ../test_controller.c ../tc_guard.c \
+ *            ../test_app.c ../test_random.c ../test_param.c \
+ *            ../tc_perf.c ../sut/circular_queue.c -o tc_host
+ *        ./tc_host (-d device | -s) [-l] [-o idx,idx,...] [-w window] [-x max_failures] [-v]
+ *          -d  serial device of the target
+ *          -s  run target in a child process over a socketpair
+ *          -l  list test cases (index and name) and exit
+ *          -o  run only listed test cases, in listed order
+ *          -w  maximum number of commands in flight (default 8)
+ *          -x  abort run after given number of failed test cases
+ *          -v  stream target console output
+ *        Exit code is 0 when all executed test cases passed, 1 on failures,
+ *        2 on usage or link errors.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "test_controller.h"
+#include "tc_proto.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define HOST_MAX_ORDER		65536u
+#define HOST_TIMEOUT		10000 	/* ms without any frame from target */
+#define HOST_SELECT_CHUNK	( ( TC_PROTO_MAX_PAYLOAD - 1u ) / 4u ) 	/* indexes per SELECT */
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+static int link_fd = -1;
+static tc_proto_rx_t host_rx;
+static uint8_t rx_buff[4096];
+static uint32_t rx_len;
+static uint32_t rx_pos;
+static bool rx_more; /* decoder may hold further frames, see tc_proto_rx_more() */
+static uint8_t next_seq;
+static uint32_t in_flight; /* commands without reply */
+static uint32_t window = 8;
+static bool verbose;
+static uint32_t run_order[HOST_MAX_ORDER];
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static int _open_device ( const char *path );
+static pid_t _start_local_target ( void );
+static void _write_all ( const uint8_t *data, uint32_t len );
+static uint8_t _command ( uint8_t type, const void *payload, uint32_t len );
+static bool _next_frame ( tc_proto_frame_t *frame );
+static bool _handle_reply ( const tc_proto_frame_t *frame );
+static uint32_t _get_u32 ( const uint8_t *p );
+static uint32_t _parse_order ( const char *arg );
+static uint32_t _query_total ( void );
+static bool _list_reply ( const tc_proto_frame_t *frame, uint32_t *listed );
+static int _list ( void );
+static int _run ( uint32_t total_order, uint32_t max_failures );
+
+/* target side of socketpair mode */
+static int target_fd = -1;
+static bool target_eof;
+static void _target_write ( const uint8_t *data, uint32_t len );
+static uint32_t _target_read ( uint8_t *data, uint32_t len );
+
+static const tc_transport_t target_transport = {
+	.p_write_fn = _target_write,
+	.p_read_fn = _target_read
+};
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+int main ( int argc, char *argv[] )
+{
+	const char *device = NULL;
+	const char *order_arg = NULL;
+	uint32_t max_failures = 0;
+	uint32_t total_order = 0;
+	bool local = false;
+	bool list_only = false;
+	pid_t target = -1;
+	int stat;
+	int opt;
+
+	while ( ( opt = getopt ( argc, argv, "d:slo:w:x:vh" ) ) != -1 )
+	{
+		switch ( opt )
+		{
+			case 'd':
+				device = optarg;
+				break;
+
+			case 's':
+				local = true;
+				break;
+
+			case 'l':
+				list_only = true;
+				break;
+
+			case 'o':
+				order_arg = optarg;
+				break;
+
+			case 'w':
+				window = (uint32_t)strtoul ( optarg, NULL, 0 );
+				window = ( window > 0 ) ? window : 1u;
+				break;
+
+			case 'x':
+				max_failures = (uint32_t)strtoul ( optarg, NULL, 0 );
+				break;
+
+			case 'v':
+				verbose = true;
+				break;
+
+			default:
+				printf ( "usage: %s (-d device | -s) [-l] [-o idx,idx,...] [-w window] [-x max_failures] [-v]\r\n", argv[0] );
+				return ( 'h' == opt ) ? 0 : 2;
+		}
+	}
+
+	if ( NULL != device )
+	{
+		link_fd = _open_device ( device );
+	}
+	else if ( true == local )
+	{
+		target = _start_local_target ();
+	}
+	if ( link_fd < 0 )
+	{
+		fprintf ( stderr, "[ERROR] no target link, use -d or -s\r\n" );
+		return 2;
+	}
+
+	if ( NULL != order_arg )
+	{
+		total_order = _parse_order ( order_arg );
+	}
+
+	stat = ( true == list_only ) ? _list () : _run ( total_order, max_failures );
+
+	close ( link_fd );
+	if ( target > 0 )
+	{
+		/* target exits on link EOF */
+		waitpid ( target, NULL, 0 );
+	}
+
+	return stat;
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function opens a serial device in raw mode
+*/
+static int _open_device ( const char *path )
+{
+	struct termios tio;
+	int fd = open ( path, O_RDWR | O_NOCTTY );
+
+	if ( ( fd >= 0 ) && ( 0 == tcgetattr ( fd, &tio ) ) )
+	{
+		cfmakeraw ( &tio );
+		tcsetattr ( fd, TCSANOW, &tio );
+	}
+
+	return fd;
+}
+
+/* This function forks the test application as target, connected over a
+ * socketpair, and returns its pid
+*/
+static pid_t _start_local_target ( void )
+{
+	int sv[2];
+	pid_t pid;
+
+	if ( 0 != socketpair ( AF_UNIX, SOCK_STREAM, 0, sv ) )
+	{
+		return -1;
+	}
+
+	pid = fork ();
+	if ( 0 == pid )
+	{
+		close ( sv[0] );
+		target_fd = sv[1];
+		fcntl ( target_fd, F_SETFL, fcntl ( target_fd, F_GETFL ) | O_NONBLOCK );
+
+		tc_proto_init ( &tc_init_data, &target_transport );
+		while ( false == target_eof )
+		{
+			tc_tasks ();
+			tc_proto_tasks ();
+			if ( true == tc_is_idle () )
+			{
+				poll ( &(struct pollfd){ .fd = target_fd, .events = POLLIN }, 1, -1 );
+			}
+		}
+		_exit ( 0 );
+	}
+
+	close ( sv[1] );
+	link_fd = ( pid > 0 ) ? sv[0] : -1;
+
+	return pid;
+}
+
+/* This function writes data to the link, blocking
+*/
+static void _write_all ( const uint8_t *data, uint32_t len )
+{
+	ssize_t n;
+
+	while ( len > 0 )
+	{
+		n = write ( link_fd, data, len );
+		if ( n <= 0 )
+		{
+			if ( ( n < 0 ) && ( EINTR == errno ) )
+			{
+				continue;
+			}
+			fprintf ( stderr, "[ERROR] link write failed\r\n" );
+			exit ( 2 );
+		}
+		data += n;
+		len -= (uint32_t)n;
+	}
+}
+
+/* This function sends a command once there is room in the window, replies
+ * arriving meanwhile are handled
+*/
+static uint8_t _command ( uint8_t type, const void *payload, uint32_t len )
+{
+	uint8_t frame[TC_PROTO_MAX_FRAME];
+	tc_proto_frame_t reply;
+	uint8_t seq = next_seq++;
+
+	while ( in_flight >= window )
+	{
+		if ( false == _next_frame ( &reply ) )
+		{
+			exit ( 2 );
+		}
+		_handle_reply ( &reply );
+	}
+
+	_write_all ( frame, tc_proto_encode ( frame, type, seq, payload, len ) );
+	in_flight++;
+
+	return seq;
+}
+
+/* This function receives next valid frame, false on timeout or link loss
+*/
+static bool _next_frame ( tc_proto_frame_t *frame )
+{
+	struct pollfd pfd = { .fd = link_fd, .events = POLLIN };
+	ssize_t n;
+
+	for ( ;; )
+	{
+		if ( ( true == rx_more ) && ( true == tc_proto_rx_more ( &host_rx ) ) )
+		{
+			*frame = host_rx.frame;
+			return true;
+		}
+		rx_more = false;
+		while ( rx_pos < rx_len )
+		{
+			if ( true == tc_proto_rx_byte ( &host_rx, rx_buff[rx_pos++] ) )
+			{
+				*frame = host_rx.frame;
+				rx_more = true;
+				return true;
+			}
+		}
+
+		if ( poll ( &pfd, 1, HOST_TIMEOUT ) <= 0 )
+		{
+			fprintf ( stderr, "[ERROR] target not responding\r\n" );
+			return false;
+		}
+		n = read ( link_fd, rx_buff, sizeof(rx_buff) );
+		if ( n <= 0 )
+		{
+			fprintf ( stderr, "[ERROR] link closed\r\n" );
+			return false;
+		}
+		rx_len = (uint32_t)n;
+		rx_pos = 0;
+	}
+}
+
+/* This function handles a reply or run event, returns false if a command
+ * was rejected
+*/
+static bool _handle_reply ( const tc_proto_frame_t *frame )
+{
+	switch ( frame->type )
+	{
+		case TC_PROTO_ACK:
+			in_flight--;
+			if ( ( TC_PROTO_ERR_CRC == frame->payload[0] ) || ( TC_PROTO_ERR_LEN == frame->payload[0] ) )
+			{
+				/* NAK, seq isn't the lost command's */
+				fprintf ( stderr, "[ERROR] command lost on link, status %u\r\n",
+						  (unsigned int)frame->payload[0] );
+				return false;
+			}
+			if ( TC_PROTO_OK != frame->payload[0] )
+			{
+				fprintf ( stderr, "[ERROR] command %u rejected, status %u\r\n",
+						  (unsigned int)frame->seq, (unsigned int)frame->payload[0] );
+				return false;
+			}
+			break;
+
+		case TC_PROTO_STATUS:
+		case TC_PROTO_CASE_INFO:
+			in_flight--;
+			break;
+
+		case TC_PROTO_LOG:
+			if ( true == verbose )
+			{
+				fwrite ( frame->payload, 1, frame->len, stdout );
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	return true;
+}
+
+/* This function loads little endian u32
+*/
+static uint32_t _get_u32 ( const uint8_t *p )
+{
+	return (uint32_t)p[0] | ( (uint32_t)p[1] << 8 ) |
+		   ( (uint32_t)p[2] << 16 ) | ( (uint32_t)p[3] << 24 );
+}
+
+/* This function parses comma separated test case indexes into run_order[]
+*/
+static uint32_t _parse_order ( const char *arg )
+{
+	uint32_t total = 0;
+	unsigned long idx;
+	char *end;
+
+	while ( ( '\0' != *arg ) && ( total < HOST_MAX_ORDER ) )
+	{
+		idx = strtoul ( arg, &end, 0 );
+		if ( end == arg )
+		{
+			break;
+		}
+		run_order[total++] = (uint32_t)idx;
+		arg = ( ',' == *end ) ? ( end + 1 ) : end;
+	}
+
+	return total;
+}
+
+/* This function queries number of test cases on target
+*/
+static uint32_t _query_total ( void )
+{
+	tc_proto_frame_t reply;
+	uint8_t seq = _command ( TC_PROTO_QUERY, NULL, 0 );
+
+	do
+	{
+		if ( false == _next_frame ( &reply ) )
+		{
+			exit ( 2 );
+		}
+		_handle_reply ( &reply );
+	} while ( ( TC_PROTO_STATUS != reply.type ) || ( seq != reply.seq ) );
+
+	return _get_u32 ( &reply.payload[13] );
+}
+
+/* This function prints a test case name reply
+*/
+static bool _list_reply ( const tc_proto_frame_t *frame, uint32_t *listed )
+{
+	if ( TC_PROTO_CASE_INFO == frame->type )
+	{
+		printf ( "%u %.*s\r\n", (unsigned int)_get_u32 ( frame->payload ),
+				 (int)( frame->len - 4u ), (const char *)&frame->payload[4] );
+		(*listed)++;
+	}
+
+	return _handle_reply ( frame );
+}
+
+/* This function lists test cases, name queries are pipelined
+*/
+static int _list ( void )
+{
+	tc_proto_frame_t reply;
+	uint32_t total = _query_total ();
+	uint32_t listed = 0;
+	uint8_t idx[4];
+
+	for ( uint32_t i = 0; i < total; i++ )
+	{
+		idx[0] = (uint8_t)i;
+		idx[1] = (uint8_t)( i >> 8 );
+		idx[2] = (uint8_t)( i >> 16 );
+		idx[3] = (uint8_t)( i >> 24 );
+
+		/* replies are printed while further queries are sent */
+		while ( in_flight >= window )
+		{
+			if ( false == _next_frame ( &reply ) )
+			{
+				return 2;
+			}
+			if ( false == _list_reply ( &reply, &listed ) )
+			{
+				return 2;
+			}
+		}
+		_command ( TC_PROTO_CASE, idx, sizeof(idx) );
+	}
+
+	while ( in_flight > 0 )
+	{
+		if ( false == _next_frame ( &reply ) )
+		{
+			return 2;
+		}
+		if ( false == _list_reply ( &reply, &listed ) )
+		{
+			return 2;
+		}
+	}
+
+	return ( listed == total ) ? 0 : 2;
+}
+
+/* This function selects cases, starts the run and prints streamed results
+*/
+static int _run ( uint32_t total_order, uint32_t max_failures )
+{
+	uint8_t payload[TC_PROTO_MAX_PAYLOAD];
+	tc_proto_frame_t reply;
+	uint32_t chunk;
+	uint32_t failed = 0;
+	uint8_t run_seq;
+	uint8_t flags = ( true == verbose ) ? TC_PROTO_RUN_LOG : 0u;
+	bool aborting = false;
+
+	/* selection frames and RUN go out back to back, acks are collected
+	   while the run is already streaming */
+	for ( uint32_t i = 0; i < total_order; i += chunk )
+	{
+		chunk = total_order - i;
+		chunk = ( chunk < HOST_SELECT_CHUNK ) ? chunk : HOST_SELECT_CHUNK;
+		payload[0] = ( i > 0 ) ? TC_PROTO_SELECT_APPEND : 0u;
+		for ( uint32_t k = 0; k < chunk; k++ )
+		{
+			payload[1u + 4u * k] = (uint8_t)run_order[i + k];
+			payload[2u + 4u * k] = (uint8_t)( run_order[i + k] >> 8 );
+			payload[3u + 4u * k] = (uint8_t)( run_order[i + k] >> 16 );
+			payload[4u + 4u * k] = (uint8_t)( run_order[i + k] >> 24 );
+		}
+		_command ( TC_PROTO_SELECT, payload, 1u + 4u * chunk );
+	}
+	run_seq = _command ( TC_PROTO_RUN, &flags, 1u );
+
+	for ( ;; )
+	{
+		if ( false == _next_frame ( &reply ) )
+		{
+			return 2;
+		}
+		if ( false == _handle_reply ( &reply ) )
+		{
+			/* run doesn't start if its selection was rejected */
+			return 2;
+		}
+		if ( run_seq != reply.seq )
+		{
+			continue;
+		}
+
+		if ( TC_PROTO_RESULT == reply.type )
+		{
+			printf ( "[%s] %u %.*s\r\n", ( 0 != reply.payload[4] ) ? "PASS" : "FAIL",
+					 (unsigned int)_get_u32 ( reply.payload ),
+					 (int)( reply.len - 5u ), (const char *)&reply.payload[5] );
+			fflush ( stdout );
+			if ( 0 == reply.payload[4] )
+			{
+				failed++;
+				if ( ( 0 != max_failures ) && ( failed >= max_failures ) && ( false == aborting ) )
+				{
+					aborting = true;
+					_command ( TC_PROTO_ABORT, NULL, 0 );
+				}
+			}
+		}
+		else if ( TC_PROTO_DONE == reply.type )
+		{
+			printf ( "%u cases executed, %u failed%s\r\n", (unsigned int)_get_u32 ( reply.payload ),
+					 (unsigned int)_get_u32 ( &reply.payload[4] ),
+					 ( 0 != reply.payload[8] ) ? ", run aborted" : "" );
+			break;
+		}
+	}
+
+	/* collect outstanding acks (e.g. ABORT sent after run completed) */
+	while ( in_flight > 0 )
+	{
+		if ( false == _next_frame ( &reply ) )
+		{
+			break;
+		}
+		_handle_reply ( &reply );
+	}
+	return ( 0 == failed ) ? 0 : 1;
+}
+
+/* This function is target transport output, socketpair mode
+*/
+static void _target_write ( const uint8_t *data, uint32_t len )
+{
+	struct pollfd pfd = { .fd = target_fd, .events = POLLOUT };
+	ssize_t n;
+
+	while ( len > 0 )
+	{
+		n = write ( target_fd, data, len );
+		if ( n > 0 )
+		{
+			data += n;
+			len -= (uint32_t)n;
+		}
+		else if ( ( n < 0 ) && ( EAGAIN == errno ) )
+		{
+			poll ( &pfd, 1, -1 );
+		}
+		else
+		{
+			target_eof = true;
+			return;
+		}
+	}
+}
+
+/* This function is target transport input, socketpair mode
+*/
+static uint32_t _target_read ( uint8_t *data, uint32_t len )
+{
+	ssize_t n = read ( target_fd, data, len );
+
+	if ( 0 == n )
+	{
+		target_eof = true;
+	}
+
+	return ( n > 0 ) ? (uint32_t)n : 0u;
+}
+
+/*** end of file ***/
@@ -0,0 +1,210 @@
+/** @file tc_monitor.c
+ *
+ * @brief This file implements a live monitor for test runs publishing their
+ *        metrics in shared memory (tc_runner -M). The block is mapped
+ *        read-only and sampled with seqlock snapshots, the run is never
+ *        blocked or signalled. Every sample prints progress, counts,
+ *        throughput (whole run and since previous sample) and the share of
+ *        time spent per controller state.
+ *
+ * @par Build and run
+ *        gcc -O2 -I.. tc_monitor.c ../tc_metrics.c -o tc_monitor
+ *        ./tc_monitor [-i interval_ms] [-n samples] [-w] shm_name
+ *          -i  sampling interval, default 500 ms
+ *          -n  stop after given number of samples, default until the run
+ *              is over (controller idle and writer process gone)
+ *          -w  wait for the metrics block to appear
+ *        Exit code is 0 when the last sample showed no failed case, 1 if
+ *        it did, 2 when no metrics block could be read.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "test_controller.h"
+#include "tc_metrics.h"
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define MON_INTERVAL_MS		500u
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+static const char *state_names[TC_METRICS_STATES] = { "idle", "init", "init_wait", "run", "run_wait", "complete" };
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static void _print ( const tc_metrics_t *m, const tc_metrics_t *prev );
+static bool _writer_alive ( uint32_t pid );
+static void _sleep_ms ( uint32_t ms );
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+int main ( int argc, char *argv[] )
+{
+	const tc_metrics_t *block = NULL;
+	tc_metrics_t snap;
+	tc_metrics_t prev;
+	uint32_t interval_ms = MON_INTERVAL_MS;
+	uint32_t samples = 0;
+	uint32_t taken = 0;
+	bool wait = false;
+	bool have_prev = false;
+	bool have_snap = false;
+	int opt;
+
+	while ( ( opt = getopt ( argc, argv, "i:n:wh" ) ) != -1 )
+	{
+		switch ( opt )
+		{
+			case 'i':
+				interval_ms = (uint32_t)strtoul ( optarg, NULL, 0 );
+				break;
+
+			case 'n':
+				samples = (uint32_t)strtoul ( optarg, NULL, 0 );
+				break;
+
+			case 'w':
+				wait = true;
+				break;
+
+			default:
+				printf ( "usage: %s [-i interval_ms] [-n samples] [-w] shm_name\r\n", argv[0] );
+				return ( 'h' == opt ) ? 0 : 2;
+		}
+	}
+	if ( optind >= argc )
+	{
+		printf ( "usage: %s [-i interval_ms] [-n samples] [-w] shm_name\r\n", argv[0] );
+		return 2;
+	}
+
+	while ( NULL == ( block = tc_metrics_open ( argv[optind] ) ) )
+	{
+		if ( false == wait )
+		{
+			printf ( "[ERROR] no metrics block %s\r\n", argv[optind] );
+			return 2;
+		}
+		_sleep_ms ( interval_ms );
+	}
+
+	for ( ;; )
+	{
+		if ( true == tc_metrics_read ( block, &snap ) )
+		{
+			_print ( &snap, ( true == have_prev ) ? &prev : NULL );
+			fflush ( stdout );
+			prev = snap;
+			have_prev = true;
+			have_snap = true;
+			taken++;
+			if ( ( ( TC_IDLE == snap.state ) && ( false == _writer_alive ( snap.pid ) ) ) ||
+				 ( ( 0 != samples ) && ( taken >= samples ) ) )
+			{
+				break;
+			}
+		}
+		else if ( ( false == wait ) && ( false == _writer_alive ( block->pid ) ) )
+		{
+			/* run ended before it published anything */
+			break;
+		}
+		_sleep_ms ( interval_ms );
+	}
+
+	tc_metrics_close ( block );
+
+	if ( false == have_snap )
+	{
+		printf ( "[ERROR] metrics block %s not valid\r\n", argv[optind] );
+		return 2;
+	}
+
+	return ( 0 == snap.failed ) ? 0 : 1;
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function prints one sample, throughput since previous one if given
+*/
+static void _print ( const tc_metrics_t *m, const tc_metrics_t *prev )
+{
+	uint64_t elapsed = m->update_ns - m->start_ns;
+	uint64_t all_ns = 0;
+	double rate = 0.0;
+	double rate_now = 0.0;
+
+	if ( 0 != elapsed )
+	{
+		rate = (double)m->completed * 1e9 / (double)elapsed;
+	}
+	if ( ( NULL != prev ) && ( m->update_ns > prev->update_ns ) && ( m->start_ns == prev->start_ns ) )
+	{
+		rate_now = (double)( m->completed - prev->completed ) * 1e9 / (double)( m->update_ns - prev->update_ns );
+	}
+
+	printf ( "[%.3f s] %s %u/%u case %u (%s) | pass %u fail %u skip %u flaky %u | %.1f cases/s (%.1f now) |",
+			 (double)elapsed / 1e9, ( m->state < TC_METRICS_STATES ) ? state_names[m->state] : "?",
+			 (unsigned int)m->completed, (unsigned int)m->total, (unsigned int)m->case_index,
+			 m->case_name, (unsigned int)m->passed, (unsigned int)m->failed, (unsigned int)m->skipped,
+			 (unsigned int)m->flaky, rate, rate_now );
+
+	for ( uint32_t i = 0; i < TC_METRICS_STATES; i++ )
+	{
+		all_ns += m->state_ns[i];
+	}
+	for ( uint32_t i = 1; i < TC_METRICS_STATES; i++ )
+	{
+		if ( 0 != m->state_ns[i] )
+		{
+			printf ( " %s %.1f%%", state_names[i], (double)m->state_ns[i] * 100.0 / (double)all_ns );
+		}
+	}
+	printf ( "\r\n" );
+}
+
+/* This function checks whether the process publishing metrics still runs
+*/
+static bool _writer_alive ( uint32_t pid )
+{
+	return ( 0 != pid ) && ( ( 0 == kill ( (pid_t)pid, 0 ) ) || ( EPERM == errno ) );
+}
+
+/* This function sleeps given milliseconds
+*/
+static void _sleep_ms ( uint32_t ms )
+{
+	struct timespec ts;
+
+	ts.tv_sec = (time_t)( ms / 1000u );
+	ts.tv_nsec = (long)( ms % 1000u ) * 1000000L;
+	nanosleep ( &ts, NULL );
+}
+
+/*** end of file ***/
@@ -0,0 +1,572 @@
+/** @file tc_runner.c
+ *
+ * @brief This file implements host side test runner. It executes the compiled
+ *        in test case list (tc_init_data) with test controller, optionally in
+ *        a given order / subset, and exits once all selected cases completed
+ *        so that it can be driven by scripts. Generated (parametrized) test
+ *        cases are indexed after the static list.
+ *
+ * @par Build and run
+ *        gcc -O2 -I.. tc_runner.c ../test_controller.c ../tc_guard.c ../tc_history.c \
+ *            ../test_app.c ../test_random.c ../test_param.c ../tc_perf.c \
+ *            ../tc_metrics.c ../tc_timeline.c ../sut/circular_queue.c -o tc_runner
+ *        ./tc_runner [-l] [-o idx,idx,...] [-x max_failures] [-t trace_file] [-f]
+ *                    [-r reruns] [-H history_file] [-p] [-T seconds]
+ *                    [-P baseline_file [-U]] [-M shm_name] [-j timeline_file]
+ *                    [-J jobs] [-V data_dir]
+ *          -l  list test cases (index and name) and exit
+ *          -o  run only listed test cases, in listed order
+ *          -x  stop after given number of failed test cases
+ *          -t  record SUT calls into trace file, needs -DCQ_TRACE build
+ *              with ../cq_trace.c added (replay with cq_replay)
+ *          -f  fork-server mode, every case runs in its own copy-on-write
+ *              child process, needs -DTC_FORK_SERVER build
+ *          -r  rerun each failed case given number of times in parallel
+ *              workers, needs -DTC_FORK_SERVER build. A case passing any
+ *              rerun is FLAKY and doesn't fail the run.
+ *          -H  keep per case statistics in given file across runs
+ *              (default tc_history.txt when -r, -p or -T is given)
+ *          -p  fail-fast order: run (selected) cases likely to fail in
+ *              little time first, from history statistics; all selected
+ *              cases still run unless -x stops the run
+ *          -T  time budget: run the subset of (selected) cases covering
+ *              most distinct SUT functions (recorded by -DCQ_TRACE builds
+ *              with ../cq_trace.c) and run functions within the budget,
+ *              by history durations; the rest is reported as SKIP
+ *          -P  compare performance test cases against baselines in file
+ *          -U  store measured performance as new baselines in -P file,
+ *              not with -f or -J (cases measured in forked children)
+ *          -M  publish live progress and metrics in POSIX shared memory
+ *              object of given name (watch with tc_monitor)
+ *          -j  record controller states, case phases and log messages of
+ *              all processes and write them as Chrome trace event JSON
+ *              (chrome://tracing, Perfetto UI)
+ *          -J  schedule by declared dependencies (test_case_t.p_deps): a
+ *              case runs once its prerequisites passed and is skipped when
+ *              one failed; up to given number of ready cases run at once
+ *              in forked children (more than 1 needs -DTC_FORK_SERVER
+ *              build, can't be combined with -r)
+ *          -V  directory of test data (parametrized suite vector files),
+ *              default TC_DATA_DIR environment variable, else current
+ *              directory. The run fails if vectors aren't found, so case
+ *              indexes don't depend on where tc_runner is started.
+ *        Exit code is 0 when all executed test cases passed or are FLAKY,
+ *        else 1. Every failed case is reported as "[FAIL] <index> <name>",
+ *        a flaky one as "[FLAKY] <index> <name>" with its failure
+ *        probability over all recorded executions. A skipped case is only
+ *        logged by the controller ("Skipped test case: <index> (<name>),
+ *        <reason>" followed by "Test Result: SKIP").
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 company_xyz ltd. All rights reserved.
+ */
+
+/******************************************************************************
+ * 							Include files
+******************************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "test_controller.h"
+#include "tc_history.h"
+#include "test_param.h"
+#include "tc_perf.h"
+#include "tc_metrics.h"
+#include "tc_timeline.h"
+#ifdef CQ_TRACE
+#include "sut/circular_queue.h"
+#include "cq_trace.h"
+#endif
+
+/******************************************************************************
+ * 					Common typedef / macro definitions
+******************************************************************************/
+
+#define RUN_MAX_ORDER	65536u
+#define RUN_TRACE_SIZE	( 256u * 1024u * 1024u ) 	/* trace buffer, bytes */
+#define RUN_TIMELINE_EVENTS	( 1u << 20 ) 	/* timeline ring, events */
+
+/******************************************************************************
+ * 						Private variable declarations
+******************************************************************************/
+
+static uint32_t run_order[RUN_MAX_ORDER]; /* selected test case indexes in run order */
+static uint32_t total_cases; /* static and generated test cases */
+static bool keep_history;
+static bool rerun_mode;
+static struct timespec last_result; /* end of previous case */
+static uint32_t total_results; /* cases with final result */
+static uint8_t *case_state; /* dependency scheduler states, NULL without -J */
+static bool concurrent; /* durations overlap, not recorded */
+
+/******************************************************************************
+ * 						Private function declarations
+******************************************************************************/
+
+static uint32_t _parse_order ( const char *arg );
+static const char *_case_name ( uint32_t idx );
+static void _on_result ( uint32_t index, const char *name, bool pass );
+static uint32_t _elapsed_us ( void );
+static uint32_t _estimate_us ( uint32_t idx );
+#ifdef TC_FORK_SERVER
+static void _on_rerun ( uint32_t index, const char *name, tc_verdict_t verdict,
+						uint32_t reruns, uint32_t passed );
+#endif
+
+/******************************************************************************
+ * 						Public function definitions
+******************************************************************************/
+
+int main ( int argc, char *argv[] )
+{
+	tc_init_t run_data = tc_init_data;
+	const char *order_arg = NULL;
+	uint32_t max_failures = 0;
+	uint32_t failed = 0;
+	uint32_t executed;
+	bool list_only = false;
+	const char *trace_file = NULL;
+	bool fork_mode = false;
+	uint32_t reruns = 0;
+	const char *history_file = NULL;
+	bool prioritize = false;
+	double budget_s = 0.0;
+	uint64_t budget_us = 0;
+	uint32_t selected;
+	uint32_t candidates;
+	struct timespec t0;
+	struct timespec now;
+	char reason[64];
+	const char *baseline_file = NULL;
+	bool update_baseline = false;
+	const char *metrics_name = NULL;
+	tc_metrics_t *metrics = NULL;
+	const char *timeline_file = NULL;
+	tc_timeline_t *timeline = NULL;
+	uint32_t jobs = 0;
+	const char *data_dir = getenv ( "TC_DATA_DIR" );
+	int opt;
+
+	while ( ( opt = getopt ( argc, argv, "lo:x:t:fr:H:pT:P:UM:j:J:V:h" ) ) != -1 )
+	{
+		switch ( opt )
+		{
+			case 'l':
+				list_only = true;
+				break;
+
+			case 'o':
+				order_arg = optarg;
+				break;
+
+			case 'x':
+				max_failures = (uint32_t)strtoul ( optarg, NULL, 0 );
+				break;
+
+			case 't':
+				trace_file = optarg;
+				break;
+
+			case 'f':
+				fork_mode = true;
+				break;
+
+			case 'r':
+				reruns = (uint32_t)strtoul ( optarg, NULL, 0 );
+				break;
+
+			case 'H':
+				history_file = optarg;
+				break;
+
+			case 'p':
+				prioritize = true;
+				break;
+
+			case 'T':
+				budget_s = strtod ( optarg, NULL );
+				budget_us = ( budget_s > 0.0 ) ? (uint64_t)( budget_s * 1e6 ) : 0u;
+				break;
+
+			case 'P':
+				baseline_file = optarg;
+				break;
+
+			case 'U':
+				update_baseline = true;
+				break;
+
+			case 'M':
+				metrics_name = optarg;
+				break;
+
+			case 'j':
+				timeline_file = optarg;
+				break;
+
+			case 'J':
+				jobs = (uint32_t)strtoul ( optarg, NULL, 0 );
+				jobs = ( 0u == jobs ) ? 1u : jobs;
+				break;
+
+			case 'V':
+				data_dir = optarg;
+				break;
+
+			default:
+				printf ( "usage: %s [-l] [-o idx,idx,...] [-x max_failures] [-t trace_file] [-f] "
+						 "[-r reruns] [-H history_file] [-p] [-T seconds] [-P baseline_file [-U]] "
+						 "[-M shm_name] [-j timeline_file] [-J jobs] [-V data_dir]\r\n", argv[0] );
+				return ( 'h' == opt ) ? 0 : 2;
+		}
+	}
+
+	tp_set_vectors_dir ( data_dir );
+	total_cases = tc_get_total ( &tc_init_data );
+	if ( tp_get_map_errors () > 0 )
+	{
+		printf ( "[ERROR] test data not found in %s, run from C/ or give -V data_dir\r\n",
+				 ( NULL != data_dir ) ? data_dir : "current directory" );
+		return 2;
+	}
+
+	if ( true == list_only )
+	{
+		for ( uint32_t i = 0; i < total_cases; i++ )
+		{
+			printf ( "%u %s\r\n", (unsigned int)i, _case_name ( i ) );
+		}
+		return 0;
+	}
+
+	/* run selected cases only, default is whole list in array order */
+	if ( NULL != order_arg )
+	{
+		run_data.p_order = run_order;
+		run_data.total_order = _parse_order ( order_arg );
+	}
+	else if ( ( true == prioritize ) || ( 0 != budget_us ) )
+	{
+		run_data.total_order = ( total_cases < RUN_MAX_ORDER ) ? total_cases : RUN_MAX_ORDER;
+		for ( uint32_t i = 0; i < run_data.total_order; i++ )
+		{
+			run_order[i] = i;
+		}
+		run_data.p_order = run_order;
+	}
+
+#ifdef CQ_TRACE
+	if ( NULL != trace_file )
+	{
+		cq_trace_start ( malloc ( RUN_TRACE_SIZE ), RUN_TRACE_SIZE );
+	}
+#else
+	if ( NULL != trace_file )
+	{
+		printf ( "[ERROR] SUT tracing not built in, rebuild with -DCQ_TRACE\r\n" );
+		return 2;
+	}
+#endif
+
+#ifdef TC_FORK_SERVER
+	if ( ( jobs > 1u ) && ( reruns > 0 ) )
+	{
+		printf ( "[ERROR] concurrent cases (-J) aren't rerun, -r can't be combined with it\r\n" );
+		return 2;
+	}
+	if ( ( true == update_baseline ) && ( ( true == fork_mode ) || ( jobs > 1u ) ) )
+	{
+		/* measurements stay in the forked children */
+		printf ( "[ERROR] -U needs cases run in process, can't be combined with -f or -J\r\n" );
+		return 2;
+	}
+	tc_set_fork_mode ( fork_mode );
+	tc_set_rerun ( reruns, _on_rerun );
+	tc_set_jobs ( jobs );
+#else
+	if ( ( true == fork_mode ) || ( reruns > 0 ) || ( jobs > 1u ) )
+	{
+		printf ( "[ERROR] fork-server mode not built in, rebuild with -DTC_FORK_SERVER\r\n" );
+		return 2;
+	}
+#endif
+	concurrent = ( jobs > 1u );
+
+	if ( 0u != jobs )
+	{
+		case_state = calloc ( total_cases, 1 );
+		if ( NULL == case_state )
+		{
+			printf ( "[ERROR] can't allocate dependency scheduler states\r\n" );
+			return 2;
+		}
+		run_data.p_case_state = case_state;
+	}
+
+	if ( ( NULL == history_file ) && ( ( reruns > 0 ) || ( true == prioritize ) || ( 0 != budget_us ) ) )
+	{
+		history_file = "tc_history.txt";
+	}
+	if ( NULL != history_file )
+	{
+		keep_history = true;
+		rerun_mode = ( reruns > 0 );
+		tc_history_load ( history_file );
+		tc_set_result_listener ( _on_result );
+	}
+	if ( ( true == prioritize ) &&
+		 ( false == tc_history_sort ( &tc_init_data, run_order, run_data.total_order ) ) )
+	{
+		printf ( "[ERROR] can't prioritize, running cases in given order\r\n" );
+	}
+	if ( ( NULL != baseline_file ) && ( false == tc_perf_load ( baseline_file ) ) )
+	{
+		printf ( "[INFO] no baselines in %s, performance cases only report metrics\r\n", baseline_file );
+	}
+
+	if ( NULL != metrics_name )
+	{
+		metrics = tc_metrics_create ( metrics_name );
+		if ( NULL == metrics )
+		{
+			printf ( "[ERROR] can't create shared memory metrics %s\r\n", metrics_name );
+			return 2;
+		}
+		tc_set_metrics ( metrics, tc_metrics_clock );
+	}
+
+	if ( NULL != timeline_file )
+	{
+		timeline = tc_timeline_create ( RUN_TIMELINE_EVENTS );
+		if ( NULL == timeline )
+		{
+			printf ( "[ERROR] can't allocate timeline\r\n" );
+			return 2;
+		}
+		tc_set_timeline ( timeline, tc_metrics_clock );
+	}
+
+	/* cases past the selected ones are skipped after the run */
+	selected = run_data.total_order;
+	candidates = run_data.total_order;
+	if ( 0 != budget_us )
+	{
+		selected = tc_history_budget ( &tc_init_data, run_order, run_data.total_order, budget_us );
+		run_data.total_order = selected;
+	}
+
+#ifdef CQ_TRACE
+	cq_trace_calls ();
+#endif
+	clock_gettime ( CLOCK_MONOTONIC, &last_result );
+	t0 = last_result;
+	tc_init ( &run_data );
+
+	while ( false == tc_is_idle () )
+	{
+		tc_tasks ();
+
+		if ( tc_get_fail_count () > failed )
+		{
+			failed = tc_get_fail_count ();
+			executed = tc_get_test_index ();
+			printf ( "[FAIL] %u %s\r\n", (unsigned int)executed, _case_name ( executed ) );
+			fflush ( stdout );
+
+			if ( ( 0 != max_failures ) && ( failed >= max_failures ) )
+			{
+				break;
+			}
+		}
+
+		/* estimates were off, stop at the budget */
+		clock_gettime ( CLOCK_MONOTONIC, &now );
+		if ( ( 0 != budget_us ) && ( false == tc_is_idle () ) &&
+			 ( (uint64_t)( now.tv_sec - t0.tv_sec ) * 1000000u +
+			   (uint64_t)( ( now.tv_nsec - t0.tv_nsec ) / 1000 ) >= budget_us ) )
+		{
+			tc_abort ();
+			for ( uint32_t i = ( NULL == case_state ) ? total_results : 0u; i < selected; i++ )
+			{
+				/* dependency scheduling runs cases out of order */
+				if ( ( NULL == case_state ) || ( TC_CASE_PENDING == case_state[run_order[i]] ) ||
+					 ( TC_CASE_RUNNING == case_state[run_order[i]] ) )
+				{
+					tc_log_skip ( run_order[i], "time budget exhausted" );
+				}
+			}
+		}
+	}
+
+	for ( uint32_t i = selected; i < candidates; i++ )
+	{
+		snprintf ( reason, sizeof(reason), "not selected for time budget, estimated %u us",
+				   (unsigned int)_estimate_us ( run_order[i] ) );
+		tc_log_skip ( run_order[i], reason );
+	}
+
+	if ( ( NULL != baseline_file ) && ( true == update_baseline ) &&
+		 ( false == tc_perf_save ( baseline_file ) ) )
+	{
+		printf ( "[ERROR] can't write baseline file %s\r\n", baseline_file );
+	}
+
+	if ( ( NULL != history_file ) && ( false == tc_history_save ( history_file ) ) )
+	{
+		printf ( "[ERROR] can't write history file %s\r\n", history_file );
+	}
+
+	if ( NULL != timeline )
+	{
+		tc_set_timeline ( NULL, NULL );
+		if ( false == tc_timeline_save ( timeline, &tc_init_data, timeline_file ) )
+		{
+			printf ( "[ERROR] can't write timeline file %s\r\n", timeline_file );
+		}
+		tc_timeline_free ( timeline );
+	}
+
+	if ( NULL != metrics )
+	{
+		tc_set_metrics ( NULL, NULL );
+		tc_metrics_close ( metrics );
+	}
+
+#ifdef CQ_TRACE
+	if ( ( NULL != trace_file ) && ( false == cq_trace_save ( trace_file ) ) )
+	{
+		printf ( "[ERROR] can't write trace file %s\r\n", trace_file );
+	}
+#endif
+
+	return ( 0 == failed ) ? 0 : 1;
+}
+
+/******************************************************************************
+ * 						Private function definitions
+******************************************************************************/
+
+/* This function parses comma separated test case indexes into run_order[],
+ * out of range indexes are ignored
+*/
+static uint32_t _parse_order ( const char *arg )
+{
+	uint32_t total = 0;
+	unsigned long idx;
+	char *end;
+
+	while ( ( '\0' != *arg ) && ( total < RUN_MAX_ORDER ) )
+	{
+		idx = strtoul ( arg, &end, 0 );
+		if ( end == arg )
+		{
+			break;
+		}
+		if ( idx < total_cases )
+		{
+			run_order[total++] = (uint32_t)idx;
+		}
+		arg = ( ',' == *end ) ? ( end + 1 ) : end;
+	}
+
+	return total;
+}
+
+/* This function returns test case name, or "-" if it has none. A generated
+ * name stays valid until the next case of the generator is obtained.
+*/
+static const char *_case_name ( uint32_t idx )
+{
+	test_case_t tc;
+
+	if ( ( false == tc_get_test_case ( &tc_init_data, idx, &tc ) ) || ( NULL == tc.name ) )
+	{
+		return "-";
+	}
+
+	return tc.name;
+}
+
+/* This function records first execution of every case and its duration. A
+ * failure which is rerun gets its reruns added by _on_rerun(), its duration
+ * isn't taken as it includes the reruns, neither are durations of
+ * concurrent cases.
+*/
+static void _on_result ( uint32_t index, const char *name, bool pass )
+{
+	const char *key = tc_history_key ( index, name );
+	uint32_t time_us = _elapsed_us ();
+
+	total_results++;
+	if ( true == keep_history )
+	{
+		tc_history_update ( key, 1u, ( true == pass ) ? 0u : 1u, false );
+		if ( ( false == concurrent ) && ( ( true == pass ) || ( false == rerun_mode ) ) )
+		{
+			tc_history_time ( key, time_us );
+		}
+#ifdef CQ_TRACE
+		tc_history_funcs ( key, cq_trace_calls () );
+#endif
+	}
+}
+
+/* This function returns microseconds since previous case result
+*/
+static uint32_t _elapsed_us ( void )
+{
+	struct timespec now;
+	int64_t us;
+
+	clock_gettime ( CLOCK_MONOTONIC, &now );
+	us = (int64_t)( now.tv_sec - last_result.tv_sec ) * 1000000 +
+		 ( now.tv_nsec - last_result.tv_nsec ) / 1000;
+	last_result = now;
+
+	return ( us > 0 ) ? (uint32_t)us : 0u;
+}
+
+/* This function returns estimated duration of a test case from history
+*/
+static uint32_t _estimate_us ( uint32_t idx )
+{
+	test_case_t tc;
+	const tc_history_t *hist = NULL;
+
+	if ( true == tc_get_test_case ( &tc_init_data, idx, &tc ) )
+	{
+		hist = tc_history_find ( tc_history_key ( idx, tc.name ), false );
+	}
+
+	return tc_history_cost ( hist );
+}
+
+#ifdef TC_FORK_SERVER
+/* This function records reruns of a failed case and reports a flaky one
+*/
+static void _on_rerun ( uint32_t index, const char *name, tc_verdict_t verdict,
+						uint32_t reruns, uint32_t passed )
+{
+	const char *key = tc_history_key ( index, name );
+	tc_history_t *hist;
+
+	tc_history_update ( key, reruns, reruns - passed, ( TC_VERDICT_FLAKY == verdict ) );
+	if ( TC_VERDICT_FLAKY == verdict )
+	{
+		hist = tc_history_find ( key, false );
+		printf ( "[FLAKY] %u %s, fail probability %u%% (%u of %u runs)\r\n", (unsigned int)index,
+				 ( NULL != name ) ? name : "-", (unsigned int)tc_history_fail_pct ( hist ),
+				 ( NULL != hist ) ? (unsigned int)hist->fails : 0u,
+				 ( NULL != hist ) ? (unsigned int)hist->runs : 0u );
+		fflush ( stdout );
+	}
+}
+#endif
+
+/*** end of file ***/
@@ -5,6 +5,18 @@ TEST_RES_PASS = 0       # Test result = PASS
 TEST_RES_FAIL = 1       # Test result = FAIL
 TEST_RES_SKIP = 2       # Test result = SKIP
 
+MUTATION_HISTORY_FILE = "mutation_history.json"  # per test case kill counts of mutation runs
+
+RESULTS_CACHE_FILE = "results_cache.json"  # parsed log file results, log_parser.py -c
+
+REPORT_TEXT_FILE = "test_report.txt"    # detailed report
+REPORT_JUNIT_FILE = "test_report.xml"   # JUnit XML report, log_parser.py -f junit
+REPORT_JSONL_FILE = "test_report.jsonl" # JSON Lines report, log_parser.py -f jsonl
+
+RESULTS_DB_FILE = "results_history.db"  # results of every run, log_parser.py -d, results_db.py
+
+XMLSCAN_LIB = "../C/libtc_xmlscan.so"   # native log scanner relative to Python/, TC_XMLSCAN_LIB overrides
+
 TEST_MODE = True        # Set True to enable Test mode, this allows filtering message with "TEST" Tag
 
 # End of file 
@@ -0,0 +1,239 @@
+#!/usr/bin/env 
+# -*- coding: utf-8 -*-
+
+import os
+import re
+import stat
+import time
+import errno
+import select
+
+import config
+from report_writers import REPORT_WRITERS, REPORT_FILES
+
+"""
+Follow mode of log_parser.py. Reads the C test controller's console output
+(C/test_log.txt format) while it is being written, from a file, pipe, pty
+or serial device, and turns it into test case results of one test suite:
+
+    Executing test number: N of M, case I (name)
+                                        starts test case I at position N
+    [ERROR] message                     comment of the running test case
+    Test Result: PASS | FAIL            its result
+    Rerun Result: FLAKY, ...            added to its comment
+    Test N completed                    ends it
+    Skipped test case: I (name), why    a skipped test case, its reason
+    Test Result: SKIP                     as comment
+
+Test cases are identified by name, which stays the same whatever order,
+subset or concurrency they run in; index I and position N are kept as extra
+result data. Consoles printing no case name identify executed test cases by
+position. Counts are printed as test cases
+complete and reports are rewritten periodically, so a run that crashes or
+hangs still leaves the results of its completed test cases behind.
+"""
+
+READ_SIZE = 1 << 16         # bytes read at once
+POLL_INTERVAL = 0.2         # seconds between checks of an idle source
+
+_RE_EXECUTING = re.compile(r"Executing test number: (\d+) of (\d+)(?:, case (\d+) \((.*)\))?")
+_RE_RESULT = re.compile(r"Test Result: (\w+)")
+_RE_COMPLETED = re.compile(r"Test (\d+) completed")
+_RE_SKIPPED = re.compile(r"Skipped test case: (\d+) \((.*?)\), (.*)")
+
+
+class ConsoleResults:
+
+    def __init__ ( self, name, suite_id = None ):
+        """
+        Class constructor.
+        @param name Name of the followed source, file name of the suite.
+        @param suite_id Test suite id, defaults to the source name.
+        """
+        self.ts_res_log = { "file": name, "test_suite_id": suite_id if suite_id is not None else name,
+                            "tc_results": list() }
+        self.counts = [ 0, 0, 0 ]
+        self.total = 0              # test cases of the run, 0 until known
+        self._case = None           # test case being executed
+        self._skip = None           # skipped test case waiting for its result
+
+    def feed ( self, line ):
+        """
+        Processes one console line.
+        @param line Console line without line end.
+        @return Test case result completed by this line, None otherwise.
+        """
+        match = _RE_EXECUTING.match(line)
+        if match:
+            done = self._end_case("console output ended before test case completed")
+            self._case = { "test_id": match.group(1), "test_result": None, "comment": list(),
+                           "position": int(match.group(1)) }
+            if match.group(3) is not None:
+                self._case["test_id"] = match.group(4)
+                self._case["index"] = int(match.group(3))
+            self.total = int(match.group(2))
+            return done
+
+        match = _RE_RESULT.match(line)
+        if match:
+            if self._skip is not None and match.group(1) == "SKIP":
+                done = self._skip
+                self._skip = None
+                return self._add(done)
+            if self._case is not None:
+                self._case["test_result"] = match.group(1)
+            return None
+
+        match = _RE_COMPLETED.match(line)
+        if match:
+            return self._end_case("no result logged")
+
+        match = _RE_SKIPPED.match(line)
+        if match:
+            self._skip = { "test_id": match.group(2), "test_result": "SKIP", "comment": match.group(3),
+                           "index": int(match.group(1)) }
+            return None
+
+        if self._case is not None and ( line.startswith("[ERROR] ") or line.startswith("Rerun Result: ") ):
+            self._case["comment"].append(line[8:] if line.startswith("[ERROR] ") else line)
+        return None
+
+    def finish ( self ):
+        """
+        Ends the run at end of console output, a test case still running is
+        reported as failed.
+        @return Test case result completed, None if no test case was running.
+        """
+        return self._end_case("console output ended before test case completed")
+
+    def _end_case ( self, reason ):
+        """
+        Completes the running test case.
+        @param reason Comment if no result was logged, the case counts as failed.
+        @return Test case result, None if no test case was running.
+        """
+        if self._case is None:
+            return None
+        tc_res = self._case
+        self._case = None
+        if tc_res["test_result"] is None:
+            tc_res["test_result"] = "FAIL"
+            tc_res["comment"].append(reason)
+        tc_res["comment"] = "\n".join(tc_res["comment"])
+        return self._add(tc_res)
+
+    def _add ( self, tc_res ):
+        """
+        Adds a test case result to the suite and counts it.
+        @param tc_res Test case result.
+        """
+        self.ts_res_log["tc_results"].append(tc_res)
+        if tc_res["test_result"] == "PASS":
+            self.counts[config.TEST_RES_PASS] = self.counts[config.TEST_RES_PASS] + 1
+        elif tc_res["test_result"] == "FAIL":
+            self.counts[config.TEST_RES_FAIL] = self.counts[config.TEST_RES_FAIL] + 1
+        elif tc_res["test_result"] == "SKIP":
+            self.counts[config.TEST_RES_SKIP] = self.counts[config.TEST_RES_SKIP] + 1
+        return tc_res
+
+
+def read_lines ( source, idle_timeout ):
+    """
+    Yields console lines of a source as they are written. A regular file is
+    read from its start and followed until nothing was appended for
+    idle_timeout seconds, pipes and terminals until they are closed.
+    None is yielded whenever no input arrived for POLL_INTERVAL, so the
+    caller gets to flush reports during quiet periods.
+    @param source File, pipe, pty or serial device path, "-" for stdin.
+    @param idle_timeout Seconds to wait for a regular file to grow, 0 = forever.
+    """
+    fd = 0 if source == "-" else os.open(source, os.O_RDONLY | os.O_NOCTTY)
+    regular = stat.S_ISREG(os.fstat(fd).st_mode)
+    pending = b""
+    idle = 0.0
+    try:
+        while True:
+            if not regular and not select.select([ fd ], [], [], POLL_INTERVAL)[0]:
+                yield None
+                continue
+            try:
+                data = os.read(fd, READ_SIZE)
+            except OSError as e:
+                # pty whose other side was closed
+                if e.errno != errno.EIO:
+                    raise
+                data = b""
+
+            if len(data) == 0:
+                if not regular or ( idle_timeout > 0 and idle >= idle_timeout ):
+                    break
+                time.sleep(POLL_INTERVAL)
+                idle = idle + POLL_INTERVAL
+                yield None
+                continue
+
+            idle = 0.0
+            lines = ( pending + data ).split(b"\n")
+            pending = lines.pop()
+            for line in lines:
+                yield line.rstrip(b"\r").decode("utf-8", errors = "replace")
+
+        if len(pending) > 0:
+            yield pending.rstrip(b"\r").decode("utf-8", errors = "replace")
+    finally:
+        if fd != 0:
+            os.close(fd)
+
+def write_partial_reports ( results, formats ):
+    """
+    Rewrites reports with the results so far. Every report is written aside
+    and then renamed, so readers never see a half written one.
+    @param results ConsoleResults of the run.
+    @param formats Report formats (report_writers.REPORT_WRITERS names).
+    """
+    for fmt in formats:
+        path = REPORT_FILES[fmt]
+        writer = REPORT_WRITERS[fmt](path + ".tmp")
+        writer.write_suite(results.ts_res_log)
+        writer.close(*results.counts)
+        os.replace(path + ".tmp", path)
+
+def follow ( source, formats, flush_interval, idle_timeout, suite_id = None, on_case = None ):
+    """
+    Follows controller console output and keeps reports up to date.
+    @param source Console output source, see read_lines().
+    @param formats Report formats rewritten every flush_interval seconds
+                   while results change and once at the end.
+    @param flush_interval Seconds between report rewrites.
+    @param idle_timeout See read_lines().
+    @param suite_id Test suite id, defaults to the source name.
+    @param on_case Called with ConsoleResults and each test case result as
+                   it completes, e.g. to print live counts.
+    @return ConsoleResults of the run.
+    """
+    results = ConsoleResults(os.path.basename(source) if source != "-" else "stdin", suite_id)
+    flushed = time.monotonic()
+    changed = False
+    try:
+        for line in read_lines(source, idle_timeout):
+            if line is not None:
+                tc_res = results.feed(line)
+                if tc_res is not None:
+                    changed = True
+                    if on_case is not None:
+                        on_case(results, tc_res)
+
+            if changed and time.monotonic() - flushed >= flush_interval:
+                write_partial_reports(results, formats)
+                flushed = time.monotonic()
+                changed = False
+    except KeyboardInterrupt:
+        pass
+
+    tc_res = results.finish()
+    if tc_res is not None and on_case is not None:
+        on_case(results, tc_res)
+    write_partial_reports(results, formats)
+    return results
+
+# End of file
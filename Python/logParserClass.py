@@ -2,12 +2,23 @@
 # -*- coding: utf-8 -*-
 
 import os
+import gc
+import json
+import hashlib
 from abc import ABC, abstractmethod
+from collections import deque
+from concurrent.futures import ProcessPoolExecutor
 
 import xml.etree.ElementTree as ET
 
 import config
+import xml_scan
 from console_log import LOG
+from report_writers import TextReportWriter, REPORT_FILES
+
+CACHE_VERSION = 2           # results cache layout, older caches are dropped
+ITERPARSE_MIN_SIZE = 1 << 20    # log files from this size on are parsed incrementally
+TASKS_PER_JOB = 4           # files handed to a worker process ahead of the consumer
 
 
 class AbstractLogsParser ( ABC ):
@@ -54,6 +65,7 @@ class logParser ( AbstractLogsParser ):
         self.passed = 0
         self.failed = 0
         self.skipped = 0
+        self.cache_hits = 0     # log files taken from results cache
         
     def get_result_by_type( self, result_type ):
         """
@@ -78,129 +90,335 @@ class logParser ( AbstractLogsParser ):
         test suites. It obtains the info and prints them to "test_report.txt" to prepare
         a detailed report.
         """
-        with open("test_report.txt",'w', encoding = 'utf-8') as f:
-            
-            # Create report heading
-            f.write("----------------------------------------------------\r")
-            f.write("                   Test Report\r")
-            f.write("----------------------------------------------------\r\n")
-            
-            # Add report summary
-            f.write("--------------------  Summary ----------------------\r")
-            f.write("Total tests: "+str(self.passed+self.failed+self.skipped)+"\r")
-            f.write("Passed: "+str(self.passed)+"\r")
-            f.write("Failed: "+str(self.failed)+"\r")
-            f.write("Skipped: "+str(self.skipped)+"\r")
-            f.write("----------------------------------------------------\r\n")
-            
-            # Add detailed report for eac test suite
-            for d in self.test_res_log:
-                f.write("Below test details created using: ")
-                f.write(d["file"])
-                f.write("\r\n")
-                
-                # Skip detailed reporting in case there was an error and just print 
-                # an error message obtained while processing log files
-                if "error_log" in d.keys():
-                    f.write(d["error_log"])
-                    f.write("----------------------------------------------------\r")
-                else: 
-                    # Prepare a detailed report for test suite
-                    test_suite_id = d["test_suite_id"]
-                    f.write("Test Suite ID: "+str(test_suite_id)+"\r\n")
-                    f.write("----------------------------------------------------\r")
-                    f.write("    Test ID			Test Result     Comment\r")
-                    f.write("----------------------------------------------------\r")
-                    # Prepare test case level report
-                    for tcr in d["tc_results"]:
-                        test_id = tcr["test_id"]
-                        test_result = tcr["test_result"]
-                        comment = tcr["comment"]
-                        f.write("    "+str(test_id)+"        "+str(test_result)+"        "+str(comment)+"\r\n")
-                
-                    f.write("----------------------------------------------------\r\n")
-                    
-            f.write("----------------------------------------------------\r")
-            f.write("                   End of Report\r")
-            f.write("----------------------------------------------------\r")
+        writer = TextReportWriter()
+        for d in self.test_res_log:
+            writer.write_suite(d)
+        writer.close(self.passed, self.failed, self.skipped)
         
-        LOG("INFO", "Test report created at " + os.path.join( os.getcwd(), "test_report.txt") )
+        LOG("INFO", "Test report created at " + os.path.abspath(writer.path) )
 
         
-    def process_logs(self, folder):
+    def process_logs(self, folder, jobs = 1, cache_file = None):
         """
         Parses all log files with target extension in the specified folder.
         @param folder Folder to look up for log files.
+        @param jobs Number of worker processes parsing files in parallel, 
+                    0 for one per CPU, 1 parses in this process.
+        @param cache_file Results cache file, None to parse every file. Only
+                    new files and files with changed size or modification
+                    time are read, and only parsed if their content changed.
+        """
+        # this list holds list of test suite result details
+        self.test_res_log = list(self.iter_suites(folder, jobs, cache_file))
+    
+    def write_reports ( self, folder, writers, jobs = 1, cache_file = None ):
+        """
+        Parses all log files like process_logs(), but every test suite goes
+        straight to the report writers instead of being kept, so memory use
+        doesn't grow with the number of suites. Writers are closed with the
+        totals once all suites are written.
+        @param folder Folder to look up for log files.
+        @param writers Report writers (report_writers.ReportWriter).
+        @param jobs Number of worker processes, see process_logs().
+        @param cache_file Results cache file, see process_logs().
+        """
+        self.test_res_log = list()
+        reports = [ writer.path for writer in writers ]
+        for ts_res_log in self.iter_suites(folder, jobs, cache_file, reports):
+            for writer in writers:
+                writer.write_suite(ts_res_log)
+        for writer in writers:
+            writer.close(self.passed, self.failed, self.skipped)
+            LOG("INFO", "Test report created at " + os.path.abspath(writer.path))
+    
+    def iter_suites ( self, folder, jobs = 1, cache_file = None, reports = () ):
+        """
+        Parses all log files with target extension in the specified folder
+        and yields their test suite result details in file order. Counts
+        include every suite yielded so far. Default report files and given
+        reports are no logs, they are left out when the folder holds them.
+        @param folder Folder to look up for log files.
+        @param jobs Number of worker processes, see process_logs().
+        @param cache_file Results cache file, see process_logs().
+        @param reports Report file paths written by this run.
         """
         LOG("INFO", "Parsing XML log files from "+folder)
         
-        self.test_res_log = [] # this list holds list of test suite result details
+        self.cache_hits = 0
         
         # The below loop traverses through all subfolders and root folder to find
         # target extension files 
+        not_logs = set( os.path.abspath(path) for path in list(REPORT_FILES.values()) + list(reports) )
+        log_files = list()
         for root_dir, dirs, files in os.walk(folder):
             for file in files:
-                if (file.endswith(self._logs_ext)):
-                    ts_res_log = dict()
-                    ts_res_log["file"] = file
-                    
-                    # Full log file path
-                    log_file = os.path.join(root_dir, file)
-                    
-                    # Parses log file
-                    try:
-                        tree = ET.parse(log_file)
-                    except:
-                        msg = "An exception occurred while parsing xml log.\r\n"
-                        LOG ( "ERROR", msg )
-                        ts_res_log["error_log"] = msg
-                    else:
-                        root = tree.getroot()
-                        ts_res_log["test_suite_id"] = root.get('test_suite')
-                        
-                        # This list hold list of test case result details
-                        tc_res_list = list() 
-                        
-                        for result in root.findall('tc_result'):
-                        
-                            # This dict holds test case result details
-                            tc_res = dict() 
-                            
-                            tc_res["test_id"] = result.get('id')
-                            tc_res["test_result"] = result.get('result')
-                            
-                            if tc_res["test_result"] == "SKIP":
-                                comment = result.find('reason')
-                            else:
-                                comment = result.find('debug')
-                                
-                            if not comment == None:
-                                tc_res["comment"] = comment.text
-                            else:
-                                tc_res["comment"] = "" 
-                            
-                            test_result = tc_res["test_result"]
-                            if test_result == "PASS":
-                                self.passed = self.passed + 1
-                            elif test_result == "FAIL":
-                                self.failed = self.failed + 1
-                            elif test_result == "SKIP":
-                                self.skipped = self.skipped + 1
-                            else:
-                                pass
-                            
-                            # Add this test case result to list
-                            tc_res_list.append(tc_res)
-                        
-                        # Add list of test case results to test suite  
-                        ts_res_log["tc_results"] = tc_res_list
-                    
-                    # Add test suite result to final list of test results
-                    self.test_res_log.append(ts_res_log)
+                path = os.path.join(root_dir, file)
+                if (file.endswith(self._logs_ext)) and not os.path.abspath(path) in not_logs:
+                    log_files.append(path)
+        
+        if jobs == 0:
+            jobs = os.cpu_count() or 1
+        
+        if cache_file is None:
+            for ts_res_log, counts in _iter_files(parse_log_file, log_files, jobs):
+                self._count_suite(ts_res_log, counts)
+                yield ts_res_log
+            return
+        
+        cache = load_results_cache(cache_file)
+        hits = list()
+        stale = list()  # (path, stat, digest of cached content)
+        
+        log_files = [ os.path.abspath(log_file) for log_file in log_files ]
+        for log_file in log_files:
+            st = os.stat(log_file)
+            entry = cache.get(log_file)
+            if entry is not None and entry["size"] == st.st_size and entry["mtime_ns"] == st.st_mtime_ns:
+                hits.append(True)
+            else:
+                hits.append(False)
+                stale.append((log_file, st, entry["digest"] if entry is not None else None))
+        
+        # Stale files are parsed in file order, merged with cached ones
+        ingested = _iter_files(_ingest_log_file, [ (log_file, digest) for log_file, st, digest in stale ], jobs)
+        stale_pos = 0
+        for log_file, hit in zip(log_files, hits):
+            if hit:
+                entry = cache[log_file]
+                self.cache_hits = self.cache_hits + 1
+            else:
+                log_file, st, digest = stale[stale_pos]
+                stale_pos = stale_pos + 1
+                ts_res_log, counts, new_digest = next(ingested)
+                if ts_res_log is None:
+                    # touched, but content is the same
+                    entry = cache[log_file]
+                    self.cache_hits = self.cache_hits + 1
+                else:
+                    entry = { "suite": ts_res_log, "counts": counts }
+                entry["size"] = st.st_size
+                entry["mtime_ns"] = st.st_mtime_ns
+                entry["digest"] = new_digest
+                cache[log_file] = entry
+            self._count_suite(entry["suite"], entry["counts"])
+            yield entry["suite"]
+        
+        # Drop files deleted from the folder, entries of other folders stay
+        seen = set(log_files)
+        prefix = os.path.join(os.path.abspath(folder), "")
+        deleted = [ p for p in cache if p.startswith(prefix) and p not in seen ]
+        for path in deleted:
+            del cache[path]
+        
+        if len(stale) > 0 or len(deleted) > 0:
+            save_results_cache(cache_file, cache)
+        LOG("INFO", str(self.cache_hits) + " of " + str(len(log_files)) + " log files from cache")
+    
+    def _count_suite ( self, ts_res_log, counts ):
+        """
+        Adds counts of a parsed test suite to totals.
+        @param ts_res_log Test suite result details.
+        @param counts Passed, failed and skipped test count of the suite.
+        """
+        if "error_log" in ts_res_log:
+            LOG ( "ERROR", ts_res_log["error_log"] )
+        self.passed = self.passed + counts[config.TEST_RES_PASS]
+        self.failed = self.failed + counts[config.TEST_RES_FAIL]
+        self.skipped = self.skipped + counts[config.TEST_RES_SKIP]
     
     #for testing purpose, return test result log
     def get_process_logs(self):
         return self.test_res_log
     
+
+def load_results_cache ( cache_file ):
+    """
+    Loads parsed results cache, a missing or outdated cache is empty.
+    @param cache_file Cache file path.
+    @return Dict of cache entries by absolute log file path.
+    """
+    # Decoding creates a dict per test case, garbage collection passes
+    # over them would take longer than decoding itself
+    gc.disable()
+    try:
+        with open( cache_file, "r", encoding = "utf-8" ) as f:
+            cache = json.load( f )
+    except ( OSError, ValueError ):
+        return dict()
+    finally:
+        gc.enable()
+    
+    if cache.get("version") != CACHE_VERSION:
+        return dict()
+    return cache["files"]
+
+def save_results_cache ( cache_file, files ):
+    """
+    Stores parsed results cache, replaced at once so an interrupted run
+    can't leave a broken cache behind.
+    @param cache_file Cache file path.
+    @param files Dict of cache entries by absolute log file path.
+    """
+    tmp_file = cache_file + ".tmp"
+    with open( tmp_file, "w", encoding = "utf-8" ) as f:
+        # dumps() encodes in C, dump() would encode piece by piece in Python
+        f.write( json.dumps( { "version": CACHE_VERSION, "files": files }, separators = ( ",", ":" ) ) )
+    os.replace( tmp_file, cache_file )
+
+def file_digest ( log_file ):
+    """
+    Returns content hash of a log file.
+    @param log_file Log file path.
+    """
+    h = hashlib.blake2b( digest_size = 16 )
+    with open( log_file, "rb" ) as f:
+        for block in iter( lambda: f.read( 1 << 20 ), b"" ):
+            h.update( block )
+    return h.hexdigest()
+
+def _ingest_log_file ( args ):
+    """
+    Parses a log file for the results cache unless its content is unchanged.
+    @param args Log file path and digest of cached content (or None).
+    @return Test suite result details (None if content is unchanged), its
+            passed, failed and skipped test counts and the content digest.
+    """
+    log_file, cached_digest = args
+    digest = file_digest( log_file )
+    if digest == cached_digest:
+        return None, None, digest
+    ts_res_log, counts = parse_log_file( log_file )
+    return ts_res_log, counts, digest
+
+def _iter_files ( fn, items, jobs ):
+    """
+    Applies a function to every item, in worker processes if jobs > 1, and
+    yields the results in item order. At most TASKS_PER_JOB items per worker
+    are in flight, the next one is submitted as each result is consumed, so
+    results waiting for the consumer don't grow with the number of items.
+    @param fn Module level function.
+    @param items Function arguments.
+    @param jobs Number of worker processes.
+    """
+    jobs = min(jobs, len(items))
+    if jobs <= 1:
+        for item in items:
+            yield fn(item)
+        return
+    
+    pending = deque()
+    with ProcessPoolExecutor(max_workers = jobs) as pool:
+        try:
+            for item in items:
+                if len(pending) >= jobs * TASKS_PER_JOB:
+                    yield pending.popleft().result()
+                pending.append(pool.submit(fn, item))
+            while pending:
+                yield pending.popleft().result()
+        finally:
+            # consumer stopped early, don't parse the rest
+            for future in pending:
+                future.cancel()
+
+def _suite_elements ( log_file, ts_res_log ):
+    """
+    Yields suite level elements of a log file and sets its test suite id.
+    Large files are parsed incrementally and every element is dropped once
+    consumed, so memory use doesn't grow with the file's DOM. Small ones are
+    parsed at once, which is faster.
+    @param log_file Log file path.
+    @param ts_res_log Test suite result details to set test suite id in.
+    """
+    if os.path.getsize(log_file) < ITERPARSE_MIN_SIZE:
+        root = ET.parse(log_file).getroot()
+        ts_res_log["test_suite_id"] = root.get('test_suite')
+        yield from root
+        return
+    
+    depth = 0
+    root = None
+    for event, elem in ET.iterparse(log_file, events = ("start", "end")):
+        if event == "start":
+            if root is None:
+                root = elem
+                ts_res_log["test_suite_id"] = root.get('test_suite')
+            depth = depth + 1
+            continue
+        
+        depth = depth - 1
+        if depth == 1:
+            yield elem
+            # Suite level element is done, release it
+            root.clear()
+
+def parse_log_file ( log_file, native = True ):
+    """
+    Parses one log file. Runs in worker processes of parallel ingestion.
+    @param log_file Log file path.
+    @param native Use the native scanner (xml_scan.py) if it's built,
+                  ElementTree parses the logs it declines.
+    @return Test suite result details and its passed, failed and skipped
+            test counts.
+    """
+    if native:
+        scanned = xml_scan.scan_log_file(log_file)
+        if scanned is not None:
+            return scanned
+    
+    ts_res_log = dict()
+    ts_res_log["file"] = os.path.basename(log_file)
+    counts = [ 0, 0, 0 ]
+    
+    # This list hold list of test case result details
+    tc_res_list = list() 
+    
+    try:
+        for elem in _suite_elements(log_file, ts_res_log):
+            if elem.tag == 'tc_result':
+                # This dict holds test case result details
+                tc_res = dict() 
+                
+                tc_res["test_id"] = elem.get('id')
+                tc_res["test_result"] = elem.get('result')
+                
+                # Optional duration in seconds
+                duration = elem.get('time')
+                if duration is not None:
+                    try:
+                        tc_res["time"] = float(duration)
+                    except ValueError:
+                        pass
+                
+                if tc_res["test_result"] == "SKIP":
+                    comment = elem.find('reason')
+                else:
+                    comment = elem.find('debug')
+                    
+                if not comment == None:
+                    tc_res["comment"] = comment.text
+                else:
+                    tc_res["comment"] = "" 
+                
+                test_result = tc_res["test_result"]
+                if test_result == "PASS":
+                    counts[config.TEST_RES_PASS] = counts[config.TEST_RES_PASS] + 1
+                elif test_result == "FAIL":
+                    counts[config.TEST_RES_FAIL] = counts[config.TEST_RES_FAIL] + 1
+                elif test_result == "SKIP":
+                    counts[config.TEST_RES_SKIP] = counts[config.TEST_RES_SKIP] + 1
+                else:
+                    pass
+                
+                # Add this test case result to list
+                tc_res_list.append(tc_res)
+    except:
+        msg = "An exception occurred while parsing xml log.\r\n"
+        return { "file": ts_res_log["file"], "error_log": msg }, [ 0, 0, 0 ]
+    
+    # Add list of test case results to test suite  
+    ts_res_log["tc_results"] = tc_res_list
+    
+    return ts_res_log, counts
+    
 # End of file        
   
\ No newline at end of file
@@ -3,8 +3,12 @@
 
 import sys
 import os
+import getopt
 
 from logParserClass import logParser
+from report_writers import REPORT_WRITERS
+from results_db import ResultsDbWriter
+import console_follow
 import config
 from console_log import LOG
 
@@ -15,34 +19,109 @@ def print_help ():
     print ("This tool prints test metrics from log files to test_metrics.txt.")
     print ("Location of this file would be same as tool's location.")
     print ("Enter below command to generate the file.")
-    print ("python log_parser.py <log folder root path>")
+    print ("python log_parser.py [-j jobs] [-c] [-f formats] [-d] [-r revision] <log folder root path>")
+    print ("python log_parser.py -F <console output> [-i seconds] [-w seconds] [-f formats] [-d] [-r revision]")
+    print ("  -j  parse log files in given number of worker processes, 0 = one per CPU")
+    print ("  -c  keep parsed results in " + config.RESULTS_CACHE_FILE + ", only new and changed")
+    print ("      log files are parsed")
+    print ("  -f  comma separated report formats written in one pass: text (default), junit, jsonl")
+    print ("  -d  append results to history database " + config.RESULTS_DB_FILE + " (query with results_db.py)")
+    print ("  -r  revision (commit) the results belong to, stored with -d")
+    print ("  -F  follow test controller console output (file, pipe, pty or serial device, - for stdin)")
+    print ("      and turn it into results of one suite while the run goes on")
+    print ("  -i  seconds between partial report rewrites in follow mode, default " + str(FLUSH_INTERVAL))
+    print ("  -w  seconds a followed file may stay unchanged before the run is taken as ended,")
+    print ("      default " + str(IDLE_TIMEOUT) + ", 0 = follow until interrupted")
+
+"""
+This function prints live counts in follow mode
+"""
+def print_case ( results, tc_res ):
+    passed, failed, skipped = results.counts
+    print ("Test " + tc_res["test_id"] + ": " + tc_res["test_result"] + "  (passed " + str(passed) +
+           ", failed " + str(failed) + ", skipped " + str(skipped) + ", executing " + str(results.total) + ")")
 
 '''
-cmd : python log_parser.py <log folder root path>
+cmd : python log_parser.py [-j jobs] [-c] [-f formats] [-d] [-r revision] <log folder root path>
+      python log_parser.py -F <console output> [-i seconds] [-w seconds] [-f formats] [-d] [-r revision]
 '''
+FLUSH_INTERVAL = 5          # seconds between partial reports in follow mode
+IDLE_TIMEOUT = 10           # seconds a followed file may stay unchanged
+
 if __name__ == "__main__":
 
-    if len(sys.argv) < 2:
-        LOG ("ERROR", "Log path is not provided");
+    jobs = 1
+    cache_file = None
+    formats = [ "text" ]
+    history_db = False
+    revision = None
+    follow_source = None
+    flush_interval = FLUSH_INTERVAL
+    idle_timeout = IDLE_TIMEOUT
+    try:
+        opts, args = getopt.getopt (sys.argv[1:], "hj:cf:dr:F:i:w:")
+    except getopt.GetoptError:
         print_help ()
         exit (1)
     
-    if sys.argv[1] == "-h":
-        print_help ()
+    for opt, val in opts:
+        if opt == "-h":
+            print_help ()
+            exit (0)
+        elif opt == "-j":
+            jobs = int (val)
+        elif opt == "-c":
+            cache_file = config.RESULTS_CACHE_FILE
+        elif opt == "-f":
+            formats = val.split (",")
+            for fmt in formats:
+                if not fmt in REPORT_WRITERS:
+                    LOG ("ERROR", "Unknown report format " + fmt);
+                    print_help ()
+                    exit (1)
+        elif opt == "-d":
+            history_db = True
+        elif opt == "-r":
+            revision = val
+        elif opt == "-F":
+            follow_source = val
+        elif opt == "-i":
+            flush_interval = float (val)
+        elif opt == "-w":
+            idle_timeout = float (val)
+    
+    if follow_source is not None:
+        # turn console output into results while the test run goes on
+        results = console_follow.follow (follow_source, formats, flush_interval, idle_timeout,
+                                         on_case = print_case)
+        if history_db:
+            writer = ResultsDbWriter (config.RESULTS_DB_FILE, revision, os.path.abspath (follow_source))
+            writer.write_suite (results.ts_res_log)
+            writer.close (*results.counts)
+        LOG ("INFO", "total passed: " +str(results.counts[config.TEST_RES_PASS]))
+        LOG ("INFO", "total failed: " +str(results.counts[config.TEST_RES_FAIL]))
+        LOG ("INFO", "total skipped: " +str(results.counts[config.TEST_RES_SKIP]))
         exit (0)
+    
+    if len(args) < 1:
+        LOG ("ERROR", "Log path is not provided");
+        print_help ()
+        exit (1)
         
-    log_dir = sys.argv[1]
+    log_dir = args[0]
     if not os.path.exists (log_dir):
         LOG ("ERROR", "Provided log path " + log_dir + " doesn't exist");
         exit (1)
     
-    # perform xml log parsing from given path and generate detailed test report
+    # perform xml log parsing from given path and stream suites into reports
     lp = logParser("xml")
-    lp.process_logs(log_dir)
+    writers = [ REPORT_WRITERS[fmt]() for fmt in formats ]
+    if history_db:
+        writers.append (ResultsDbWriter (config.RESULTS_DB_FILE, revision, os.path.abspath (log_dir)))
+    lp.write_reports(log_dir, writers, jobs, cache_file)
     LOG ("INFO", "total passed: " +str(lp.get_result_by_type(config.TEST_RES_PASS)))
     LOG ("INFO", "total failed: " +str(lp.get_result_by_type(config.TEST_RES_FAIL)))
     LOG ("INFO", "total skipped: " +str(lp.get_result_by_type(config.TEST_RES_SKIP)))
-    lp.generate_detailed_report()
 
  # End of file 
  
\ No newline at end of file
@@ -0,0 +1,291 @@
+#!/usr/bin/env
+# -*- coding: utf-8 -*-
+
+import os
+import re
+import sys
+import json
+import shutil
+import tempfile
+import subprocess
+from concurrent.futures import ThreadPoolExecutor
+
+import config
+from console_log import LOG
+
+"""
+Mutation testing runner for the C test application.
+
+Operator, constant and boundary mutants of the SUT source are generated, built
+and run against the test case list with tc_runner in parallel. Every mutant
+run stops at its first failing case (tc_runner -x 1) and cases are ordered by
+their historical kill rate, so mutants usually die on the first case. Only
+the SUT object is recompiled per mutant, the rest of the runner is built once.
+
+cmd : python mutation_runner.py [-j jobs] [sut source]
+"""
+
+C_DIR = os.path.join( os.path.dirname( os.path.abspath( __file__ ) ), "..", "C" )
+
+# Test runner sources linked with every mutant of the SUT
+RUNNER_SOURCES = [ "tools/tc_runner.c", "test_controller.c", "tc_guard.c", "tc_history.c", "test_app.c",
+                   "test_random.c", "test_param.c", "tc_perf.c", "tc_metrics.c",
+                   "tc_timeline.c" ]
+
+# (regex, replacements) applied to every match in code (comments are skipped)
+MUTATION_OPERATORS = [
+    ( r"(?<![<>=!-])>(?!=)", [ ">=" ] ),
+    ( r">=", [ ">" ] ),
+    ( r"(?<![<>=!])<(?![=<])", [ "<=" ] ),
+    ( r"<=", [ "<" ] ),
+    ( r"==", [ "!=" ] ),
+    ( r"!=", [ "==" ] ),
+    ( r"\+\+", [ "--" ] ),
+    ( r"--", [ "++" ] ),
+    ( r"\btrue\b", [ "false" ] ),
+    ( r"\bfalse\b", [ "true" ] ),
+    ( r"\bCQ_OK\b", [ "CQ_IS_FULL" ] ),
+    ( r"\bCQ_IS_FULL\b", [ "CQ_OK" ] ),
+    ( r"\bCQ_IS_EMPTY\b", [ "CQ_OK" ] ),
+    ( r"\bCQ_SIZE\b", [ "(CQ_SIZE - 1)", "(CQ_SIZE + 1)" ] ),
+    ( r"(?<![\w.])0(?![\w.])", [ "1" ] ),
+    ( r"(?<![\w.])1(?![\w.])", [ "0", "2" ] ),
+]
+
+
+class Mutant:
+    def __init__ ( self, mid, line, original, replacement, source ):
+        """
+        Class constructor.
+        @param mid Mutant id.
+        @param line Line number of the mutated token.
+        @param original Original token.
+        @param replacement Mutated token.
+        @param source Mutated source text.
+        """
+        self.mid = mid
+        self.line = line
+        self.original = original
+        self.replacement = replacement
+        self.source = source
+        self.status = None      # "KILLED", "SURVIVED" or "BUILD_ERROR"
+        self.killer = None      # name of the first failing case
+
+
+def mask_comments ( text ):
+    """
+    Returns text with comments, strings and preprocessor lines blanked out, so
+    that offsets still match the original text.
+    @param text C source text.
+    """
+    def blank ( m ):
+        return re.sub( r"[^\n]", " ", m.group(0) )
+    pattern = r'/\*.*?\*/|//[^\n]*|"(?:\\.|[^"\\])*"|^[ \t]*#[^\n]*'
+    return re.sub( pattern, blank, text, flags = re.DOTALL | re.MULTILINE )
+
+
+def generate_mutants ( text ):
+    """
+    Generates all single token mutants of a source file.
+    @param text C source text.
+    """
+    code = mask_comments( text )
+    mutants = list()
+    for pattern, replacements in MUTATION_OPERATORS:
+        for m in re.finditer( pattern, code ):
+            line = code.count( "\n", 0, m.start() ) + 1
+            for rep in replacements:
+                source = text[:m.start()] + rep + text[m.end():]
+                mutants.append( Mutant( len(mutants), line, m.group(0), rep, source ) )
+    return mutants
+
+
+class MutationRunner:
+
+    def __init__ ( self, sut_source, jobs, history_file ):
+        """
+        Class constructor.
+        @param sut_source Path of the SUT source to mutate.
+        @param jobs Number of parallel build/run jobs.
+        @param history_file Path of kill rate history file.
+        """
+        self.sut_source = sut_source
+        self.jobs = jobs
+        self.history_file = history_file
+        self.history = dict()
+        self.work_dir = tempfile.mkdtemp( prefix = "mutants_" )
+        self.cc = os.environ.get( "CC", "gcc" )
+        self.cflags = [ "-O1", "-I" + C_DIR, "-I" + os.path.dirname( sut_source ) ]
+        self.objects = list()
+        self.cases = list()     # (index, name) of cases passing on original SUT
+        self.timeout = 10
+
+    def load_history ( self ):
+        """
+        Loads per test case run/kill counts of previous mutation runs.
+        """
+        try:
+            with open( self.history_file, "r", encoding = "utf-8" ) as f:
+                self.history = json.load( f )
+        except ( OSError, ValueError ):
+            self.history = dict()
+
+    def save_history ( self ):
+        """
+        Stores per test case run/kill counts.
+        """
+        with open( self.history_file, "w", encoding = "utf-8" ) as f:
+            json.dump( self.history, f, indent = 1, sort_keys = True )
+
+    def kill_rate ( self, name ):
+        """
+        Returns smoothed historical kill rate of a test case.
+        @param name Test case name.
+        """
+        h = self.history.get( name, { "runs": 0, "kills": 0 } )
+        return ( h["kills"] + 1.0 ) / ( h["runs"] + 2.0 )
+
+    def build ( self, sut_file, exe ):
+        """
+        Compiles SUT source and links it with prebuilt runner objects.
+        @param sut_file SUT source file.
+        @param exe Output executable.
+        """
+        cmd = [ self.cc ] + self.cflags + [ sut_file ] + self.objects + [ "-o", exe ]
+        return subprocess.call( cmd, stdout = subprocess.DEVNULL, stderr = subprocess.DEVNULL ) == 0
+
+    def prepare ( self ):
+        """
+        Builds runner objects once, then runs the original SUT to find the
+        test cases usable for killing mutants (the ones passing on original).
+        """
+        for src in RUNNER_SOURCES:
+            obj = os.path.join( self.work_dir, os.path.basename( src ) + ".o" )
+            cmd = [ self.cc, "-c" ] + self.cflags + [ os.path.join( C_DIR, src ), "-o", obj ]
+            if subprocess.call( cmd, stderr = subprocess.DEVNULL ) != 0:
+                raise Exception( "failed to build " + src )
+            self.objects.append( obj )
+
+        exe = os.path.join( self.work_dir, "original" )
+        if not self.build( self.sut_source, exe ):
+            raise Exception( "failed to build original SUT" )
+
+        listing = subprocess.run( [ exe, "-l" ], stdout = subprocess.PIPE, universal_newlines = True, cwd = C_DIR ).stdout
+        all_cases = [ line.split( None, 1 ) for line in listing.splitlines() if line.strip() ]
+
+        run = subprocess.run( [ exe ], stdout = subprocess.PIPE, universal_newlines = True, cwd = C_DIR )
+        failing = set( re.findall( r"^\[FAIL\] (\d+)", run.stdout, re.MULTILINE ) )
+        for idx, name in all_cases:
+            if idx in failing:
+                LOG( "INFO", "case " + name + " fails on original SUT, not used for killing" )
+            else:
+                self.cases.append( ( idx, name ) )
+
+    def run_mutant ( self, mutant, order ):
+        """
+        Builds and runs one mutant until its first failing case.
+        @param mutant Mutant to run.
+        @param order Comma separated test case indexes.
+        """
+        src = os.path.join( self.work_dir, "m%d_%s" % ( mutant.mid, os.path.basename( self.sut_source ) ) )
+        exe = os.path.join( self.work_dir, "m%d" % mutant.mid )
+        with open( src, "w", encoding = "utf-8" ) as f:
+            f.write( mutant.source )
+
+        if not self.build( src, exe ):
+            mutant.status = "BUILD_ERROR"
+        else:
+            try:
+                run = subprocess.run( [ exe, "-x", "1", "-o", order ], stdout = subprocess.PIPE,
+                                      universal_newlines = True, errors = "replace", timeout = self.timeout,
+                                      cwd = C_DIR )
+                m = re.search( r"^\[FAIL\] \d+ (\S+)", run.stdout, re.MULTILINE )
+                if m:
+                    mutant.status = "KILLED"
+                    mutant.killer = m.group(1)
+                elif run.returncode != 0:
+                    mutant.status = "KILLED"
+                    mutant.killer = "crash"
+                else:
+                    mutant.status = "SURVIVED"
+            except subprocess.TimeoutExpired:
+                mutant.status = "KILLED"
+                mutant.killer = "timeout"
+
+        for path in ( src, exe ):
+            if os.path.exists( path ):
+                os.remove( path )
+        return mutant
+
+    def run ( self ):
+        """
+        Generates and runs all mutants, returns list of mutants with status.
+        """
+        self.load_history()
+        self.prepare()
+
+        # order cases so that historically strongest killers run first
+        self.cases.sort( key = lambda c: self.kill_rate( c[1] ), reverse = True )
+        order = ",".join( idx for idx, name in self.cases )
+
+        with open( self.sut_source, "r", encoding = "utf-8" ) as f:
+            mutants = generate_mutants( f.read() )
+        LOG( "INFO", str( len(mutants) ) + " mutants generated, running with " + str( self.jobs ) + " jobs" )
+
+        with ThreadPoolExecutor( max_workers = self.jobs ) as pool:
+            results = list( pool.map( lambda m: self.run_mutant( m, order ), mutants ) )
+
+        # every case ran on survivors, on killed mutants only cases up to the killer ran
+        for m in results:
+            if m.status == "BUILD_ERROR":
+                continue
+            for idx, name in self.cases:
+                h = self.history.setdefault( name, { "runs": 0, "kills": 0 } )
+                h["runs"] = h["runs"] + 1
+                if name == m.killer:
+                    h["kills"] = h["kills"] + 1
+                    break
+        self.save_history()
+
+        shutil.rmtree( self.work_dir, ignore_errors = True )
+        return results
+
+
+def print_report ( results, sut_source ):
+    """
+    Prints mutation score and surviving mutants.
+    @param results List of mutants with status.
+    @param sut_source Mutated source file.
+    """
+    killed = [ m for m in results if m.status == "KILLED" ]
+    survived = [ m for m in results if m.status == "SURVIVED" ]
+    stillborn = len(results) - len(killed) - len(survived)
+    total = len(killed) + len(survived)
+    score = ( 100.0 * len(killed) / total ) if total > 0 else 0.0
+
+    print( "----------------------------------------------------" )
+    print( "Mutation score: %.1f%% (%d killed, %d survived, %d not built)" % ( score, len(killed), len(survived), stillborn ) )
+    print( "----------------------------------------------------" )
+    for m in survived:
+        print( "SURVIVED  %s:%d  '%s' -> '%s'" % ( os.path.basename( sut_source ), m.line, m.original, m.replacement ) )
+
+
+if __name__ == "__main__":
+
+    jobs = os.cpu_count() or 1
+    args = sys.argv[1:]
+    if len(args) >= 2 and args[0] == "-j":
+        jobs = int( args[1] )
+        args = args[2:]
+
+    sut = args[0] if len(args) > 0 else os.path.join( C_DIR, "sut", "circular_queue.c" )
+    if not os.path.exists( sut ):
+        LOG ( "ERROR", "Provided SUT source " + sut + " doesn't exist" )
+        exit (1)
+
+    runner = MutationRunner( os.path.abspath( sut ), jobs, config.MUTATION_HISTORY_FILE )
+    results = runner.run()
+    print_report( results, sut )
+    exit ( 0 if all( m.status != "SURVIVED" for m in results ) else 1 )
+
+# End of file
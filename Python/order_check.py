@@ -0,0 +1,241 @@
+#!/usr/bin/env
+# -*- coding: utf-8 -*-
+
+import os
+import sys
+import random
+import getopt
+import shutil
+import tempfile
+import subprocess
+from concurrent.futures import ThreadPoolExecutor
+
+from console_log import LOG
+from console_follow import ConsoleResults
+from mutation_runner import C_DIR, RUNNER_SOURCES
+
+"""
+Test order dependency detector for the C test application.
+
+Test cases share global fixtures (q[0]/q[1]) and controller state, so a case
+may pass or fail depending on what ran before it. Every case is run alone in
+its own tc_runner process for its isolated outcome, then the whole list runs
+in list order, reversed and in seeded shuffled orders, all in parallel
+processes. A case whose outcome in some order differs from its isolated one
+depends on its predecessors there; delta debugging (ddmin) shrinks those
+predecessors to the minimal set reproducing the difference, usually the one
+case interfering with it.
+
+cmd : python order_check.py [-j jobs] [-n shuffles] [-s seed] [-b tc_runner]
+"""
+
+SHUFFLES = 8            # shuffled orders run besides list and reversed order
+RUN_TIMEOUT = 30        # seconds, a hanging run fails its running case
+
+
+class OrderChecker:
+
+    def __init__ ( self, jobs, runner = None ):
+        """
+        Class constructor.
+        @param jobs Number of parallel runs.
+        @param runner tc_runner executable, None builds one from C sources.
+        """
+        self.jobs = jobs
+        self.runner = runner
+        self.work_dir = None
+        self.cases = list()         # (index, name) of the compiled-in list
+        self.isolated = dict()      # case index -> outcome when run alone
+        self.runs = 0
+
+    def prepare ( self ):
+        """
+        Builds tc_runner unless given and lists its test cases.
+        """
+        if self.runner is None:
+            self.work_dir = tempfile.mkdtemp( prefix = "order_check_" )
+            self.runner = os.path.join( self.work_dir, "tc_runner" )
+            cmd = [ os.environ.get( "CC", "gcc" ), "-O1", "-I" + C_DIR ] + \
+                  [ os.path.join( C_DIR, src ) for src in RUNNER_SOURCES ] + \
+                  [ os.path.join( C_DIR, "sut", "circular_queue.c" ), "-o", self.runner ]
+            if subprocess.call( cmd, stderr = subprocess.DEVNULL ) != 0:
+                raise Exception( "failed to build tc_runner" )
+
+        listing = subprocess.run( [ self.runner, "-l" ], stdout = subprocess.PIPE, universal_newlines = True,
+                                  cwd = C_DIR ).stdout
+        self.cases = [ ( int( idx ), name ) for idx, name in
+                       ( line.split( None, 1 ) for line in listing.splitlines() if line.strip() ) ]
+
+    def run_order ( self, order ):
+        """
+        Runs test cases in a fresh tc_runner process.
+        @param order List of test case indexes.
+        @return Dict of case index -> "PASS" / "FAIL" for cases that ran.
+                A case running when the process crashed or hung is "FAIL",
+                cases after it are missing.
+        """
+        self.runs = self.runs + 1
+        proc = subprocess.Popen( [ self.runner, "-o", ",".join( str( i ) for i in order ) ],
+                                 stdout = subprocess.PIPE, stderr = subprocess.DEVNULL, cwd = C_DIR )
+        try:
+            out = proc.communicate( timeout = RUN_TIMEOUT )[0]
+        except subprocess.TimeoutExpired:
+            proc.kill()
+            out = proc.communicate()[0]
+
+        results = ConsoleResults( "tc_runner" )
+        for line in out.decode( "utf-8", errors = "replace" ).splitlines():
+            results.feed( line )
+        results.finish()
+        return { r["index"]: r["test_result"] for r in results.ts_res_log["tc_results"]
+                 if r["test_result"] != "SKIP" and r.get( "index" ) in order }
+
+    def orders ( self, shuffles, seed ):
+        """
+        Returns the orders the whole list is run in.
+        @param shuffles Number of shuffled orders.
+        @param seed Seed of the first shuffled order, the next ones count up.
+        """
+        forward = [ idx for idx, name in self.cases ]
+        orders = [ ( "list order", forward ), ( "reversed", forward[::-1] ) ]
+        for k in range( shuffles ):
+            order = list( forward )
+            random.Random( seed + k ).shuffle( order )
+            orders.append( ( "shuffle seed %d" % ( seed + k ), order ) )
+        return orders
+
+    def minimize ( self, victim, predecessors, outcome ):
+        """
+        Shrinks predecessors of a case to a minimal set still changing its
+        outcome (ddmin). Relative order of predecessors is kept.
+        @param victim Case index.
+        @param predecessors Case indexes run before it in the divergent order.
+        @param outcome Divergent outcome.
+        @return Minimal predecessor list, None if the divergence doesn't
+                reproduce (flaky case).
+        """
+        tested = dict()
+
+        def reproduces ( subset ):
+            key = tuple( subset )
+            if key not in tested:
+                tested[key] = self.run_order( list( subset ) + [ victim ] ).get( victim ) == outcome
+            return tested[key]
+
+        if not reproduces( predecessors ):
+            return None
+
+        items = list( predecessors )
+        n = 2
+        while len( items ) >= 2:
+            size = ( len( items ) + n - 1 ) // n
+            chunks = [ items[k:k + size] for k in range( 0, len( items ), size ) ]
+            reduced = False
+            for chunk in chunks:
+                if reproduces( chunk ):
+                    items, n, reduced = chunk, 2, True
+                    break
+            if not reduced:
+                for chunk in chunks:
+                    complement = [ i for i in items if i not in chunk ]
+                    if reproduces( complement ):
+                        items, n, reduced = complement, max( n - 1, 2 ), True
+                        break
+            if not reduced:
+                if n >= len( items ):
+                    break
+                n = min( len( items ), 2 * n )
+        return items
+
+    def run ( self, shuffles = SHUFFLES, seed = 1 ):
+        """
+        Runs isolated and whole list orders, then minimizes every divergence.
+        @param shuffles Number of shuffled orders.
+        @param seed Seed of the first shuffled order.
+        @return List of (case index, isolated outcome, outcome, order name,
+                minimal predecessors or None if not reproducible).
+        """
+        self.prepare()
+        orders = self.orders( shuffles, seed )
+        LOG( "INFO", "%d cases, %d orders, running with %d jobs" % ( len( self.cases ), len( orders ), self.jobs ) )
+
+        with ThreadPoolExecutor( max_workers = self.jobs ) as pool:
+            singles = pool.map( lambda c: self.run_order( [ c[0] ] ), self.cases )
+            whole = list( pool.map( lambda o: self.run_order( o[1] ), orders ) )
+            for ( idx, name ), outcome in zip( self.cases, singles ):
+                self.isolated[idx] = outcome.get( idx, "FAIL" )
+
+            # first divergent order of every case
+            divergent = dict()
+            for ( order_name, order ), outcomes in zip( orders, whole ):
+                for pos, idx in enumerate( order ):
+                    outcome = outcomes.get( idx )
+                    if outcome is not None and outcome != self.isolated[idx] and idx not in divergent:
+                        divergent[idx] = ( outcome, order_name, order[:pos] )
+
+            victims = sorted( divergent )
+            minimal = pool.map( lambda v: self.minimize( v, divergent[v][2], divergent[v][0] ), victims )
+            findings = [ ( v, self.isolated[v], divergent[v][0], divergent[v][1], m )
+                         for v, m in zip( victims, minimal ) ]
+
+        if self.work_dir is not None:
+            shutil.rmtree( self.work_dir, ignore_errors = True )
+        return findings
+
+
+def print_report ( checker, findings ):
+    """
+    Prints order dependent test cases with their interfering predecessors.
+    @param checker OrderChecker which produced the findings.
+    @param findings List of findings, see OrderChecker.run().
+    """
+    names = dict( checker.cases )
+    dependent = [ f for f in findings if f[4] is not None ]
+    print( "----------------------------------------------------" )
+    print( "Order dependent cases: %d of %d (%d runs)" % ( len( dependent ), len( checker.cases ), checker.runs ) )
+    print( "----------------------------------------------------" )
+    for idx, isolated, outcome, order_name, preds in findings:
+        case = "%d %s" % ( idx, names[idx] )
+        if preds is None:
+            print( "FLAKY     %s: %s alone, %s in %s, not reproducible" % ( case, isolated, outcome, order_name ) )
+        elif len( preds ) == 0:
+            print( "DEPENDENT %s: %s alone, %s after any case" % ( case, isolated, outcome ) )
+        else:
+            print( "DEPENDENT %s: %s alone, %s after %s (%s)" %
+                   ( case, isolated, outcome, ", ".join( "%d %s" % ( p, names[p] ) for p in preds ), order_name ) )
+
+
+if __name__ == "__main__":
+
+    jobs = os.cpu_count() or 1
+    shuffles = SHUFFLES
+    seed = 1
+    runner = None
+    try:
+        opts, args = getopt.getopt( sys.argv[1:], "hj:n:s:b:" )
+    except getopt.GetoptError:
+        opts = [ ( "-h", "" ) ]
+
+    for opt, val in opts:
+        if opt == "-h":
+            print( "python order_check.py [-j jobs] [-n shuffles] [-s seed] [-b tc_runner]" )
+            print( "  -j  parallel runs, default one per CPU" )
+            print( "  -n  shuffled orders besides list and reversed order, default " + str( SHUFFLES ) )
+            print( "  -s  seed of the first shuffled order, default 1" )
+            print( "  -b  use given tc_runner build instead of building one" )
+            exit( 0 )
+        elif opt == "-j":
+            jobs = int( val )
+        elif opt == "-n":
+            shuffles = int( val )
+        elif opt == "-s":
+            seed = int( val )
+        elif opt == "-b":
+            runner = os.path.abspath( val )
+
+    checker = OrderChecker( jobs, runner )
+    findings = checker.run( shuffles, seed )
+    print_report( checker, findings )
+    exit( 0 if all( f[4] is None for f in findings ) else 1 )
+
+# End of file
@@ -0,0 +1,243 @@
+#!/usr/bin/env 
+# -*- coding: utf-8 -*-
+
+import json
+from abc import ABC, abstractmethod
+from xml.sax.saxutils import escape as _escape, quoteattr as _quoteattr
+
+import config
+
+"""
+Streaming report writers. Test suites are written one by one as they are
+parsed (logParser.write_reports), so no writer keeps more than one suite in
+memory. Totals are only known at the end, they are patched into space
+reserved at the beginning of the file or written as a trailer.
+"""
+
+EOL = "\r\n"                # report line ending
+SEPARATOR = "-" * 52
+BUFFER_SIZE = 1 << 20       # output buffer, bytes
+
+
+def escape ( text ):
+    """
+    Escapes XML character data, most text needs no escaping.
+    @param text Text to escape.
+    """
+    if "&" in text or "<" in text or ">" in text:
+        return _escape(text)
+    return text
+
+def quoteattr ( text ):
+    """
+    Quotes XML attribute value, most values need no escaping.
+    @param text Attribute value.
+    """
+    for c in "&<>\"\n\r\t":
+        if c in text:
+            return _quoteattr(text)
+    return '"' + text + '"'
+
+
+class ReportWriter ( ABC ):
+
+    def __init__ ( self, path ):
+        """
+        Base class constructor, opens report file for binary buffered output.
+        @param path Report file path.
+        """
+        self.path = path
+        self._f = open(path, "wb", buffering = BUFFER_SIZE)
+
+    @abstractmethod
+    def write_suite ( self, ts_res_log ):
+        """
+        Writes one test suite.
+        @param ts_res_log Test suite result details (logParser format).
+        """
+        pass
+
+    def close ( self, passed, failed, skipped ):
+        """
+        Completes report with totals and closes it.
+        @param passed Passed test count.
+        @param failed Failed test count.
+        @param skipped Skipped test count.
+        """
+        self._f.close()
+
+    def _write ( self, text ):
+        """
+        Writes text to report file.
+        @param text Text to write.
+        """
+        self._f.write(text.encode("utf-8"))
+
+    def _patch ( self, pos, text, width ):
+        """
+        Overwrites reserved space with text padded to its width, text longer
+        than the space would corrupt the report and raises ValueError.
+        @param pos File position of reserved space.
+        @param text Text to write, at most width characters.
+        @param width Reserved width.
+        """
+        if len(text) > width:
+            raise ValueError("%s: %d characters don't fit in %d reserved" % ( self.path, len(text), width ))
+        self._f.seek(pos)
+        self._write(text.ljust(width))
+        self._f.seek(0, 2)
+
+
+class TextReportWriter ( ReportWriter ):
+
+    def __init__ ( self, path = config.REPORT_TEXT_FILE ):
+        """
+        Class constructor, writes report heading.
+        @param path Report file path.
+        """
+        super().__init__(path)
+        self._write(SEPARATOR + EOL + "                   Test Report" + EOL + SEPARATOR + EOL)
+
+    def write_suite ( self, ts_res_log ):
+        """
+        Writes detailed report of one test suite.
+        @param ts_res_log Test suite result details.
+        """
+        lines = [ "Below test details created using: " + ts_res_log["file"] ]
+        
+        # Skip detailed reporting in case there was an error and just print 
+        # an error message obtained while processing log files
+        if "error_log" in ts_res_log:
+            lines.append(ts_res_log["error_log"].rstrip("\r\n"))
+        else:
+            lines.append("Test Suite ID: " + str(ts_res_log["test_suite_id"]))
+            lines.append(SEPARATOR)
+            lines.append("    Test ID			Test Result     Comment")
+            lines.append(SEPARATOR)
+            for tcr in ts_res_log["tc_results"]:
+                lines.append(("    " + str(tcr["test_id"]) + "        " + str(tcr["test_result"]) +
+                              "        " + str(tcr["comment"])).rstrip())
+        lines.append(SEPARATOR)
+        self._write(EOL.join(lines) + EOL)
+
+    def close ( self, passed, failed, skipped ):
+        """
+        Writes summary as trailer and end of report.
+        @param passed Passed test count.
+        @param failed Failed test count.
+        @param skipped Skipped test count.
+        """
+        summary = EOL.join([ "Total tests: " + str(passed + failed + skipped), "Passed: " + str(passed),
+                             "Failed: " + str(failed), "Skipped: " + str(skipped) ])
+        self._write("--------------------  Summary ----------------------" + EOL + summary + EOL)
+        self._write(SEPARATOR + EOL + "                   End of Report" + EOL + SEPARATOR + EOL)
+        super().close(passed, failed, skipped)
+
+
+class JUnitReportWriter ( ReportWriter ):
+
+    TOTALS_WIDTH = 128      # reserved for totals attributes of <testsuites>, fits 20 digit counts
+
+    def __init__ ( self, path = config.REPORT_JUNIT_FILE ):
+        """
+        Class constructor, opens <testsuites> with space for totals.
+        @param path Report file path.
+        """
+        super().__init__(path)
+        self._errors = 0        # logs which couldn't be parsed
+        self._write('<?xml version="1.0" encoding="UTF-8"?>\n<testsuites name="tinyTester" ')
+        self._totals_pos = self._f.tell()
+        self._write(" " * self.TOTALS_WIDTH + ">\n")
+
+    def write_suite ( self, ts_res_log ):
+        """
+        Writes one test suite as <testsuite>, a log which couldn't be parsed
+        as a suite with one erroneous test case.
+        @param ts_res_log Test suite result details.
+        """
+        if "error_log" in ts_res_log:
+            self._errors += 1
+            self._write('  <testsuite name=%s tests="1" failures="0" errors="1" skipped="0">\n'
+                        '    <testcase classname=%s name="parse log"><error message=%s/></testcase>\n'
+                        '  </testsuite>\n' % ( quoteattr(ts_res_log["file"]), quoteattr(ts_res_log["file"]),
+                                               quoteattr(ts_res_log["error_log"].strip()) ))
+            return
+        
+        suite = str(ts_res_log["test_suite_id"])
+        results = [ tcr["test_result"] for tcr in ts_res_log["tc_results"] ]
+        lines = [ '  <testsuite name=%s tests="%d" failures="%d" errors="0" skipped="%d" file=%s>' %
+                  ( quoteattr(suite), len(results), results.count("FAIL"), results.count("SKIP"),
+                    quoteattr(ts_res_log["file"]) ) ]
+        for tcr in ts_res_log["tc_results"]:
+            comment = tcr["comment"] if tcr["comment"] is not None else ""
+            case = '    <testcase classname=%s name=%s' % ( quoteattr(suite), quoteattr(str(tcr["test_id"])) )
+            if "time" in tcr:
+                case = case + ' time="%.6f"' % tcr["time"]
+            if tcr["test_result"] == "FAIL":
+                lines.append(case + '><failure message=%s/></testcase>' % quoteattr(comment))
+            elif tcr["test_result"] == "SKIP":
+                lines.append(case + '><skipped message=%s/></testcase>' % quoteattr(comment))
+            elif comment != "":
+                lines.append(case + '><system-out>%s</system-out></testcase>' % escape(comment))
+            else:
+                lines.append(case + '/>')
+        lines.append('  </testsuite>')
+        self._write("\n".join(lines) + "\n")
+
+    def close ( self, passed, failed, skipped ):
+        """
+        Closes <testsuites> and writes its totals.
+        @param passed Passed test count.
+        @param failed Failed test count.
+        @param skipped Skipped test count.
+        """
+        self._write("</testsuites>\n")
+        self._patch(self._totals_pos, 'tests="%d" failures="%d" errors="%d" skipped="%d"' %
+                    ( passed + failed + skipped + self._errors, failed, self._errors, skipped ),
+                    self.TOTALS_WIDTH)
+        super().close(passed, failed, skipped)
+
+
+class JsonLinesReportWriter ( ReportWriter ):
+
+    def __init__ ( self, path = config.REPORT_JSONL_FILE ):
+        """
+        Class constructor.
+        @param path Report file path.
+        """
+        super().__init__(path)
+
+    def write_suite ( self, ts_res_log ):
+        """
+        Writes one test suite as JSON object line.
+        @param ts_res_log Test suite result details.
+        """
+        self._write(json.dumps(ts_res_log) + "\n")
+
+    def close ( self, passed, failed, skipped ):
+        """
+        Writes totals as trailer line.
+        @param passed Passed test count.
+        @param failed Failed test count.
+        @param skipped Skipped test count.
+        """
+        self._write(json.dumps({ "summary": { "total": passed + failed + skipped, "passed": passed,
+                                              "failed": failed, "skipped": skipped } }) + "\n")
+        super().close(passed, failed, skipped)
+
+
+# Writer class by report format name
+REPORT_WRITERS = {
+    "text": TextReportWriter,
+    "junit": JUnitReportWriter,
+    "jsonl": JsonLinesReportWriter,
+}
+
+# Default report file by report format name
+REPORT_FILES = {
+    "text": config.REPORT_TEXT_FILE,
+    "junit": config.REPORT_JUNIT_FILE,
+    "jsonl": config.REPORT_JSONL_FILE,
+}
+
+# End of file 
@@ -0,0 +1,234 @@
+#!/usr/bin/env 
+# -*- coding: utf-8 -*-
+
+import os
+import sys
+import time
+import getopt
+import sqlite3
+
+import config
+from console_log import LOG
+from report_writers import ReportWriter
+
+"""
+Results history database. ResultsDbWriter is a report writer appending every
+run's suite and test case results to an SQLite database; the query functions
+and command line below answer trend questions from it. Test case rows carry
+their run's timestamp, so per test case queries are answered from one
+covering index, without joining thousands of runs.
+
+cmd : python results_db.py [-d db_file] [-n runs] <query> [test id]
+      queries:
+        runs                  latest runs with their counts
+        trend <test id>       pass rate of a test case per run
+        first-failure <test id>
+                              run (and revision) where the current failure
+                              streak of a test case started, a run fails it
+                              if any of its executions failed
+        slowest               slowest test cases by mean duration
+"""
+
+SCHEMA = """
+CREATE TABLE IF NOT EXISTS runs (
+    id INTEGER PRIMARY KEY, started REAL NOT NULL, revision TEXT, folder TEXT,
+    passed INTEGER DEFAULT 0, failed INTEGER DEFAULT 0, skipped INTEGER DEFAULT 0 );
+CREATE TABLE IF NOT EXISTS suites (
+    id INTEGER PRIMARY KEY, run_id INTEGER NOT NULL, file TEXT, suite TEXT, error TEXT );
+CREATE TABLE IF NOT EXISTS cases (
+    run_id INTEGER NOT NULL, suite_id INTEGER NOT NULL, started REAL NOT NULL,
+    suite TEXT, test_id TEXT, result TEXT, comment TEXT, time REAL );
+CREATE INDEX IF NOT EXISTS runs_started ON runs ( started );
+CREATE INDEX IF NOT EXISTS suites_suite ON suites ( suite, run_id );
+CREATE INDEX IF NOT EXISTS cases_test ON cases ( test_id, started, result, run_id );
+CREATE INDEX IF NOT EXISTS cases_run ON cases ( run_id );
+"""
+
+
+def open_db ( db_file ):
+    """
+    Opens (and creates) results database.
+    @param db_file Database file path.
+    @return sqlite3 connection.
+    """
+    db = sqlite3.connect( db_file )
+    db.execute( "PRAGMA journal_mode = WAL" )
+    db.execute( "PRAGMA synchronous = NORMAL" )
+    db.executescript( SCHEMA )
+    return db
+
+
+class ResultsDbWriter ( ReportWriter ):
+
+    def __init__ ( self, path = config.RESULTS_DB_FILE, revision = None, folder = None ):
+        """
+        Class constructor, starts a new run. Results are committed at once
+        on close, an interrupted run leaves no partial run behind.
+        @param path Database file path.
+        @param revision Revision (commit) the results were produced with.
+        @param folder Log folder of the run.
+        """
+        self.path = path
+        self._db = open_db( path )
+        self._started = time.time()
+        self._run_id = self._db.execute( "INSERT INTO runs ( started, revision, folder ) VALUES ( ?, ?, ? )",
+                                         ( self._started, revision, folder ) ).lastrowid
+
+    def write_suite ( self, ts_res_log ):
+        """
+        Appends one test suite and its test case results.
+        @param ts_res_log Test suite result details.
+        """
+        suite = ts_res_log.get( "test_suite_id" )
+        suite_id = self._db.execute( "INSERT INTO suites ( run_id, file, suite, error ) VALUES ( ?, ?, ?, ? )",
+                                     ( self._run_id, ts_res_log["file"], suite,
+                                       ts_res_log.get( "error_log" ) ) ).lastrowid
+        self._db.executemany( "INSERT INTO cases VALUES ( ?, ?, ?, ?, ?, ?, ?, ? )",
+                              [ ( self._run_id, suite_id, self._started, suite, tcr["test_id"], tcr["test_result"],
+                                  tcr["comment"], tcr.get( "time" ) ) for tcr in ts_res_log.get( "tc_results", [] ) ] )
+
+    def close ( self, passed, failed, skipped ):
+        """
+        Stores run totals and commits the run.
+        @param passed Passed test count.
+        @param failed Failed test count.
+        @param skipped Skipped test count.
+        """
+        self._db.execute( "UPDATE runs SET passed = ?, failed = ?, skipped = ? WHERE id = ?",
+                          ( passed, failed, skipped, self._run_id ) )
+        self._db.commit()
+        self._db.close()
+
+
+def query_runs ( db, runs ):
+    """
+    Returns latest runs, newest first.
+    @param db Database connection.
+    @param runs Number of runs.
+    @return List of (run id, started, revision, passed, failed, skipped).
+    """
+    return db.execute( "SELECT id, started, revision, passed, failed, skipped FROM runs "
+                       "ORDER BY started DESC LIMIT ?", ( runs, ) ).fetchall()
+
+def query_trend ( db, test_id, runs ):
+    """
+    Returns pass rate of a test case in its latest runs, newest first.
+    @param db Database connection.
+    @param test_id Test case id.
+    @param runs Number of runs.
+    @return List of (run id, started, revision, passed, executed).
+    """
+    return db.execute( "SELECT c.run_id, c.started, r.revision, SUM( c.result = 'PASS' ), "
+                       "SUM( c.result <> 'SKIP' ) FROM cases c JOIN runs r ON r.id = c.run_id "
+                       "WHERE c.test_id = ? GROUP BY c.run_id ORDER BY c.started DESC LIMIT ?",
+                       ( test_id, runs ) ).fetchall()
+
+def query_first_failure ( db, test_id ):
+    """
+    Returns the run where the current failure streak of a test case started,
+    i.e. its first failing run after it last passed. A run's verdict is FAIL
+    if any execution of the test case in it failed (a test id can be
+    reported more than once per run), else PASS if one passed; runs which
+    only skipped it don't count.
+    @param db Database connection.
+    @param test_id Test case id.
+    @return (run id, started, revision), or None if it isn't failing.
+    """
+    # 'FAIL' sorts before 'PASS', so MIN( result ) is the run's verdict
+    verdicts = ( "WITH verdicts AS ( SELECT run_id, started, MIN( result ) AS verdict FROM cases "
+                 "WHERE test_id = ? AND result IN ( 'PASS', 'FAIL' ) GROUP BY run_id ) " )
+    last_pass = db.execute( verdicts + "SELECT started, run_id FROM verdicts WHERE verdict = 'PASS' "
+                            "ORDER BY started DESC, run_id DESC LIMIT 1", ( test_id, ) ).fetchone()
+    if last_pass is None:
+        last_pass = ( -1.0, -1 )
+    return db.execute( verdicts + "SELECT v.run_id, v.started, r.revision FROM verdicts v "
+                       "JOIN runs r ON r.id = v.run_id WHERE v.verdict = 'FAIL' AND "
+                       "( v.started > ? OR ( v.started = ? AND v.run_id > ? ) ) "
+                       "ORDER BY v.started, v.run_id LIMIT 1",
+                       ( test_id, last_pass[0], last_pass[0], last_pass[1] ) ).fetchone()
+
+def query_slowest ( db, runs, count ):
+    """
+    Returns test cases with the highest mean duration in the latest runs.
+    @param db Database connection.
+    @param runs Number of latest runs to look at.
+    @param count Number of test cases.
+    @return List of (suite, test id, mean time, max time, executions).
+    """
+    return db.execute( "SELECT suite, test_id, AVG( time ), MAX( time ), COUNT( * ) FROM cases "
+                       "WHERE run_id IN ( SELECT id FROM runs ORDER BY started DESC LIMIT ? ) "
+                       "AND time IS NOT NULL GROUP BY suite, test_id ORDER BY AVG( time ) DESC LIMIT ?",
+                       ( runs, count ) ).fetchall()
+
+def _when ( started ):
+    """
+    Formats run timestamp.
+    @param started Seconds since epoch.
+    """
+    return time.strftime( "%Y-%m-%d %H:%M:%S", time.localtime( started ) )
+
+def print_help ():
+    print ( "python results_db.py [-d db_file] [-n runs] <query> [test id]" )
+    print ( "  runs                     latest runs with their counts" )
+    print ( "  trend <test id>          pass rate of a test case per run" )
+    print ( "  first-failure <test id>  run where the current failure streak started" )
+    print ( "  slowest                  slowest test cases by mean duration (-n runs, top 20)" )
+    print ( "  -d  database file, default " + config.RESULTS_DB_FILE )
+    print ( "  -n  number of latest runs to look at, default 20" )
+
+
+if __name__ == "__main__":
+
+    db_file = config.RESULTS_DB_FILE
+    runs = 20
+    try:
+        opts, args = getopt.getopt( sys.argv[1:], "hd:n:" )
+    except getopt.GetoptError:
+        print_help ()
+        exit (1)
+
+    for opt, val in opts:
+        if opt == "-h":
+            print_help ()
+            exit (0)
+        elif opt == "-d":
+            db_file = val
+        elif opt == "-n":
+            runs = int( val )
+
+    if len(args) < 1 or ( args[0] in [ "trend", "first-failure" ] and len(args) < 2 ):
+        print_help ()
+        exit (1)
+    if not os.path.exists( db_file ):
+        LOG ( "ERROR", "Results database " + db_file + " doesn't exist" )
+        exit (1)
+
+    db = open_db( db_file )
+    if args[0] == "runs":
+        for run_id, started, revision, passed, failed, skipped in query_runs( db, runs ):
+            print( "%6d  %s  %-12s  passed %d  failed %d  skipped %d" % ( run_id, _when( started ),
+                   revision or "-", passed, failed, skipped ) )
+    elif args[0] == "trend":
+        rows = query_trend( db, args[1], runs )
+        for run_id, started, revision, passed, executed in rows:
+            rate = ( 100.0 * passed / executed ) if executed > 0 else 0.0
+            print( "%6d  %s  %-12s  %5.1f%%  (%d of %d)" % ( run_id, _when( started ), revision or "-",
+                   rate, passed, executed ) )
+        passed = sum( r[3] for r in rows )
+        executed = sum( r[4] for r in rows )
+        print( "%s: %.1f%% passed over %d run(s)" % ( args[1], ( 100.0 * passed / executed ) if executed > 0 else 0.0,
+               len(rows) ) )
+    elif args[0] == "first-failure":
+        row = query_first_failure( db, args[1] )
+        if row is None:
+            print( "%s is not failing" % args[1] )
+        else:
+            print( "%s failing since run %d, %s, revision %s" % ( args[1], row[0], _when( row[1] ), row[2] or "-" ) )
+    elif args[0] == "slowest":
+        for suite, test_id, mean, longest, executions in query_slowest( db, runs, 20 ):
+            print( "%-20s %-20s  mean %.3f s  max %.3f s  (%d)" % ( suite, test_id, mean, longest, executions ) )
+    else:
+        print_help ()
+        exit (1)
+
+# End of file 
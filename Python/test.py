@@ -1,12 +1,18 @@
 #!/usr/bin/env 
 # -*- coding: utf-8 -*-
 
-import os, subprocess
+import os, json, shutil, subprocess, tempfile
+import xml.etree.ElementTree as ET
 
 import logParserClass
 import config
 from console_log import LOG
 from logParserClass import logParser
+from report_writers import TextReportWriter, JUnitReportWriter, JsonLinesReportWriter
+import results_db
+import xml_scan
+import console_follow
+import order_check
 
 LOG_FOLDER = "C:\\repos\\trash\\nordic\\Python\\logs"   # root location for test logs
 
@@ -130,19 +136,241 @@ def test_process_logs ():
     if test_result == 0:
         LOG ( "TEST", "process_logs() test: passed" )
 
+# Test parallel process_logs() against serial one
+def test_process_logs_parallel (): 
+    lp = logParser("xml")
+    lp.process_logs(LOG_FOLDER)
+    lp_par = logParser("xml")
+    lp_par.process_logs(LOG_FOLDER, 2)
+
+    test_result = 0
+    if not lp.get_process_logs() == lp_par.get_process_logs():
+        LOG ( "TEST", "parallel test suite results test: failed" )
+        test_result = 1
+
+    for result_type in [ config.TEST_RES_PASS, config.TEST_RES_FAIL, config.TEST_RES_SKIP ]:
+        if not lp.get_result_by_type(result_type) == lp_par.get_result_by_type(result_type):
+            LOG ( "TEST", "parallel result count test: failed" )
+            test_result = 1
+
+    if test_result == 0:
+        LOG ( "TEST", "parallel process_logs() test: passed" )
+
+# Test process_logs() with results cache, second run takes every file from it
+def test_process_logs_cache (): 
+    cache_file = os.path.join(tempfile.mkdtemp(), "results_cache.json")
+    lp = logParser("xml")
+    lp.process_logs(LOG_FOLDER)
+    lp_cold = logParser("xml")
+    lp_cold.process_logs(LOG_FOLDER, 1, cache_file)
+    lp_warm = logParser("xml")
+    lp_warm.process_logs(LOG_FOLDER, 1, cache_file)
+
+    test_result = 0
+    if not ( lp_cold.cache_hits == 0 and lp_warm.cache_hits == len(lp.get_process_logs()) ):
+        LOG ( "TEST", "cache hit test: failed" )
+        test_result = 1
+
+    if not ( lp.get_process_logs() == lp_cold.get_process_logs() == lp_warm.get_process_logs() ):
+        LOG ( "TEST", "cached test suite results test: failed" )
+        test_result = 1
+
+    if not lp.get_result_by_type(config.TEST_RES_FAIL) == lp_warm.get_result_by_type(config.TEST_RES_FAIL):
+        LOG ( "TEST", "cached result count test: failed" )
+        test_result = 1
+
+    if test_result == 0:
+        LOG ( "TEST", "cached process_logs() test: passed" )
+
+# Test streaming report writers, all formats written in one pass
+def test_write_reports (): 
+    out_dir = tempfile.mkdtemp()
+    writers = [ TextReportWriter(os.path.join(out_dir, "r.txt")), JUnitReportWriter(os.path.join(out_dir, "r.xml")),
+                JsonLinesReportWriter(os.path.join(out_dir, "r.jsonl")) ]
+    lp = logParser("xml")
+    lp.write_reports(os.path.join(LOG_FOLDER, "gatts", "gaw"), writers)
+
+    test_result = 0
+    with open(os.path.join(out_dir, "r.txt"), "rb") as f:
+        text = f.read()
+    if not ( b"Total tests: 6\r\nPassed: 3\r\nFailed: 2\r\nSkipped: 1" in text and
+             text.count(b"\r") == text.count(b"\r\n") and not b" \r\n" in text ):
+        LOG ( "TEST", "text report test: failed" )
+        test_result = 1
+
+    root = ET.parse(os.path.join(out_dir, "r.xml")).getroot()
+    if not ( root.get("tests") == "6" and root.get("failures") == "2" and root.get("errors") == "0" and
+             root.get("skipped") == "1" and len(root.findall("testsuite/testcase")) == 6 ):
+        LOG ( "TEST", "JUnit report test: failed" )
+        test_result = 1
+
+    # a report written into the log folder is not parsed as a log on the next run
+    log_dir = os.path.join(out_dir, "logs")
+    shutil.copytree(os.path.join(LOG_FOLDER, "gatts", "gaw"), log_dir)
+    for run in range(2):
+        lp = logParser("xml")
+        lp.write_reports(log_dir, [ JUnitReportWriter(os.path.join(log_dir, "r.xml")) ])
+    root = ET.parse(os.path.join(log_dir, "r.xml")).getroot()
+    if not ( root.get("tests") == "6" and root.get("errors") == "0" ):
+        LOG ( "TEST", "JUnit report in log folder test: failed" )
+        test_result = 1
+
+    writer = JUnitReportWriter(os.path.join(out_dir, "big.xml"))
+    try:
+        writer.close(10**30, 10**30, 10**30)
+        LOG ( "TEST", "JUnit report totals overflow test: failed" )
+        test_result = 1
+    except ValueError:
+        pass
+
+    with open(os.path.join(out_dir, "r.jsonl"), "r") as f:
+        lines = [ json.loads(line) for line in f ]
+    if not ( len(lines) == 2 and lines[0]["test_suite_id"] == "GATTS_GAW_001" and
+             lines[1]["summary"] == { "total": 6, "passed": 3, "failed": 2, "skipped": 1 } ):
+        LOG ( "TEST", "JSON Lines report test: failed" )
+        test_result = 1
+
+    if test_result == 0:
+        LOG ( "TEST", "write_reports() test: passed" )
+
+# Test results history database over two runs
+def test_results_db (): 
+    db_file = os.path.join(tempfile.mkdtemp(), "results_history.db")
+    for revision in [ "rev1", "rev2" ]:
+        lp = logParser("xml")
+        lp.write_reports(os.path.join(LOG_FOLDER, "gatts", "gaw"), [ results_db.ResultsDbWriter(db_file, revision) ])
+    db = results_db.open_db(db_file)
+
+    test_result = 0
+    runs = results_db.query_runs(db, 10)
+    if not ( len(runs) == 2 and [ r[2] for r in runs ] == [ "rev2", "rev1" ] and runs[0][3:] == ( 3, 2, 1 ) ):
+        LOG ( "TEST", "results database runs test: failed" )
+        test_result = 1
+
+    trend = results_db.query_trend(db, "gaw_bv_001", 10)
+    if not ( len(trend) == 2 and all( r[3:] == ( 1, 1 ) for r in trend ) ):
+        LOG ( "TEST", "results database trend test: failed" )
+        test_result = 1
+
+    first = results_db.query_first_failure(db, "gaw_bv_002")
+    if not ( first is not None and first[2] == "rev1" and results_db.query_first_failure(db, "gaw_bv_001") is None ):
+        LOG ( "TEST", "results database first failure test: failed" )
+        test_result = 1
+
+    # conn_bv_002 both fails and passes in every run, which fails it
+    for revision in [ "rev3", "rev4" ]:
+        lp = logParser("xml")
+        lp.write_reports(os.path.join(LOG_FOLDER, "gap", "conn"), [ results_db.ResultsDbWriter(db_file, revision) ])
+    first = results_db.query_first_failure(db, "conn_bv_002")
+    if not ( first is not None and first[2] == "rev3" and results_db.query_first_failure(db, "conn_bv_001") is None ):
+        LOG ( "TEST", "results database same run pass and fail test: failed" )
+        test_result = 1
+
+    if test_result == 0:
+        LOG ( "TEST", "results database test: passed" )
+
+def test_native_scanner (): 
+    if not xml_scan.available():
+        LOG ( "TEST", "native scanner test: skipped, C/libtc_xmlscan.so not built" )
+        return
+
+    test_result = 0
+    for path, dirs, files in os.walk(LOG_FOLDER):
+        for name in files:
+            log_file = os.path.join(path, name)
+            expected = logParserClass.parse_log_file(log_file, native = False)
+            scanned = xml_scan.scan_log_file(log_file)
+            # Malformed logs are left to ElementTree, which reports them
+            if "error_log" in expected[0]:
+                ok = scanned is None
+            else:
+                ok = scanned == expected
+            if not ok:
+                LOG ( "TEST", "native scanner test: failed, " + name )
+                test_result = 1
+
+    # "]]>" in text is not well formed, ElementTree reports it
+    log_file = os.path.join(tempfile.mkdtemp(), "cdata_end.xml")
+    with open(log_file, "wb") as f:
+        f.write(b'<test_results test_suite="S"><tc_result id="a" result="FAIL"><debug>x[i]]>0</debug>'
+                b'</tc_result></test_results>')
+    if not ( xml_scan.scan_log_file(log_file) is None and
+             "error_log" in logParserClass.parse_log_file(log_file, native = False)[0] ):
+        LOG ( "TEST", "native scanner test: failed, cdata_end.xml" )
+        test_result = 1
+
+    if test_result == 0:
+        LOG ( "TEST", "native scanner test: passed" )
+
+def test_console_follow (): 
+    console = [ "Executing test number: 1 of 3, case 7 (q_init)", "Test Result: PASS", "Test 1 completed",
+                "Executing test number: 2 of 3, case 2 (q_fill)", "[ERROR] queue full", "[ERROR] seed 1",
+                "Test Result: FAIL", "Test 2 completed",
+                "Skipped test case: 4 (q_dump), not selected for time budget", "Test Result: SKIP",
+                "Executing test number: 3 of 3", "[ERROR] test case 3 (q_crash) killed by signal 11" ]
+    log_file = os.path.join(tempfile.mkdtemp(), "test_log.txt")
+    with open(log_file, "wb") as f:
+        f.write("\r\n".join(console).encode())
+    
+    results = console_follow.ConsoleResults("test_log.txt")
+    for line in console_follow.read_lines(log_file, 0.2):
+        if line is not None:
+            results.feed(line)
+    results.finish()
+    
+    # executed cases by name, the last one's console line has no name
+    expected = [ ( "q_init", "PASS", "" ), ( "q_fill", "FAIL", "queue full\nseed 1" ),
+                 ( "q_dump", "SKIP", "not selected for time budget" ),
+                 ( "3", "FAIL", "test case 3 (q_crash) killed by signal 11\n"
+                                "console output ended before test case completed" ) ]
+    got = [ ( r["test_id"], r["test_result"], r["comment"] ) for r in results.ts_res_log["tc_results"] ]
+    places = [ ( r.get("index"), r.get("position") ) for r in results.ts_res_log["tc_results"] ]
+    if ( got == expected and places == [ ( 7, 1 ), ( 2, 2 ), ( 4, None ), ( None, 3 ) ] and
+         results.counts == [ 1, 2, 1 ] and results.total == 3 ):
+        LOG ( "TEST", "console follow test: passed" )
+    else:
+        LOG ( "TEST", "console follow test: failed" )
+
+def test_order_minimize (): 
+    # case 9 fails when case 4 ran before it, in any company
+    checker = order_check.OrderChecker(1, "tc_runner")
+    checker.run_order = lambda order: { order[-1]: "FAIL" if 4 in order[:-1] else "PASS" }
+    
+    found = checker.minimize(9, [ 0, 1, 2, 3, 4, 5, 6, 7, 8 ], "FAIL")
+    not_found = checker.minimize(9, [ 0, 1, 2, 3 ], "FAIL")
+    if found == [ 4 ] and not_found is None:
+        LOG ( "TEST", "order dependency minimize test: passed" )
+    else:
+        LOG ( "TEST", "order dependency minimize test: failed" )
+
 #------------------------------------------------------------------------------
 
-# Execute tests
-LOG ( "TEST", "Running Test 1" )
-test_nonexisting_path () 
-LOG ( "TEST", "Running Test 2" )
-test_get_result_by_type ()
-LOG ( "TEST", "Running Test 3" )
-test_process_logs () 
-LOG ( "TEST", "Running Test 4" )
-test_generate_report_single () 
-LOG ( "TEST", "Running Test 5" )
-test_generate_report_all ()
+# Execute tests, guarded as parallel parsing workers may import this module
+if __name__ == "__main__":
+    LOG ( "TEST", "Running Test 1" )
+    test_nonexisting_path () 
+    LOG ( "TEST", "Running Test 2" )
+    test_get_result_by_type ()
+    LOG ( "TEST", "Running Test 3" )
+    test_process_logs () 
+    LOG ( "TEST", "Running Test 4" )
+    test_generate_report_single () 
+    LOG ( "TEST", "Running Test 5" )
+    test_generate_report_all ()
+    LOG ( "TEST", "Running Test 6" )
+    test_process_logs_parallel ()
+    LOG ( "TEST", "Running Test 7" )
+    test_process_logs_cache ()
+    LOG ( "TEST", "Running Test 8" )
+    test_write_reports ()
+    LOG ( "TEST", "Running Test 9" )
+    test_results_db ()
+    LOG ( "TEST", "Running Test 10" )
+    test_native_scanner ()
+    LOG ( "TEST", "Running Test 11" )
+    test_console_follow ()
+    LOG ( "TEST", "Running Test 12" )
+    test_order_minimize ()
 
 # End of file  
 
@@ -0,0 +1,231 @@
+#!/usr/bin/env 
+# -*- coding: utf-8 -*-
+
+import os
+import mmap
+import ctypes
+
+import config
+
+"""
+Binding of the native log scanner (C/tc_xmlscan.c). The library maps a log
+file, counts results and returns test case fields with ids, results and
+comments interned and times converted, so each distinct string is decoded
+once here and records are built a batch at a time. Logs the scanner declines
+(entities, comments, CDATA, other encodings) or finds malformed give None,
+and the caller parses them with ElementTree instead, which also reports the
+error.
+
+build : gcc -O2 -shared -fPIC -I. tc_xmlscan.c -o libtc_xmlscan.so  (in C/)
+"""
+
+XS_FIELDS = 12                  # uint64_t per record, see tc_xmlscan.h
+XS_ID = 0                       # offset/length pairs
+XS_RESULT = 2
+XS_TIME = 4
+XS_COMMENT = 6
+XS_ID_STR = 8                   # decoded fields
+XS_RESULT_STR = 9
+XS_COMMENT_STR = 10
+XS_TIME_VALUE = 11
+XS_NONE = (1 << 64) - 1         # missing field
+XS_EMPTY = XS_NONE - 1          # comment without text
+XS_RAW = XS_NONE - 2            # not decoded, read at offset/length
+XS_BATCH = 4096                 # records returned per tc_xs_scan call
+
+# String table entries besides interned strings: missing comment reads as "",
+# one without text as None, a missing id or result never comes from the
+# table, and comments not interned are decoded in place of their None
+XS_SPECIAL = { XS_NONE: "", XS_EMPTY: None, XS_RAW: None }
+
+_lib = None
+_lib_loaded = False
+
+
+def _load ( ):
+    """
+    Loads the scanner library once per process.
+    @return Library handle, or None if it isn't built.
+    """
+    global _lib, _lib_loaded
+
+    if _lib_loaded:
+        return _lib
+    _lib_loaded = True
+
+    path = os.environ.get("TC_XMLSCAN_LIB",
+                          os.path.join(os.path.dirname(os.path.abspath(__file__)), config.XMLSCAN_LIB))
+    try:
+        lib = ctypes.CDLL(path)
+    except OSError:
+        return None
+
+    lib.tc_xs_state_size.restype = ctypes.c_uint32
+    lib.tc_xs_open.argtypes = [ ctypes.c_void_p, ctypes.c_char_p ]
+    lib.tc_xs_scan.argtypes = [ ctypes.c_void_p, ctypes.c_void_p, ctypes.c_uint32 ]
+    lib.tc_xs_strings.restype = ctypes.c_uint32
+    lib.tc_xs_strings.argtypes = [ ctypes.c_void_p, ctypes.c_void_p, ctypes.c_uint32, ctypes.c_uint32 ]
+    lib.tc_xs_summary.argtypes = [ ctypes.c_void_p, ctypes.c_void_p ]
+    lib.tc_xs_close.argtypes = [ ctypes.c_void_p ]
+    _lib = lib
+    return _lib
+
+def available ( ):
+    """
+    Tells whether the native scanner can be used.
+    """
+    return _load() is not None
+
+def _text ( mm, off, length ):
+    """
+    Decodes a field, normalizing line ends as XML parsers do.
+    """
+    text = mm[off:off + length].decode("utf-8")
+    if "\r" in text:
+        text = text.replace("\r\n", "\n").replace("\r", "\n")
+    return text
+
+def _field ( mm, off, length ):
+    """
+    Decodes an attribute, None if it's missing.
+    """
+    if off == XS_NONE:
+        return None
+    return _text(mm, off, length)
+
+def _add_strings ( lib, state, mm, spans, strings ):
+    """
+    Decodes strings the scanner interned since the previous call.
+    @param strings String by number, XS_SPECIAL entries included.
+    """
+    while True:
+        first = len(strings) - len(XS_SPECIAL)
+        n = lib.tc_xs_strings(state, spans, first, XS_BATCH)
+        if n == 0:
+            return
+        for k in range(n):
+            strings[first + k] = _text(mm, spans[2 * k], spans[2 * k + 1])
+
+def _record ( mm, fields, values, k ):
+    """
+    Converts one record from its offsets, for batches with values the
+    scanner didn't decode.
+    """
+    tc_res = dict()
+    tc_res["test_id"] = _field(mm, fields[k + XS_ID], fields[k + XS_ID + 1])
+    tc_res["test_result"] = _field(mm, fields[k + XS_RESULT], fields[k + XS_RESULT + 1])
+
+    # Optional duration in seconds
+    if fields[k + XS_TIME_VALUE] != XS_RAW:
+        if fields[k + XS_TIME_VALUE] != XS_NONE:
+            tc_res["time"] = values[k + XS_TIME_VALUE]
+    else:
+        try:
+            tc_res["time"] = float(_text(mm, fields[k + XS_TIME], fields[k + XS_TIME + 1]))
+        except ValueError:
+            pass
+
+    if fields[k + XS_COMMENT] == XS_NONE:
+        tc_res["comment"] = ""
+    elif fields[k + XS_COMMENT + 1] == 0:
+        tc_res["comment"] = None
+    else:
+        tc_res["comment"] = _text(mm, fields[k + XS_COMMENT], fields[k + XS_COMMENT + 1])
+    return tc_res
+
+def _batch ( mm, fields, values, n, strings ):
+    """
+    Converts a batch of records. Fields are taken column by column from the
+    decoded ones and records built by one comprehension. Records are only
+    converted one by one when an id, result or time wasn't decoded, or only
+    some records of the batch have a time.
+    @param fields Records as uint64_t.
+    @param values Records as double.
+    @param n Records in batch.
+    @param strings String by number, see _add_strings().
+    @return Test case result details.
+    """
+    end = n * XS_FIELDS
+    ids = fields[XS_ID_STR:end:XS_FIELDS].tolist()
+    results = fields[XS_RESULT_STR:end:XS_FIELDS].tolist()
+    comments = fields[XS_COMMENT_STR:end:XS_FIELDS].tolist()
+    times = fields[XS_TIME_VALUE:end:XS_FIELDS].tolist()
+    timed = times.count(XS_NONE)
+    if max(ids) >= XS_RAW or max(results) >= XS_RAW or XS_RAW in times or not timed in ( 0, n ):
+        return [ _record(mm, fields, values, k) for k in range(0, end, XS_FIELDS) ]
+
+    get = strings.__getitem__
+    ids = map(get, ids)
+    results = map(get, results)
+    texts = list(map(get, comments))
+    k = -1
+    for _ in range(comments.count(XS_RAW)):
+        # unique comments beyond the string table
+        k = comments.index(XS_RAW, k + 1)
+        texts[k] = _text(mm, fields[k * XS_FIELDS + XS_COMMENT], fields[k * XS_FIELDS + XS_COMMENT + 1])
+    comments = texts
+    if timed == n:
+        return [ { "test_id": i, "test_result": r, "comment": c } for i, r, c in zip(ids, results, comments) ]
+    times = values[XS_TIME_VALUE:end:XS_FIELDS].tolist()
+    return [ { "test_id": i, "test_result": r, "time": t, "comment": c }
+             for i, r, t, c in zip(ids, results, times, comments) ]
+
+def scan_log_file ( log_file ):
+    """
+    Parses one log file with the native scanner.
+    @param log_file Log file path.
+    @return Test suite result details and its passed, failed and skipped
+            test counts, as logParserClass.parse_log_file returns them, or
+            None if the file has to be parsed with ElementTree.
+    """
+    lib = _load()
+    if lib is None:
+        return None
+
+    state = ctypes.create_string_buffer(lib.tc_xs_state_size())
+    if lib.tc_xs_open(state, os.fsencode(log_file)) != 0:
+        return None
+
+    records = (ctypes.c_uint64 * (XS_BATCH * XS_FIELDS))()
+    fields = memoryview(records).cast("B").cast("Q")
+    values = memoryview(records).cast("B").cast("d")
+    spans = (ctypes.c_uint64 * (XS_BATCH * 2))()
+    summary = (ctypes.c_uint64 * 6)()
+    tc_res_list = list()
+    mm = None
+    try:
+        with open(log_file, "rb") as f:
+            if os.fstat(f.fileno()).st_size > 0:
+                mm = mmap.mmap(f.fileno(), 0, access = mmap.ACCESS_READ)
+        strings = dict(XS_SPECIAL)
+
+        while True:
+            n = lib.tc_xs_scan(state, records, XS_BATCH)
+            if n < 0:
+                return None
+            if n == 0:
+                break
+            _add_strings(lib, state, mm, spans, strings)
+            tc_res_list.extend(_batch(mm, fields, values, n, strings))
+
+        lib.tc_xs_summary(state, summary)
+        ts_res_log = dict()
+        ts_res_log["file"] = os.path.basename(log_file)
+        if summary[0] == XS_NONE:
+            ts_res_log["test_suite_id"] = None
+        else:
+            ts_res_log["test_suite_id"] = _text(mm, summary[0], summary[1])
+        ts_res_log["tc_results"] = tc_res_list
+        counts = [ 0, 0, 0 ]
+        counts[config.TEST_RES_PASS] = summary[2]
+        counts[config.TEST_RES_FAIL] = summary[3]
+        counts[config.TEST_RES_SKIP] = summary[4]
+        return ts_res_log, counts
+    except UnicodeDecodeError:
+        return None
+    finally:
+        lib.tc_xs_close(state)
+        if mm is not None:
+            mm.close()
+
+# End of file